@@ -0,0 +1,51 @@
+// Per-task cost of running tiny tasks with one TimedWorker each versus
+// through a BatchExecutor.
+#include <tw/batch_executor.hpp>
+#include <tw/timed_worker.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+int main()
+{
+    const int tasks = 20'000;
+    std::ostringstream sink;
+    std::atomic<long> sum{0};
+
+    auto t0 = Clock::now();
+    for (int i = 0; i < tasks; ++i)
+    {
+        auto w = tw::make_timed_worker(10ms, [&sum, i](std::stop_token)
+                                       { sum += i; }, sink);
+    }
+    auto per_worker = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / tasks;
+
+    std::printf("%12s %10s %14s\n", "mode", "max_batch", "ns_per_task");
+    std::printf("%12s %10s %14.0f\n", "worker", "-", per_worker);
+
+    for (std::size_t batch : {16u, 64u, 256u})
+    {
+        tw::batch_options opts;
+        opts.max_batch = batch;
+        opts.linger = 100us;
+        auto ex = tw::make_batch_executor(opts, sink);
+
+        std::vector<tw::batch_ticket> tickets;
+        tickets.reserve(tasks);
+        auto t1 = Clock::now();
+        for (int i = 0; i < tasks; ++i)
+            tickets.push_back(ex.submit([&sum, i](std::stop_token)
+                                        { sum += i; }));
+        for (auto &t : tickets)
+            t.wait();
+        auto per_task = std::chrono::duration<double, std::nano>(Clock::now() - t1).count() / tasks;
+        std::printf("%12s %10zu %14.0f\n", "batch", batch, per_task);
+    }
+    return 0;
+}
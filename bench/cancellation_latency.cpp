@@ -0,0 +1,269 @@
+// Time from a stop to the callable's exit, per blocking style and per
+// escalation policy. Each run starts one worker, waits until it is
+// blocked, then triggers the policy and records when the callable
+// returned. Runs whose callable has not returned within --window count as
+// missed; they are then unblocked by hand.
+//
+// blocking styles:
+//   poll     busy loop checking stop_requested()
+//   sleep    tw::this_worker::sleep_for
+//   cv       condition_variable_any::wait with the stop_token
+//   read     read() on a pipe, stop not wired up (POSIX only)
+//   read_cb  read() on a pipe, a stop_callback writes to it (POSIX only)
+// escalation policies:
+//   stop       request_stop(), the handle stays alive
+//   destroy    the handle's destructor: stop, shutdown grace, detach
+//   emergency  emergency_stop(), then the handle is destroyed at once
+//
+// usage: bench_cancellation_latency [--runs=100] [--window=100] (ms)
+//            [--grace=10] (ms)
+#include <tw/this_worker.hpp>
+#include <tw/timed_worker.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define TW_BENCH_PIPES 1
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    enum class style
+    {
+        poll,
+        sleep,
+        cv,
+        read,
+        read_cb
+    };
+
+    enum class policy
+    {
+        stop,
+        destroy,
+        emergency
+    };
+
+    char const *name(style s)
+    {
+        static char const *const names[] = {"poll", "sleep", "cv", "read", "read_cb"};
+        return names[static_cast<int>(s)];
+    }
+
+    char const *name(policy p)
+    {
+        static char const *const names[] = {"stop", "destroy", "emergency"};
+        return names[static_cast<int>(p)];
+    }
+
+    // Shared with the worker, which may outlive its handle.
+    struct probe
+    {
+        int fds[2]{-1, -1};
+        std::atomic_bool blocked{false};
+        std::atomic_bool exited{false};
+        std::atomic<Clock::rep> exitAt{0};
+
+#if defined(TW_BENCH_PIPES)
+        ~probe()
+        {
+            for (int fd : fds)
+                if (fd >= 0)
+                    ::close(fd);
+        }
+
+        void unblock() const
+        {
+            char c = 0;
+            [[maybe_unused]] auto n = ::write(fds[1], &c, 1);
+        }
+#else
+        // only the pipe styles need waking by hand
+        void unblock() const {}
+#endif
+    };
+
+    void body(style s, probe &p, std::stop_token const &st)
+    {
+        switch (s)
+        {
+        case style::poll:
+            p.blocked = true;
+            while (!st.stop_requested())
+                ;
+            break;
+        case style::sleep:
+            p.blocked = true;
+            tw::this_worker::sleep_for(1h);
+            break;
+        case style::cv:
+        {
+            std::mutex mtx;
+            std::condition_variable_any cv;
+            std::unique_lock lk(mtx);
+            p.blocked = true;
+            cv.wait(lk, st, []
+                    { return false; });
+            break;
+        }
+        case style::read:
+        case style::read_cb:
+        {
+#if defined(TW_BENCH_PIPES)
+            std::optional<std::stop_callback<std::function<void()>>> wake;
+            if (s == style::read_cb)
+                wake.emplace(st, [&p]
+                             { p.unblock(); });
+            char c;
+            p.blocked = true;
+            [[maybe_unused]] auto n = ::read(p.fds[0], &c, 1);
+#endif
+            break;
+        }
+        }
+        p.exitAt = Clock::now().time_since_epoch().count();
+        p.exited = true;
+    }
+
+    struct result
+    {
+        std::vector<double> latency_us;
+        std::size_t missed = 0;
+        // until the handle let go; zero for `stop`, which keeps it
+        std::vector<double> handle_us;
+    };
+
+    // Stop-to-exit latency of one run, or nothing if it missed the window.
+    std::optional<double> run_once(style s, policy pol, Clock::duration grace, Clock::duration window,
+                                   double &handle_us)
+    {
+        std::ostringstream sink;
+        auto p = std::make_shared<probe>();
+#if defined(TW_BENCH_PIPES)
+        if (::pipe(p->fds) != 0)
+            return std::nullopt;
+#endif
+
+        Clock::time_point t0;
+        {
+            auto w = tw::make_timed_worker(grace, [p, s](std::stop_token st)
+                                           { body(s, *p, st); }, sink);
+            while (!p->blocked)
+                std::this_thread::yield();
+            // let it reach the blocking call
+            std::this_thread::sleep_for(200us);
+
+            t0 = Clock::now();
+            if (pol == policy::stop)
+            {
+                w.request_stop();
+                w.wait_until(t0 + window);
+            }
+            else if (pol == policy::emergency)
+                w.emergency_stop();
+        }
+        if (pol != policy::stop)
+            handle_us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+
+        auto until = t0 + window;
+        while (!p->exited && Clock::now() < until)
+            std::this_thread::sleep_for(50us);
+        if (!p->exited)
+        {
+            // the worker still owns p; wake it and wait for it to leave
+            p->unblock();
+            while (!p->exited)
+                std::this_thread::sleep_for(100us);
+            return std::nullopt;
+        }
+        return std::chrono::duration<double, std::micro>(Clock::time_point(Clock::duration(p->exitAt.load())) - t0)
+            .count();
+    }
+
+    double percentile(std::vector<double> &v, double q)
+    {
+        if (v.empty())
+            return 0;
+        std::sort(v.begin(), v.end());
+        return v[static_cast<std::size_t>(q * static_cast<double>(v.size() - 1))];
+    }
+
+    bool flag(char const *arg, char const *name, std::string &value)
+    {
+        auto n = std::strlen(name);
+        if (std::strncmp(arg, name, n) != 0 || arg[n] != '=')
+            return false;
+        value = arg + n + 1;
+        return true;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::size_t runs = 100;
+    auto window = 100ms;
+    auto grace = 10ms;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string v;
+        if (flag(argv[i], "--runs", v))
+            runs = std::max<std::size_t>(std::strtoul(v.c_str(), nullptr, 10), 1);
+        else if (flag(argv[i], "--window", v))
+            window = std::chrono::milliseconds(std::max(std::atol(v.c_str()), 1L));
+        else if (flag(argv[i], "--grace", v))
+            grace = std::chrono::milliseconds(std::max(std::atol(v.c_str()), 0L));
+        else
+        {
+            std::fprintf(stderr, "unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    std::printf("%8s %10s %6s %7s %10s %10s %10s %10s %12s\n", "style", "policy", "runs", "missed", "p50_us",
+                "p99_us", "max_us", "mean_us", "handle_p50_us");
+#if defined(TW_BENCH_PIPES)
+    for (auto s : {style::poll, style::sleep, style::cv, style::read, style::read_cb})
+#else
+    for (auto s : {style::poll, style::sleep, style::cv})
+#endif
+        for (auto pol : {policy::stop, policy::destroy, policy::emergency})
+        {
+            result r;
+            for (std::size_t i = 0; i < runs; ++i)
+            {
+                double handle = 0;
+                if (auto lat = run_once(s, pol, grace, window, handle))
+                    r.latency_us.push_back(*lat);
+                else
+                    ++r.missed;
+                r.handle_us.push_back(handle);
+            }
+            double mean = 0;
+            for (auto v : r.latency_us)
+                mean += v / static_cast<double>(r.latency_us.size());
+            auto p50 = percentile(r.latency_us, 0.50), p99 = percentile(r.latency_us, 0.99);
+            auto max = r.latency_us.empty() ? 0.0 : r.latency_us.back();
+            std::printf("%8s %10s %6zu %7zu %10.1f %10.1f %10.1f %10.1f %12.1f\n", name(s), name(pol), runs, r.missed,
+                        p50, p99, max, mean, percentile(r.handle_us, 0.50));
+        }
+    return 0;
+}
@@ -0,0 +1,408 @@
+// Open-loop load generator: requests arrive as a Poisson process at a fixed
+// offered rate, whether or not earlier ones have finished. Each request
+// has a service time drawn from a configurable distribution and a timeout
+// counted from its arrival, and is run on each backend in turn.
+//
+// Latency is measured from the request's *intended* arrival time, so a
+// backend (or generator) that falls behind is charged for the queueing it
+// causes instead of silently slowing the arrivals down - the coordinated
+// omission a closed-loop benchmark suffers from. The "naive" column measures
+// from the actual submission, for comparison.
+//
+// usage: bench_load_generator [--rate=2000] [--seconds=2] [--service=exp:200]
+//            [--timeout=5000] [--stuck=0] [--stuck-for=50000] [--threads=4]
+//            [--work=sleep|spin] [--backend=all|worker|pool|batch]
+// times are in microseconds; --service is const|exp|lognormal|bimodal:<mean>.
+#include <tw/batch_executor.hpp>
+#include <tw/timed_worker.hpp>
+#include <tw/worker_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    // HDR-style log-linear histogram of nanoseconds: 64 linear sub-buckets
+    // per power of two, i.e. under 1.6% relative error, up to ~18 minutes.
+    // Recording is a single relaxed increment, from any thread.
+    class hdr_histogram
+    {
+    public:
+        static constexpr int sub_bits = 7;
+        static constexpr std::uint64_t sub_count = 1u << sub_bits;
+        static constexpr std::uint64_t half = sub_count / 2;
+        static constexpr int max_bits = 40;
+
+        hdr_histogram() : _counts(index_of((std::uint64_t{1} << max_bits) - 1) + 1) {}
+
+        void record(Clock::duration d) noexcept
+        {
+            auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(d).count(), 0));
+            ns = std::min(ns, (std::uint64_t{1} << max_bits) - 1);
+            _counts[index_of(ns)].fetch_add(1, std::memory_order_relaxed);
+            _total.fetch_add(1, std::memory_order_relaxed);
+            auto m = _max.load(std::memory_order_relaxed);
+            while (m < ns && !_max.compare_exchange_weak(m, ns, std::memory_order_relaxed))
+                ;
+        }
+
+        std::uint64_t count() const noexcept { return _total.load(std::memory_order_relaxed); }
+
+        // Highest value equivalent to the p-quantile, as HdrHistogram reports.
+        double percentile_us(double p) const noexcept
+        {
+            auto total = count();
+            if (total == 0)
+                return 0;
+            auto target = static_cast<std::uint64_t>(std::ceil(p * static_cast<double>(total)));
+            target = std::max<std::uint64_t>(target, 1);
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < _counts.size(); ++i)
+            {
+                seen += _counts[i].load(std::memory_order_relaxed);
+                if (seen >= target)
+                    return static_cast<double>(std::min(highest_of(i), _max.load())) / 1000.0;
+            }
+            return static_cast<double>(_max.load()) / 1000.0;
+        }
+
+        double max_us() const noexcept { return static_cast<double>(_max.load()) / 1000.0; }
+
+    private:
+        static std::size_t index_of(std::uint64_t v) noexcept
+        {
+            if (v < sub_count)
+                return static_cast<std::size_t>(v);
+            int shift = std::bit_width(v) - sub_bits;
+            return static_cast<std::size_t>(sub_count + (shift - 1) * half + ((v >> shift) - half));
+        }
+
+        static std::uint64_t highest_of(std::size_t i) noexcept
+        {
+            if (i < sub_count)
+                return i;
+            auto shift = static_cast<int>((i - sub_count) / half + 1);
+            auto sub = (i - sub_count) % half + half;
+            return ((sub + 1) << shift) - 1;
+        }
+
+        std::vector<std::atomic<std::uint64_t>> _counts;
+        std::atomic<std::uint64_t> _total{0};
+        std::atomic<std::uint64_t> _max{0};
+    };
+
+    struct config
+    {
+        double rate = 2000;
+        double seconds = 2;
+        std::string service = "exp";
+        double service_us = 200;
+        double timeout_us = 5000;
+        double stuck = 0;
+        double stuck_for_us = 50000;
+        std::size_t threads = 4;
+        bool spin = false;
+        std::string backend = "all";
+    };
+
+    struct request
+    {
+        Clock::time_point intended;
+        Clock::time_point submitted;
+        Clock::time_point deadline;
+        Clock::duration service;
+        bool stuck = false;
+        std::atomic_bool recorded{false};
+    };
+
+    struct results
+    {
+        hdr_histogram latency;
+        hdr_histogram naive;
+        std::atomic<std::uint64_t> completed{0}, timed_out{0}, rejected{0}, abandoned{0};
+
+        void finish(request &r, bool ok) noexcept
+        {
+            if (r.recorded.exchange(true))
+                return;
+            auto now = Clock::now();
+            latency.record(now - r.intended);
+            naive.record(now - r.submitted);
+            (ok && now <= r.deadline ? completed : timed_out).fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    // Simulated work: returns false if the deadline or a stop came first.
+    bool serve(request const &r, std::stop_token const &st, bool spin)
+    {
+        auto start = Clock::now();
+        if (r.stuck)
+        {
+            std::this_thread::sleep_for(r.service);
+            return true;
+        }
+        for (;;)
+        {
+            auto now = Clock::now();
+            if (now - start >= r.service)
+                return true;
+            if (now >= r.deadline || st.stop_requested())
+                return false;
+            if (spin)
+                std::this_thread::yield();
+            else
+                std::this_thread::sleep_for(std::min<Clock::duration>(r.service - (now - start), 50us));
+        }
+    }
+
+    Clock::duration us(double v) { return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::micro>(v)); }
+
+    class generator
+    {
+    public:
+        explicit generator(config const &c) : _c(c), _rng(42) {}
+
+        std::vector<std::shared_ptr<request>> schedule(Clock::time_point start)
+        {
+            std::exponential_distribution<double> gap(_c.rate / 1e6);
+            std::uniform_real_distribution<double> coin(0, 1);
+            std::vector<std::shared_ptr<request>> out;
+            double t = 0;
+            while ((t += gap(_rng)) < _c.seconds * 1e6)
+            {
+                auto r = std::make_shared<request>();
+                r->intended = start + us(t);
+                r->deadline = r->intended + us(_c.timeout_us);
+                r->stuck = coin(_rng) < _c.stuck;
+                r->service = r->stuck ? us(_c.stuck_for_us) : us(service_time());
+                out.push_back(std::move(r));
+            }
+            return out;
+        }
+
+    private:
+        double service_time()
+        {
+            auto mean = _c.service_us;
+            if (_c.service == "const")
+                return mean;
+            if (_c.service == "lognormal")
+            {
+                // sigma 1: a long right tail around the same mean
+                std::lognormal_distribution<double> d(std::log(mean) - 0.5, 1.0);
+                return d(_rng);
+            }
+            if (_c.service == "bimodal")
+            {
+                // 90% fast, 10% ten times slower, same mean
+                std::uniform_real_distribution<double> coin(0, 1);
+                return coin(_rng) < 0.9 ? mean / 1.9 : mean * 10 / 1.9;
+            }
+            std::exponential_distribution<double> d(1.0 / mean);
+            return d(_rng);
+        }
+
+        config const &_c;
+        std::mt19937_64 _rng;
+    };
+
+    // Replays the arrival schedule against one backend and waits for the
+    // outcome of every request.
+    void drive(char const *name, config const &c, std::function<void(std::shared_ptr<request>, results &)> submit,
+               std::function<void()> drain = {})
+    {
+        results res;
+        auto before = tw::detach_stats().detached;
+        auto start = Clock::now() + 10ms;
+        auto reqs = generator(c).schedule(start);
+
+        for (auto &r : reqs)
+        {
+            std::this_thread::sleep_until(r->intended);
+            r->submitted = Clock::now();
+            submit(r, res);
+        }
+        if (drain)
+            drain();
+
+        auto settle = Clock::now() + 10s;
+        auto outcomes = [&]
+        { return res.completed + res.timed_out + res.rejected + res.abandoned; };
+        while (outcomes() < reqs.size() && Clock::now() < settle)
+            std::this_thread::sleep_for(1ms);
+
+        auto n = static_cast<double>(std::max<std::size_t>(reqs.size(), 1));
+        auto detached = tw::detach_stats().detached - before;
+        std::printf("%8s %9zu %10.0f %9.1f %9.1f %9.1f %10.1f %9.1f %8.2f %8.2f %8.2f\n", name, reqs.size(),
+                    static_cast<double>(res.completed) / c.seconds, res.latency.percentile_us(0.50),
+                    res.latency.percentile_us(0.99), res.latency.percentile_us(0.999), res.latency.max_us(),
+                    res.naive.percentile_us(0.99), 100.0 * static_cast<double>(res.timed_out + res.abandoned) / n,
+                    100.0 * static_cast<double>(res.rejected) / n, 100.0 * static_cast<double>(detached) / n);
+    }
+
+    void run_worker(config const &c)
+    {
+        // One TimedWorker per request. Handles are destroyed in arrival
+        // order once their deadline has passed, by a separate thread, so
+        // the generator never blocks on a destructor.
+        std::ostringstream sink;
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<std::pair<std::shared_ptr<request>, tw::TimedWorker<std::ostringstream>>> live;
+        bool closed = false;
+        results *out = nullptr;
+
+        std::jthread reaper([&]
+                            {
+            for (;;)
+            {
+                std::unique_lock lk(mtx);
+                cv.wait(lk, [&] { return !live.empty() || closed; });
+                if (live.empty())
+                    return;
+                auto item = std::move(live.front());
+                live.pop_front();
+                lk.unlock();
+                item.second.wait_until(item.first->deadline);
+                {
+                    auto w = std::move(item.second);
+                }
+                if (!item.first->recorded.exchange(true))
+                {
+                    // the caller gets control back only now
+                    auto now = Clock::now();
+                    out->latency.record(now - item.first->intended);
+                    out->naive.record(now - item.first->submitted);
+                    ++out->abandoned;
+                }
+            } });
+
+        drive(
+            "worker", c, [&](std::shared_ptr<request> r, results &res)
+            {
+                out = &res;
+                auto w = tw::make_timed_worker(r->deadline, 1ms, [r, &res, spin = c.spin](std::stop_token st)
+                                               { res.finish(*r, serve(*r, st, spin)); }, sink);
+                {
+                    std::lock_guard lk(mtx);
+                    live.emplace_back(std::move(r), std::move(w));
+                }
+                cv.notify_one(); },
+            [&]
+            {
+                {
+                    std::lock_guard lk(mtx);
+                    closed = true;
+                }
+                cv.notify_one();
+                reaper.join();
+            });
+    }
+
+    void run_pool(config const &c)
+    {
+        std::ostringstream sink;
+        tw::worker_pool<std::ostringstream> pool(c.threads, sink, 10ms, 1 << 16);
+        drive("pool", c, [&](std::shared_ptr<request> r, results &res)
+              {
+            auto &req = *r;
+            if (!pool.try_submit([r, &res, spin = c.spin](std::stop_token st)
+                                 { res.finish(*r, Clock::now() < r->deadline && serve(*r, st, spin)); }))
+            {
+                req.recorded = true;
+                ++res.rejected;
+            } });
+    }
+
+    void run_batch(config const &c)
+    {
+        std::ostringstream sink;
+        tw::batch_options opts;
+        opts.max_batch = 16;
+        opts.linger = 100us;
+        opts.batch_budget = us(c.timeout_us);
+        auto ex = tw::make_batch_executor(opts, sink);
+        drive("batch", c, [&](std::shared_ptr<request> r, results &res)
+              { ex.submit([r, &res, spin = c.spin](std::stop_token st)
+                          { res.finish(*r, Clock::now() < r->deadline && serve(*r, st, spin)); }); });
+    }
+
+    bool flag(char const *arg, char const *name, std::string &value)
+    {
+        auto n = std::strlen(name);
+        if (std::strncmp(arg, name, n) != 0 || arg[n] != '=')
+            return false;
+        value = arg + n + 1;
+        return true;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    config c;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string v;
+        if (flag(argv[i], "--rate", v))
+            c.rate = std::atof(v.c_str());
+        else if (flag(argv[i], "--seconds", v))
+            c.seconds = std::atof(v.c_str());
+        else if (flag(argv[i], "--service", v))
+        {
+            auto colon = v.find(':');
+            c.service = v.substr(0, colon);
+            if (colon != std::string::npos)
+                c.service_us = std::atof(v.c_str() + colon + 1);
+        }
+        else if (flag(argv[i], "--timeout", v))
+            c.timeout_us = std::atof(v.c_str());
+        else if (flag(argv[i], "--stuck", v))
+            c.stuck = std::atof(v.c_str());
+        else if (flag(argv[i], "--stuck-for", v))
+            c.stuck_for_us = std::atof(v.c_str());
+        else if (flag(argv[i], "--threads", v))
+            c.threads = static_cast<std::size_t>(std::atoi(v.c_str()));
+        else if (flag(argv[i], "--work", v))
+            c.spin = v == "spin";
+        else if (flag(argv[i], "--backend", v))
+            c.backend = v;
+        else
+        {
+            std::fprintf(stderr, "unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    std::printf("rate=%.0f/s seconds=%.1f service=%s:%.0fus timeout=%.0fus stuck=%.4f\n", c.rate, c.seconds,
+                c.service.c_str(), c.service_us, c.timeout_us, c.stuck);
+    std::printf("%8s %9s %10s %9s %9s %9s %10s %9s %8s %8s %8s\n", "backend", "requests", "done_rps", "p50_us",
+                "p99_us", "p999_us", "max_us", "naive_p99", "tmo_%", "rej_%", "detach_%");
+    if (c.backend == "all" || c.backend == "worker")
+        run_worker(c);
+    if (c.backend == "all" || c.backend == "pool")
+        run_pool(c);
+    if (c.backend == "all" || c.backend == "batch")
+        run_batch(c);
+    return 0;
+}
@@ -0,0 +1,242 @@
+// Memory cost of live workers: ramps the number of blocked tasks held by
+// each backend and samples /proc/self/status (VmRSS, VmSize, Threads) and
+// /proc/self/smaps_rollup (Pss, Anonymous) at each step. Bytes per worker
+// are the growth over the backend's empty baseline divided by the live
+// count. TimedWorker threads are std::jthreads, so the stack size is
+// swept through the process-wide pthread default. Linux (glibc) only.
+//
+// usage: bench_memory_footprint [--max=10000] [--steps=5]
+//            [--stacks=default,64,256] (KiB)
+//            [--backend=all|worker|pool|batch]
+#include <tw/batch_executor.hpp>
+#include <tw/timed_worker.hpp>
+#include <tw/worker_pool.hpp>
+
+#include <malloc.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    struct sample
+    {
+        long rss_kib = 0, vms_kib = 0, pss_kib = 0, anon_kib = 0, threads = 0;
+    };
+
+    long field(std::string const &file, char const *name)
+    {
+        std::ifstream in(file);
+        std::string line;
+        auto n = std::strlen(name);
+        while (std::getline(in, line))
+            if (line.compare(0, n, name) == 0 && line.size() > n && line[n] == ':')
+                return std::atol(line.c_str() + n + 1);
+        return 0;
+    }
+
+    sample take()
+    {
+        // hand memory freed by the previous ramp back first
+        malloc_trim(0);
+        return {field("/proc/self/status", "VmRSS"), field("/proc/self/status", "VmSize"),
+                field("/proc/self/smaps_rollup", "Pss"), field("/proc/self/smaps_rollup", "Anonymous"),
+                field("/proc/self/status", "Threads")};
+    }
+
+    // Live tasks block here until the ramp is torn down.
+    struct gate
+    {
+        std::atomic_bool open{false};
+        std::atomic<std::size_t> running{0};
+
+        void hold()
+        {
+            ++running;
+            open.wait(false);
+        }
+
+        void release()
+        {
+            open = true;
+            open.notify_all();
+        }
+    };
+
+    void report(char const *backend, char const *stack, std::size_t live, sample const &base, sample const &s)
+    {
+        auto per = [&](long now, long then)
+        { return live ? 1024.0 * static_cast<double>(now - then) / static_cast<double>(live) : 0.0; };
+        std::printf("%7s %7s %7zu %9ld %10ld %8ld %9ld %8ld %11.0f %11.0f %11.0f\n", backend, stack, live, s.rss_kib,
+                    s.vms_kib, s.threads, s.pss_kib, s.anon_kib, per(s.rss_kib, base.rss_kib),
+                    per(s.vms_kib, base.vms_kib), per(s.pss_kib, base.pss_kib));
+    }
+
+    void settle(gate const &g, std::size_t want)
+    {
+        auto until = std::chrono::steady_clock::now() + 5s;
+        while (g.running < want && std::chrono::steady_clock::now() < until)
+            std::this_thread::sleep_for(1ms);
+    }
+
+    // One TimedWorker, and so one thread, per live task.
+    void ramp_worker(std::vector<std::size_t> const &steps, char const *stack)
+    {
+        std::ostringstream sink;
+        gate g;
+        std::vector<tw::TimedWorker<std::ostringstream>> live;
+        live.reserve(steps.back());
+        auto base = take();
+        try
+        {
+            for (auto n : steps)
+            {
+                while (live.size() < n)
+                    live.push_back(tw::make_timed_worker(1h, 1s, [&g](std::stop_token)
+                                                         { g.hold(); }, sink));
+                settle(g, n);
+                report("worker", stack, n, base, take());
+            }
+        }
+        catch (std::system_error const &ex)
+        {
+            std::printf("%7s %7s stopped at %zu live: %s\n", "worker", stack, live.size(), ex.what());
+        }
+        g.release();
+    }
+
+    // A fixed set of threads; live tasks past the first few wait queued.
+    void ramp_pool(std::vector<std::size_t> const &steps, char const *stack)
+    {
+        std::ostringstream sink;
+        gate g;
+        auto base = take();
+        {
+            tw::worker_pool<std::ostringstream> pool(4, sink, 1s, steps.back());
+            std::size_t submitted = 0;
+            for (auto n : steps)
+            {
+                for (; submitted < n; ++submitted)
+                    pool.submit([&g](std::stop_token)
+                                { g.hold(); });
+                settle(g, std::min<std::size_t>(n, pool.size()));
+                report("pool", stack, n, base, take());
+            }
+            g.release();
+        }
+    }
+
+    // Each sealed batch holds one thread for all of its tasks; a batch can
+    // outgrow max_batch while the collector is descheduled.
+    void ramp_batch(std::vector<std::size_t> const &steps, char const *stack)
+    {
+        std::ostringstream sink;
+        gate g;
+        tw::batch_options opts;
+        opts.max_batch = 64;
+        opts.batch_budget = 1h;
+        opts.shutdown_grace = 1s;
+        auto base = take();
+        {
+            auto ex = tw::make_batch_executor(opts, sink);
+            std::vector<tw::batch_ticket> tickets;
+            tickets.reserve(steps.back());
+            for (auto n : steps)
+            {
+                while (tickets.size() < n)
+                    tickets.push_back(ex.submit([&g](std::stop_token)
+                                                { g.hold(); }));
+                ex.flush();
+                while (ex.stats().tasks < n)
+                    std::this_thread::sleep_for(1ms);
+                settle(g, ex.stats().batches);
+                report("batch", stack, n, base, take());
+            }
+            g.release();
+        }
+    }
+
+    // Sets the stack size std::thread gets; 0 restores the original.
+    void set_default_stack(std::size_t kib, pthread_attr_t const &original)
+    {
+        if (kib == 0)
+        {
+            pthread_setattr_default_np(&original);
+            return;
+        }
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, std::max<std::size_t>(kib * 1024, PTHREAD_STACK_MIN));
+        pthread_setattr_default_np(&attr);
+        pthread_attr_destroy(&attr);
+    }
+
+    bool flag(char const *arg, char const *name, std::string &value)
+    {
+        auto n = std::strlen(name);
+        if (std::strncmp(arg, name, n) != 0 || arg[n] != '=')
+            return false;
+        value = arg + n + 1;
+        return true;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::size_t max = 10'000, count = 5;
+    std::string stacks = "default,64,256", backend = "all";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string v;
+        if (flag(argv[i], "--max", v))
+            max = std::max<std::size_t>(std::strtoul(v.c_str(), nullptr, 10), 1);
+        else if (flag(argv[i], "--steps", v))
+            count = std::max<std::size_t>(std::strtoul(v.c_str(), nullptr, 10), 1);
+        else if (flag(argv[i], "--stacks", v))
+            stacks = v;
+        else if (flag(argv[i], "--backend", v))
+            backend = v;
+        else
+        {
+            std::fprintf(stderr, "unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    std::vector<std::size_t> steps;
+    for (std::size_t i = 1; i <= count; ++i)
+        steps.push_back(std::max<std::size_t>(max * i / count, 1));
+
+    pthread_attr_t original;
+    pthread_getattr_default_np(&original);
+
+    std::printf("%7s %7s %7s %9s %10s %8s %9s %8s %11s %11s %11s\n", "backend", "stack", "live", "rss_kib",
+                "vms_kib", "threads", "pss_kib", "anon_kib", "rss_B/live", "vms_B/live", "pss_B/live");
+    std::istringstream list(stacks);
+    for (std::string stack; std::getline(list, stack, ',');)
+    {
+        set_default_stack(stack == "default" ? 0 : std::strtoul(stack.c_str(), nullptr, 10), original);
+        if (backend == "all" || backend == "worker")
+            ramp_worker(steps, stack.c_str());
+        if (backend == "all" || backend == "pool")
+            ramp_pool(steps, stack.c_str());
+        if (backend == "all" || backend == "batch")
+            ramp_batch(steps, stack.c_str());
+    }
+    pthread_setattr_default_np(&original);
+    pthread_attr_destroy(&original);
+    return 0;
+}
@@ -0,0 +1,87 @@
+// Measures how precisely ~TimedWorker enforces small budgets: for each spin
+// window and budget, a worker that ignores its stop token is destroyed and
+// the time the destructor takes beyond the budget is recorded.
+#include <tw/timed_worker.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    struct gate
+    {
+        std::atomic_bool started{false};
+        std::atomic_bool release{false};
+        std::atomic_bool exited{false};
+    };
+
+    double percentile(std::vector<double> &v, double p)
+    {
+        std::sort(v.begin(), v.end());
+        auto i = static_cast<std::size_t>(p * static_cast<double>(v.size() - 1));
+        return v[i];
+    }
+
+    std::vector<double> measure(std::chrono::microseconds budget, int iterations)
+    {
+        std::vector<double> overshoot_us;
+        overshoot_us.reserve(iterations);
+        std::ostringstream sink;
+
+        for (int i = 0; i < iterations; ++i)
+        {
+            auto g = std::make_shared<gate>();
+            std::optional<tw::TimedWorker<std::ostringstream>> w;
+            w.emplace(tw::make_timed_worker(budget, [g](std::stop_token)
+                                            {
+                g->started = true;
+                g->release.wait(false);
+                g->exited = true; }, sink));
+            while (!g->started)
+                std::this_thread::yield();
+
+            auto t0 = Clock::now();
+            w.reset();
+            auto took = Clock::now() - t0;
+            overshoot_us.push_back(std::chrono::duration<double, std::micro>(took - budget).count());
+
+            g->release = true;
+            g->release.notify_all();
+            while (!g->exited)
+                std::this_thread::yield();
+        }
+        return overshoot_us;
+    }
+} // namespace
+
+int main()
+{
+    const std::chrono::nanoseconds windows[] = {0ns, 20us, 50us, 100us};
+    const std::chrono::microseconds budgets[] = {50us, 100us, 250us, 500us, 1000us, 5000us};
+    const int iterations = 200;
+
+    std::printf("%10s %10s %12s %12s %12s\n", "spin_us", "budget_us", "p50_over_us", "p99_over_us",
+                "max_over_us");
+    for (auto win : windows)
+    {
+        tw::set_spin_window(win);
+        for (auto budget : budgets)
+        {
+            auto v = measure(budget, iterations);
+            double p50 = percentile(v, 0.50), p99 = percentile(v, 0.99);
+            std::printf("%10.0f %10lld %12.1f %12.1f %12.1f\n", win.count() / 1000.0,
+                        static_cast<long long>(budget.count()), p50, p99, v.back());
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,402 @@
+// Replays a recorded workload (see tw::trace_recorder) against each
+// backend: one TimedWorker per task, a worker_pool, a batch_executor and
+// the cooperative slice_scheduler. Every recorded worker becomes a
+// synthetic task submitted at its recorded creation offset, with its
+// recorded timeout, that spins or sleeps for its recorded run time.
+// Workers that were detached ignore stop, so hangs are replayed too.
+//
+// usage: bench_trace_replay <trace.twtr> [--work=sleep|spin] [--threads=4]
+//            [--speed=1] [--backend=all|thread|pool|batch|sliced]
+//        bench_trace_replay --demo=<workers> [--save=<trace.twtr>] [...]
+// --demo records a synthetic workload with real TimedWorkers first.
+#include <tw/batch_executor.hpp>
+#include <tw/slice_scheduler.hpp>
+#include <tw/this_worker.hpp>
+#include <tw/timed_worker.hpp>
+#include <tw/trace.hpp>
+#include <tw/worker_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    struct options
+    {
+        std::string backend = "all";
+        std::size_t threads = 4;
+        double speed = 1;
+        bool spin = false;
+    };
+
+    struct task
+    {
+        tw::trace_record rec;
+        Clock::time_point submitted;
+        Clock::time_point deadline;
+        std::atomic_bool counted{false};
+    };
+
+    // Each task is counted once, by whoever settles it first.
+    struct tally
+    {
+        std::atomic<std::uint64_t> settled{0}, completed{0}, timed_out{0}, failed{0};
+        std::mutex mtx;
+        std::vector<double> latency_us;
+
+        void done(task &t)
+        {
+            auto now = Clock::now();
+            if (now > t.deadline)
+                return count(t, timed_out);
+            if (t.counted.exchange(true))
+                return;
+            ++completed;
+            {
+                std::lock_guard lk(mtx);
+                latency_us.push_back(std::chrono::duration<double, std::micro>(now - t.submitted).count());
+            }
+            ++settled;
+        }
+
+        void count(task &t, std::atomic<std::uint64_t> &kind)
+        {
+            if (t.counted.exchange(true))
+                return;
+            ++kind;
+            ++settled;
+        }
+
+        // Run by the task itself, for backends that only see their own
+        // stop_token.
+        void run(task &t, std::stop_token const &st, bool spin);
+    };
+
+    void work_for(Clock::duration d, bool spin)
+    {
+        auto end = Clock::now() + d;
+        if (!spin)
+            return std::this_thread::sleep_until(end);
+        while (Clock::now() < end)
+            ;
+    }
+
+    // Cooperative replay of one recorded run; false if stopped or late.
+    bool replay(task const &t, std::stop_token const &st, bool spin)
+    {
+        auto run = std::chrono::duration_cast<Clock::duration>(t.rec.run);
+        if (t.rec.outcome == tw::trace_outcome::detached)
+        {
+            work_for(run, spin);
+            return true;
+        }
+        auto end = Clock::now() + run;
+        for (auto now = Clock::now(); now < end; now = Clock::now())
+        {
+            if (st.stop_requested() || now >= t.deadline)
+                return false;
+            work_for(std::min<Clock::duration>(end - now, 50us), spin);
+        }
+        if (t.rec.outcome == tw::trace_outcome::failed)
+            throw std::runtime_error("replayed failure");
+        return true;
+    }
+
+    void tally::run(task &t, std::stop_token const &st, bool spin)
+    {
+        try
+        {
+            if (Clock::now() < t.deadline && replay(t, st, spin))
+                return done(t);
+            count(t, timed_out);
+        }
+        catch (...)
+        {
+            count(t, failed);
+        }
+    }
+
+        double percentile(std::vector<double> &v, double p)
+    {
+        if (v.empty())
+            return 0;
+        std::sort(v.begin(), v.end());
+        return v[static_cast<std::size_t>(p * static_cast<double>(v.size() - 1))];
+    }
+
+    // Submits each record at its recorded offset, then `drain` settles
+    // tasks the backend gave up on without running them.
+    void drive(char const *name, std::vector<tw::trace_record> const &trace, options const &o,
+               std::function<void(std::shared_ptr<task> const &, tally &)> submit,
+               std::function<void(tally &)> drain = {})
+    {
+        tally t;
+        auto detachedBefore = tw::detach_stats().detached;
+        auto start = Clock::now() + 10ms;
+        for (auto const &r : trace)
+        {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(r.created / o.speed));
+            auto tk = std::make_shared<task>();
+            tk->rec = r;
+            tk->submitted = Clock::now();
+            tk->deadline = tk->submitted + std::chrono::duration_cast<Clock::duration>(r.timeout);
+            submit(tk, t);
+        }
+        if (drain)
+            drain(t);
+        while (t.settled < trace.size())
+            std::this_thread::sleep_for(1ms);
+        auto makespan = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        auto n = static_cast<double>(std::max<std::size_t>(trace.size(), 1));
+        auto pct = [&](std::uint64_t v)
+        { return 100.0 * static_cast<double>(v) / n; };
+        std::printf("%8s %8zu %8.2f %8.2f %8.2f %8.2f %10.1f %10.1f %11.1f\n", name, trace.size(), pct(t.completed),
+                    pct(t.timed_out), pct(t.failed), pct(tw::detach_stats().detached - detachedBefore),
+                    percentile(t.latency_us, 0.50), percentile(t.latency_us, 0.99), makespan);
+    }
+
+    void run_thread(std::vector<tw::trace_record> const &trace, options const &o)
+    {
+        // handles are destroyed once their deadline has passed, off the
+        // submitting thread
+        std::ostringstream sink;
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<std::pair<Clock::time_point, tw::TimedWorker<std::ostringstream>>> live;
+        bool closed = false;
+        std::jthread reaper([&]
+                            {
+            for (;;)
+            {
+                std::unique_lock lk(mtx);
+                cv.wait(lk, [&] { return !live.empty() || closed; });
+                if (live.empty())
+                    return;
+                auto item = std::move(live.front());
+                live.pop_front();
+                lk.unlock();
+                item.second.wait_until(item.first);
+            } });
+
+        drive(
+            "thread", trace, o,
+            [&](std::shared_ptr<task> const &tk, tally &t)
+            {
+                auto w = tw::make_timed_worker(tk->rec.timeout, 1ms, [tk, &t, spin = o.spin](std::stop_token st)
+                                               { t.run(*tk, st, spin); }, sink);
+                {
+                    std::lock_guard lk(mtx);
+                    live.emplace_back(tk->deadline, std::move(w));
+                }
+                cv.notify_one();
+            },
+            [&](tally &)
+            {
+                {
+                    std::lock_guard lk(mtx);
+                    closed = true;
+                }
+                cv.notify_one();
+                reaper.join();
+            });
+    }
+
+    void run_pool(std::vector<tw::trace_record> const &trace, options const &o)
+    {
+        std::ostringstream sink;
+        tw::worker_pool<std::ostringstream> pool(o.threads, sink, 10ms, 1 << 16);
+        drive("pool", trace, o, [&](std::shared_ptr<task> const &tk, tally &t)
+              {
+            if (!pool.try_submit([tk, &t, spin = o.spin](std::stop_token st) { t.run(*tk, st, spin); }))
+                t.count(*tk, t.timed_out); });
+    }
+
+    void run_batch(std::vector<tw::trace_record> const &trace, options const &o)
+    {
+        std::ostringstream sink;
+        tw::batch_options opts;
+        opts.max_batch = 16;
+        opts.batch_budget = 100ms;
+        auto ex = tw::make_batch_executor(opts, sink);
+        std::vector<std::pair<std::shared_ptr<task>, tw::batch_ticket>> tickets;
+        drive(
+            "batch", trace, o,
+            [&](std::shared_ptr<task> const &tk, tally &t)
+            { tickets.emplace_back(tk, ex.submit([tk, &t, spin = o.spin](std::stop_token st)
+                                                 { t.run(*tk, st, spin); })); },
+            [&](tally &t)
+            {
+                // tasks left over when their batch ran out of time
+                for (auto &[tk, ticket] : tickets)
+                {
+                    ticket.wait();
+                    t.count(*tk, t.timed_out);
+                }
+            });
+    }
+
+    void run_sliced(std::vector<tw::trace_record> const &trace, options const &o)
+    {
+        tw::slice_scheduler sched({.threads = o.threads, .quantum = 1ms});
+        std::vector<std::pair<std::shared_ptr<task>, tw::slice_handle>> handles;
+        drive(
+            "sliced", trace, o,
+            [&](std::shared_ptr<task> const &tk, tally &t)
+            {
+                auto left = std::chrono::duration_cast<Clock::duration>(tk->rec.run);
+                auto step = [tk, &t, left, spin = o.spin](std::stop_token const &) mutable
+                {
+                    // a hung callable never reaches a yield point
+                    if (tk->rec.outcome == tw::trace_outcome::detached)
+                        work_for(std::exchange(left, Clock::duration::zero()), spin);
+                    while (left > Clock::duration::zero())
+                    {
+                        auto chunk = std::min<Clock::duration>(left, 50us);
+                        work_for(chunk, spin);
+                        left -= chunk;
+                        if (left > Clock::duration::zero() && tw::this_worker::yield_point())
+                            return tw::slice::yield;
+                    }
+                    if (tk->rec.outcome == tw::trace_outcome::failed)
+                        t.count(*tk, t.failed);
+                    else
+                        t.done(*tk);
+                    return tw::slice::done;
+                };
+                handles.emplace_back(tk, sched.spawn(std::move(step), tk->deadline));
+            },
+            [&](tally &t)
+            {
+                // tasks the scheduler stopped at their deadline
+                for (auto &[tk, h] : handles)
+                {
+                    h.wait();
+                    t.count(*tk, t.timed_out);
+                }
+            });
+    }
+
+    std::vector<tw::trace_record> record_demo(std::size_t workers)
+    {
+        // bursts of short requests, a slow tail and a few hangs
+        std::ostringstream sink;
+        std::mt19937_64 rng(7);
+        std::exponential_distribution<double> gap(1.0 / 300), svc(1.0 / 200);
+        std::uniform_real_distribution<double> coin(0, 1);
+        auto release = std::make_shared<std::atomic_bool>(false);
+
+        tw::trace_recorder rec;
+        rec.start();
+        {
+            std::vector<tw::TimedWorker<std::ostringstream>> ws;
+            for (std::size_t i = 0; i < workers; ++i)
+            {
+                std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(gap(rng)));
+                auto x = coin(rng);
+                auto run = std::chrono::duration<double, std::micro>(x < 0.9 ? svc(rng) : svc(rng) * 20);
+                bool hang = x > 0.998;
+                ws.push_back(tw::make_timed_worker(5ms, 1ms, [run, hang, release](std::stop_token st)
+                                                   {
+                    auto end = Clock::now() + std::chrono::duration_cast<Clock::duration>(run);
+                    while (Clock::now() < end && (hang || !st.stop_requested()))
+                        std::this_thread::sleep_for(50us);
+                    while (hang && !*release)
+                        std::this_thread::sleep_for(1ms); },
+                                                   sink));
+            }
+        }
+        rec.stop();
+        *release = true;
+        return rec.records();
+    }
+
+    bool flag(char const *arg, char const *name, std::string &value)
+    {
+        auto n = std::strlen(name);
+        if (std::strncmp(arg, name, n) != 0 || arg[n] != '=')
+            return false;
+        value = arg + n + 1;
+        return true;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    options o;
+    std::string file, save;
+    std::size_t demo = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string v;
+        if (flag(argv[i], "--work", v))
+            o.spin = v == "spin";
+        else if (flag(argv[i], "--threads", v))
+            o.threads = static_cast<std::size_t>(std::atoi(v.c_str()));
+        else if (flag(argv[i], "--speed", v))
+            o.speed = std::max(std::atof(v.c_str()), 1e-3);
+        else if (flag(argv[i], "--backend", v))
+            o.backend = v;
+        else if (flag(argv[i], "--demo", v))
+            demo = static_cast<std::size_t>(std::atol(v.c_str()));
+        else if (flag(argv[i], "--save", v))
+            save = v;
+        else if (argv[i][0] != '-')
+            file = argv[i];
+        else
+        {
+            std::fprintf(stderr, "unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (file.empty() && demo == 0)
+        demo = 2000;
+
+    std::vector<tw::trace_record> trace;
+    try
+    {
+        trace = demo ? record_demo(demo) : tw::load_trace(file);
+        if (!save.empty())
+            tw::save_trace(save, trace);
+    }
+    catch (std::exception const &ex)
+    {
+        std::fprintf(stderr, "%s\n", ex.what());
+        return 1;
+    }
+    std::sort(trace.begin(), trace.end(), [](auto const &a, auto const &b)
+              { return a.created < b.created; });
+
+    std::printf("replaying %zu workers, %zu bytes encoded\n", trace.size(), tw::encode_trace(trace).size());
+    std::printf("%8s %8s %8s %8s %8s %8s %10s %10s %11s\n", "backend", "tasks", "ok_%", "tmo_%", "fail_%",
+                "detach_%", "p50_us", "p99_us", "makespan_ms");
+    if (o.backend == "all" || o.backend == "thread")
+        run_thread(trace, o);
+    if (o.backend == "all" || o.backend == "pool")
+        run_pool(trace, o);
+    if (o.backend == "all" || o.backend == "batch")
+        run_batch(trace, o);
+    if (o.backend == "all" || o.backend == "sliced")
+        run_sliced(trace, o);
+    return 0;
+}
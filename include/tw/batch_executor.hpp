@@ -0,0 +1,349 @@
+#ifndef TW_BATCH_EXECUTOR_HPP
+#define TW_BATCH_EXECUTOR_HPP
+#pragma once
+
+#include <tw/detail/completion_flag.hpp>
+#include <tw/timed_result.hpp>
+#include <tw/timed_worker.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tw
+{
+    struct batch_options
+    {
+        // a batch is sealed once it holds this many tasks...
+        std::size_t max_batch{64};
+        // ...or once its first task has waited this long
+        std::chrono::nanoseconds linger{std::chrono::microseconds(100)};
+        // shared run deadline of a batch, counted from when it is sealed
+        std::chrono::nanoseconds batch_budget{std::chrono::milliseconds(10)};
+        // time a stopped batch gets to return before its worker is detached
+        std::chrono::nanoseconds shutdown_grace{std::chrono::milliseconds(10)};
+    };
+
+    namespace detail
+    {
+        struct batch_task
+        {
+            virtual ~batch_task() = default;
+            virtual void run(std::stop_token st) = 0;
+        };
+
+        template <class F>
+        struct batch_task_for final : batch_task
+        {
+            explicit batch_task_for(F f) : fn(std::move(f)) {}
+            void run(std::stop_token st) override { fn(std::move(st)); }
+            F fn;
+        };
+
+        // One completion structure per batch: every task of the batch
+        // reports through it, and a single flag publishes all outcomes.
+        struct batch_state
+        {
+            using Clock = std::chrono::steady_clock;
+
+            std::vector<std::unique_ptr<batch_task>> tasks;
+            std::vector<timed_status> status;
+            std::vector<std::exception_ptr> errors;
+            Clock::time_point deadline{};
+            completion_flag done;
+
+            void run(std::stop_token const &st)
+            {
+                std::size_t i = 0;
+                for (; i < tasks.size() && !st.stop_requested(); ++i)
+                {
+                    try
+                    {
+                        tasks[i]->run(st);
+                        status[i] = timed_status::completed;
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                        status[i] = timed_status::failed;
+                    }
+                }
+                finish_from(i);
+            }
+
+            void seal(Clock::time_point dl)
+            {
+                status.assign(tasks.size(), timed_status::stopped);
+                errors.assign(tasks.size(), nullptr);
+                deadline = dl;
+            }
+
+            // Tasks from `first` on never ran.
+            void finish_from(std::size_t first) noexcept
+            {
+                auto why = Clock::now() >= deadline ? timed_status::timed_out : timed_status::stopped;
+                std::fill(status.begin() + static_cast<std::ptrdiff_t>(first), status.end(), why);
+                tasks.clear();
+                done.set();
+            }
+        };
+
+        // Callable handed to the batch's worker. If the worker never gets to
+        // run it (stopped before the thread started), destroying it still
+        // completes the batch. Not while unwinding: a worker that failed to
+        // start is completed by BatchExecutor::launch instead.
+        struct batch_runner
+        {
+            explicit batch_runner(std::shared_ptr<batch_state> b) noexcept : batch(std::move(b)) {}
+            batch_runner(batch_runner &&) noexcept = default;
+            batch_runner &operator=(batch_runner &&) = delete;
+
+            ~batch_runner()
+            {
+                if (batch && !batch->done.is_set() && std::uncaught_exceptions() == 0)
+                    batch->finish_from(0);
+            }
+
+            void operator()(std::stop_token st) { batch->run(st); }
+
+            std::shared_ptr<batch_state> batch;
+        };
+
+        inline batch_options normalized(batch_options o) noexcept
+        {
+            o.max_batch = std::max<std::size_t>(o.max_batch, 1);
+            return o;
+        }
+    } // namespace detail
+
+    // Per-task view of a batch outcome.
+    class batch_ticket
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        batch_ticket() = default;
+        batch_ticket(std::shared_ptr<detail::batch_state> b, std::size_t index) noexcept
+            : _batch(std::move(b)), _index(index)
+        {
+        }
+
+        bool valid() const noexcept { return _batch != nullptr; }
+        bool ready() const noexcept { return _batch && _batch->done.is_set(); }
+
+        // wait(), wait_until() and result() require a valid() ticket.
+        void wait() const noexcept
+        {
+            assert(valid() && "batch_ticket::wait() on a default-constructed ticket");
+            _batch->done.wait();
+        }
+
+        bool wait_until(Clock::time_point tp) const noexcept
+        {
+            assert(valid() && "batch_ticket::wait_until() on a default-constructed ticket");
+            return _batch->done.wait_until(tp);
+        }
+
+        template <class Rep, class Period>
+        bool wait_for(std::chrono::duration<Rep, Period> d) const noexcept
+        {
+            return wait_until(detail::add_sat(Clock::now(), detail::to_worker_duration(d)));
+        }
+
+        // Blocks until the batch has finished.
+        timed_result<void> result() const
+        {
+            wait();
+            if (auto const &err = _batch->errors[_index])
+                return timed_result<void>(err);
+            return timed_result<void>(_batch->status[_index]);
+        }
+
+    private:
+        std::shared_ptr<detail::batch_state> _batch;
+        std::size_t _index{0};
+    };
+
+    struct batch_stats
+    {
+        std::uint64_t tasks{0};
+        std::uint64_t batches{0};
+    };
+
+    template <class LogS = std::ostream>
+    auto make_batch_executor(batch_options const &opts, LogS &ls = std::cerr);
+
+    // Groups small tasks into batches and runs each batch on one TimedWorker
+    // under a shared deadline, so the thread, the timer and the completion
+    // signal are paid once per batch rather than once per task. Tasks of a
+    // batch run in submission order; once the batch deadline passes the
+    // remaining ones are reported as timed_out without running.
+    //
+    // Destruction stops the batches in flight (each gets shutdown_grace) and
+    // reports tasks that were never sealed into a batch as stopped.
+    template <class LogStream = std::ostream>
+    class BatchExecutor
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        template <class LogS>
+        friend auto make_batch_executor(batch_options const &opts, LogS &ls);
+
+        template <class F>
+            requires std::invocable<std::decay_t<F> &, std::stop_token>
+        batch_ticket submit(F &&f)
+        {
+            auto task = std::make_unique<detail::batch_task_for<std::decay_t<F>>>(std::forward<F>(f));
+            bool wake;
+            batch_ticket ticket;
+            {
+                std::lock_guard lk(_mtx);
+                if (!_open)
+                {
+                    _open = std::make_shared<detail::batch_state>();
+                    _open->tasks.reserve(_opts.max_batch);
+                    _openedAt = Clock::now();
+                }
+                ticket = batch_ticket(_open, _open->tasks.size());
+                _open->tasks.push_back(std::move(task));
+                // the collector only cares about the first task and a full batch
+                wake = _open->tasks.size() == 1 || _open->tasks.size() >= _opts.max_batch;
+            }
+            if (wake)
+                _cv.notify_one();
+            return ticket;
+        }
+
+        // Seals the open batch without waiting for the linger time.
+        void flush()
+        {
+            {
+                std::lock_guard lk(_mtx);
+                if (!_open)
+                    return;
+                _flush = true;
+            }
+            _cv.notify_one();
+        }
+
+        batch_stats stats() const noexcept
+        {
+            return {_tasks.load(std::memory_order_relaxed), _batches.load(std::memory_order_relaxed)};
+        }
+
+        BatchExecutor(const BatchExecutor &) = delete;
+        BatchExecutor &operator=(const BatchExecutor &) = delete;
+
+        ~BatchExecutor()
+        {
+            _thr.request_stop();
+            _cv.notify_all();
+            _thr.join();
+            if (_open)
+            {
+                _open->seal(Clock::time_point::max());
+                _open->finish_from(0);
+            }
+        }
+
+    private:
+        BatchExecutor(batch_options const &opts, LogStream &log)
+            : _opts(detail::normalized(opts)), _log(log), _thr([this](std::stop_token st)
+                                                               { collect(st); })
+        {
+        }
+
+        void collect(std::stop_token st)
+        {
+            std::list<TimedWorker<LogStream>> inflight;
+            std::unique_lock lk(_mtx);
+            while (!st.stop_requested())
+            {
+                _cv.wait(lk, st, [this]
+                         { return _open != nullptr; });
+                if (st.stop_requested())
+                    break;
+
+                _cv.wait_until(lk, st, _openedAt + _opts.linger, [this]
+                               { return _flush || _open->tasks.size() >= _opts.max_batch; });
+                if (st.stop_requested())
+                    break;
+
+                auto batch = std::move(_open);
+                _open.reset();
+                _flush = false;
+                lk.unlock();
+
+                launch(inflight, std::move(batch));
+                // a hung batch must not keep later finished ones alive
+                inflight.remove_if([](const TimedWorker<LogStream> &w)
+                                   { return w.done(); });
+
+                lk.lock();
+            }
+            // inflight workers are stopped and joined (or detached) here
+        }
+
+        void launch(std::list<TimedWorker<LogStream>> &inflight, std::shared_ptr<detail::batch_state> batch)
+        {
+            batch->seal(detail::add_sat(Clock::now(), detail::to_worker_duration(_opts.batch_budget)));
+
+            _tasks.fetch_add(batch->tasks.size(), std::memory_order_relaxed);
+            _batches.fetch_add(1, std::memory_order_relaxed);
+
+            try
+            {
+                inflight.push_back(make_timed_worker(batch->deadline, _opts.shutdown_grace,
+                                                     detail::batch_runner(batch), _log));
+            }
+            catch (...)
+            {
+                if (!batch->done.is_set())
+                    batch->finish_from(0);
+                try
+                {
+                    _log << "[BatchExecutor] failed to start batch worker\n";
+                }
+                catch (...)
+                {
+                }
+            }
+        }
+
+        batch_options _opts;
+        LogStream &_log;
+        std::mutex _mtx;
+        std::condition_variable_any _cv;
+        std::shared_ptr<detail::batch_state> _open;
+        Clock::time_point _openedAt{};
+        bool _flush{false};
+        std::atomic<std::uint64_t> _tasks{0};
+        std::atomic<std::uint64_t> _batches{0};
+        // declared last: the thread starts running as soon as it is constructed
+        std::jthread _thr;
+    };
+
+    template <class LogS>
+    auto make_batch_executor(batch_options const &opts, LogS &ls)
+    {
+        return BatchExecutor<LogS>(opts, ls);
+    }
+
+} // namespace tw
+
+#endif // TW_BATCH_EXECUTOR_HPP
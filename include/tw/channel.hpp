@@ -0,0 +1,317 @@
+#ifndef TW_CHANNEL_HPP
+#define TW_CHANNEL_HPP
+#pragma once
+
+#include <tw/detail/event_count.hpp>
+#include <tw/timed_worker.hpp>
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+
+namespace tw
+{
+    enum class channel_status : std::uint8_t
+    {
+        ok,
+        empty,
+        full,
+        closed,
+        stopped,
+        timed_out
+    };
+
+    namespace detail
+    {
+        inline constexpr std::size_t cache_line = 64;
+
+        struct wake_event
+        {
+            event_count *ev;
+            void operator()() const noexcept { ev->wake(); }
+        };
+    } // namespace detail
+
+    // Bounded multi-producer/multi-consumer ring (Vyukov's sequence-number
+    // design): each cell carries a sequence that tells producers and
+    // consumers whose turn it is, so try_push/try_pop are lock-free and
+    // touch one cache line each. Cells and the two cursors are padded to
+    // separate cache lines.
+    //
+    // The blocking push/pop take the caller's stop_token and deadline and
+    // return stopped/timed_out promptly, so a stalled peer cannot hold a
+    // timed worker past its budget. They spin on the fast path and park on
+    // a futex only when the ring stays full/empty.
+    template <class T>
+    class channel
+    {
+        static_assert(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T>,
+                      "a claimed slot must always be filled");
+
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // Capacity is rounded up to a power of two.
+        explicit channel(std::size_t capacity)
+            : _mask(std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity) - 1),
+              _cells(std::make_unique<cell[]>(_mask + 1))
+        {
+            for (std::size_t i = 0; i <= _mask; ++i)
+                _cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        channel(const channel &) = delete;
+        channel &operator=(const channel &) = delete;
+
+        ~channel()
+        {
+            auto h = _head.pos.load(std::memory_order_relaxed);
+            auto t = _tail.pos.load(std::memory_order_relaxed);
+            for (; h != t; ++h)
+                _cells[h & _mask].ptr()->~T();
+        }
+
+        std::size_t capacity() const noexcept { return _mask + 1; }
+
+        // Approximate while producers/consumers are active.
+        std::size_t size() const noexcept
+        {
+            auto t = _tail.pos.load(std::memory_order_acquire);
+            auto h = _head.pos.load(std::memory_order_acquire);
+            return t > h ? t - h : 0;
+        }
+
+        // Wakes every blocked caller; pushes fail from now on, pops drain
+        // what is left and then report closed.
+        void close() noexcept
+        {
+            _closed.store(true, std::memory_order_release);
+            _notEmpty.wake();
+            _notFull.wake();
+        }
+
+        bool closed() const noexcept { return _closed.load(std::memory_order_acquire); }
+
+        // ---- non-blocking ---------------------------------------------------
+
+        channel_status try_push(T &&v) { return try_push_impl(v); }
+
+        // The copy is made before a slot is claimed; a throwing copy leaves
+        // the channel unchanged.
+        channel_status try_push(T const &v)
+        {
+            T copy(v);
+            return try_push_impl(copy);
+        }
+
+        channel_status try_pop(T &out)
+        {
+            return try_pop_with([&](T &&v) noexcept
+                                { out = std::move(v); });
+        }
+
+        // ---- blocking, stop- and deadline-aware ----------------------------
+        // On failure the argument is left untouched.
+
+        channel_status push(T &&v, std::stop_token st = {}, Clock::time_point deadline = Clock::time_point::max())
+        {
+            return blocking(_notFull, st, deadline, [&]
+                            { return try_push(std::move(v)); }, channel_status::full);
+        }
+
+        channel_status push(T const &v, std::stop_token st = {}, Clock::time_point deadline = Clock::time_point::max())
+        {
+            T copy(v);
+            return push(std::move(copy), std::move(st), deadline);
+        }
+
+        channel_status pop(T &out, std::stop_token st = {}, Clock::time_point deadline = Clock::time_point::max())
+        {
+            return blocking(_notEmpty, st, deadline, [&]
+                            { return try_pop(out); }, channel_status::empty);
+        }
+
+        template <class Rep, class Period>
+        channel_status push(T &&v, std::stop_token st, std::chrono::duration<Rep, Period> timeout)
+        {
+            return push(std::move(v), std::move(st), relative(timeout));
+        }
+
+        template <class Rep, class Period>
+        channel_status push(T const &v, std::stop_token st, std::chrono::duration<Rep, Period> timeout)
+        {
+            return push(v, std::move(st), relative(timeout));
+        }
+
+        template <class Rep, class Period>
+        channel_status pop(T &out, std::stop_token st, std::chrono::duration<Rep, Period> timeout)
+        {
+            return pop(out, std::move(st), relative(timeout));
+        }
+
+        // Convenience form; nullopt carries no reason, use pop(T&, ...) for it.
+        std::optional<T> pop(std::stop_token st = {}, Clock::time_point deadline = Clock::time_point::max())
+        {
+            std::optional<T> out;
+            blocking(_notEmpty, st, deadline, [&]
+                     { return try_pop_with([&](T &&v) noexcept
+                                           { out.emplace(std::move(v)); }); },
+                     channel_status::empty);
+            return out;
+        }
+
+    private:
+        struct alignas(detail::cache_line) cell
+        {
+            std::atomic<std::size_t> seq{0};
+            alignas(T) unsigned char storage[sizeof(T)];
+
+            T *ptr() noexcept { return std::launder(reinterpret_cast<T *>(storage)); }
+        };
+
+        struct alignas(detail::cache_line) cursor
+        {
+            std::atomic<std::size_t> pos{0};
+        };
+
+        template <class Rep, class Period>
+        static Clock::time_point relative(std::chrono::duration<Rep, Period> d) noexcept
+        {
+            return detail::add_sat(Clock::now(), detail::to_worker_duration(d));
+        }
+
+        // Moves from v only on success.
+        channel_status try_push_impl(T &v)
+        {
+            if (closed())
+                return channel_status::closed;
+
+            auto pos = _tail.pos.load(std::memory_order_relaxed);
+            cell *c;
+            for (;;)
+            {
+                c = &_cells[pos & _mask];
+                auto seq = c->seq.load(std::memory_order_acquire);
+                auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+                if (diff == 0)
+                {
+                    if (_tail.pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                {
+                    return channel_status::full;
+                }
+                else
+                {
+                    pos = _tail.pos.load(std::memory_order_relaxed);
+                }
+            }
+
+            ::new (static_cast<void *>(c->storage)) T(std::move(v));
+            c->seq.store(pos + 1, std::memory_order_release);
+            _notEmpty.notify();
+            return channel_status::ok;
+        }
+
+        template <class Sink>
+        channel_status try_pop_with(Sink &&sink)
+        {
+            if (pop_cell(sink))
+            {
+                _notFull.notify();
+                return channel_status::ok;
+            }
+            return closed() && size() == 0 ? channel_status::closed : channel_status::empty;
+        }
+
+        template <class Sink>
+        bool pop_cell(Sink &sink)
+        {
+            auto pos = _head.pos.load(std::memory_order_relaxed);
+            cell *c;
+            for (;;)
+            {
+                c = &_cells[pos & _mask];
+                auto seq = c->seq.load(std::memory_order_acquire);
+                auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+                if (diff == 0)
+                {
+                    if (_head.pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = _head.pos.load(std::memory_order_relaxed);
+                }
+            }
+
+            sink(std::move(*c->ptr()));
+            c->ptr()->~T();
+            c->seq.store(pos + _mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        template <class Try>
+        channel_status blocking(detail::event_count &ev, std::stop_token const &st, Clock::time_point deadline,
+                                Try &&attempt, channel_status busy)
+        {
+            constexpr int spins = 64;
+            for (int i = 0; i < spins; ++i)
+            {
+                auto s = attempt();
+                if (s != busy)
+                    return s;
+                detail::cpu_relax();
+            }
+
+            std::optional<std::stop_callback<detail::wake_event>> onStop;
+            if (st.stop_possible())
+                onStop.emplace(st, detail::wake_event{&ev});
+
+            for (;;)
+            {
+                auto key = ev.prepare_wait();
+                auto s = attempt();
+                if (s != busy)
+                {
+                    ev.cancel_wait();
+                    return s;
+                }
+                if (st.stop_requested())
+                {
+                    ev.cancel_wait();
+                    return channel_status::stopped;
+                }
+                if (!ev.wait_until(key, deadline))
+                {
+                    s = attempt();
+                    return s != busy ? s : channel_status::timed_out;
+                }
+            }
+        }
+
+        const std::size_t _mask;
+        std::unique_ptr<cell[]> _cells;
+        cursor _head;
+        cursor _tail;
+        std::atomic_bool _closed{false};
+        detail::event_count _notEmpty;
+        detail::event_count _notFull;
+    };
+
+} // namespace tw
+
+#endif // TW_CHANNEL_HPP
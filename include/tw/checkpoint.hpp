@@ -0,0 +1,385 @@
+#ifndef TW_CHECKPOINT_HPP
+#define TW_CHECKPOINT_HPP
+#pragma once
+
+#include <tw/timed_worker.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TW_CHECKPOINT_MMAP 1
+#endif
+
+namespace tw
+{
+    namespace detail
+    {
+#if defined(TW_CHECKPOINT_MMAP)
+        // One mmap'd file per key: a header plus two payload slots. A save
+        // goes to the slot not holding the latest state and then bumps the
+        // sequence number, so a crash in mid-save leaves the previous
+        // checkpoint intact.
+        class checkpoint_file
+        {
+        public:
+            static constexpr std::uint64_t magic = 0x7477636b70740001ULL;
+
+            checkpoint_file(std::filesystem::path const &p, std::size_t payload)
+                : _payload(payload), _bytes(header_size + 2 * payload)
+            {
+                _fd = ::open(p.c_str(), O_RDWR | O_CREAT, 0644);
+                if (_fd < 0)
+                    throw std::system_error(errno, std::generic_category(), "tw::checkpoint: open " + p.string());
+
+                struct stat sb{};
+                bool fresh = ::fstat(_fd, &sb) != 0 || static_cast<std::size_t>(sb.st_size) != _bytes;
+                if (fresh && ::ftruncate(_fd, 0) != 0)
+                    fail("ftruncate");
+                if (fresh && ::ftruncate(_fd, static_cast<off_t>(_bytes)) != 0)
+                    fail("ftruncate");
+
+                void *m = ::mmap(nullptr, _bytes, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+                if (m == MAP_FAILED)
+                    fail("mmap");
+                _map = static_cast<std::byte *>(m);
+
+                if (fresh || hdr().magic != magic || hdr().size != payload)
+                {
+                    hdr().magic = magic;
+                    hdr().size = payload;
+                    hdr().seq = 0;
+                }
+            }
+
+            checkpoint_file(const checkpoint_file &) = delete;
+            checkpoint_file &operator=(const checkpoint_file &) = delete;
+
+            ~checkpoint_file()
+            {
+                if (_map)
+                    ::munmap(_map, _bytes);
+                if (_fd >= 0)
+                    ::close(_fd);
+            }
+
+            bool read(std::span<std::byte> out) const
+            {
+                auto seq = hdr().seq;
+                if (seq == 0 || out.size() != _payload)
+                    return false;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                std::memcpy(out.data(), slot(seq & 1), _payload);
+                return true;
+            }
+
+            void write(std::span<const std::byte> in)
+            {
+                auto next = hdr().seq + 1;
+                std::memcpy(slot(next & 1), in.data(), _payload);
+                std::atomic_thread_fence(std::memory_order_release);
+                hdr().seq = next;
+                ::msync(_map, _bytes, MS_ASYNC);
+            }
+
+            std::size_t payload() const noexcept { return _payload; }
+
+            // True if the file at p holds a checkpoint with this payload
+            // size. Only reads the header; never creates or resizes.
+            static bool holds(std::filesystem::path const &p, std::size_t payload)
+            {
+                int fd = ::open(p.c_str(), O_RDONLY);
+                if (fd < 0)
+                    return false;
+                struct stat sb{};
+                header h{};
+                bool ok = ::fstat(fd, &sb) == 0 &&
+                          static_cast<std::size_t>(sb.st_size) == header_size + 2 * payload &&
+                          ::pread(fd, &h, sizeof h, 0) == static_cast<ssize_t>(sizeof h) && h.magic == magic &&
+                          h.size == payload;
+                ::close(fd);
+                return ok;
+            }
+
+        private:
+            struct header
+            {
+                std::uint64_t magic;
+                std::uint64_t size;
+                std::uint64_t seq;
+            };
+            static constexpr std::size_t header_size = 64;
+
+            [[noreturn]] void fail(char const *what)
+            {
+                int err = errno;
+                if (_fd >= 0)
+                    ::close(_fd);
+                throw std::system_error(err, std::generic_category(), std::string("tw::checkpoint: ") + what);
+            }
+
+            header &hdr() const noexcept { return *reinterpret_cast<header *>(_map); }
+            std::byte *slot(std::uint64_t i) const noexcept { return _map + header_size + i * _payload; }
+
+            std::size_t _payload;
+            std::size_t _bytes;
+            int _fd{-1};
+            std::byte *_map{nullptr};
+        };
+#endif
+
+        struct checkpoint_shared
+        {
+            std::mutex mtx;
+            std::optional<std::filesystem::path> dir;
+            std::unordered_map<std::string, std::vector<std::byte>> memory;
+#if defined(TW_CHECKPOINT_MMAP)
+            std::unordered_map<std::string, std::unique_ptr<checkpoint_file>> files;
+#endif
+        };
+    } // namespace detail
+
+    // Keyed store of job checkpoints. A default-constructed store keeps them
+    // in memory for the life of the process. A store opened on a directory
+    // writes each key to an mmap'd file in it, so checkpoints survive a
+    // restart of the process (not a power loss). Without mmap (anything but
+    // POSIX systems) the directory is ignored and checkpoints stay in
+    // memory, lost with the process. Copies share the same store. Safe to
+    // use from several threads.
+    class checkpoint_store
+    {
+    public:
+        checkpoint_store() : _s(std::make_shared<detail::checkpoint_shared>()) {}
+
+        // In-memory only where mmap is unavailable (see above).
+        explicit checkpoint_store(std::filesystem::path dir) : checkpoint_store()
+        {
+#if defined(TW_CHECKPOINT_MMAP)
+            std::filesystem::create_directories(dir);
+            _s->dir = std::move(dir);
+#endif
+        }
+
+        // Fills `out` if a checkpoint of exactly that size exists. Never
+        // modifies the store; a checkpoint of another size is left for
+        // save() to replace.
+        bool load(std::string const &key, std::span<std::byte> out) const
+        {
+            std::lock_guard lk(_s->mtx);
+#if defined(TW_CHECKPOINT_MMAP)
+            if (_s->dir)
+            {
+                if (auto it = _s->files.find(key); it != _s->files.end())
+                    return it->second->payload() == out.size() && it->second->read(out);
+                if (!detail::checkpoint_file::holds(path(key), out.size()))
+                    return false;
+                return file(key, out.size()).read(out);
+            }
+#endif
+            auto it = _s->memory.find(key);
+            if (it == _s->memory.end() || it->second.size() != out.size())
+                return false;
+            std::memcpy(out.data(), it->second.data(), out.size());
+            return true;
+        }
+
+        void save(std::string const &key, std::span<const std::byte> in)
+        {
+            std::lock_guard lk(_s->mtx);
+#if defined(TW_CHECKPOINT_MMAP)
+            if (_s->dir)
+                return file(key, in.size()).write(in);
+#endif
+            _s->memory[key].assign(in.begin(), in.end());
+        }
+
+        void erase(std::string const &key)
+        {
+            std::lock_guard lk(_s->mtx);
+            _s->memory.erase(key);
+#if defined(TW_CHECKPOINT_MMAP)
+            if (_s->dir)
+            {
+                _s->files.erase(key);
+                std::error_code ec;
+                std::filesystem::remove(path(key), ec);
+            }
+#endif
+        }
+
+        template <class T>
+            requires std::is_trivially_copyable_v<T>
+        std::optional<T> get(std::string const &key) const
+        {
+            T v;
+            if (!load(key, std::as_writable_bytes(std::span(&v, 1))))
+                return std::nullopt;
+            return v;
+        }
+
+        template <class T>
+            requires std::is_trivially_copyable_v<T>
+        void put(std::string const &key, T const &v)
+        {
+            save(key, std::as_bytes(std::span(&v, 1)));
+        }
+
+    private:
+#if defined(TW_CHECKPOINT_MMAP)
+        std::filesystem::path path(std::string const &key) const
+        {
+            // keep [a-z0-9.-] and write every other byte, '_' included, as
+            // _XX: distinct keys never share a file, even on a
+            // case-insensitive file system
+            static constexpr char hex[] = "0123456789abcdef";
+            std::string name;
+            name.reserve(key.size());
+            for (unsigned char c : key)
+            {
+                if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '.')
+                {
+                    name += static_cast<char>(c);
+                }
+                else
+                {
+                    name += '_';
+                    name += hex[c >> 4];
+                    name += hex[c & 0xf];
+                }
+            }
+            return *_s->dir / (name + ".ckpt");
+        }
+
+        // Maps the key's file, recreating it if the payload size changed;
+        // only save() calls it with a size the file may not hold.
+        detail::checkpoint_file &file(std::string const &key, std::size_t payload) const
+        {
+            auto &f = _s->files[key];
+            if (!f || f->payload() != payload)
+                f = std::make_unique<detail::checkpoint_file>(path(key), payload);
+            return *f;
+        }
+#endif
+
+        std::shared_ptr<detail::checkpoint_shared> _s;
+    };
+
+    // Handle a checkpointed worker's callable works through: the state to
+    // mutate, already restored when an earlier run left a checkpoint.
+    template <class T>
+    class checkpoint
+    {
+    public:
+        checkpoint(checkpoint_store store, std::string key)
+            : _store(std::move(store)), _key(std::move(key))
+        {
+            _resumed = _store.load(_key, std::as_writable_bytes(std::span(&_state, 1)));
+        }
+
+        checkpoint(const checkpoint &) = delete;
+        checkpoint &operator=(const checkpoint &) = delete;
+
+        T &state() noexcept { return _state; }
+        bool resumed() const noexcept { return _resumed; }
+        std::string const &key() const noexcept { return _key; }
+
+        // Saves now; for periodic checkpoints from inside long loops.
+        void save() { _store.save(_key, std::as_bytes(std::span(&_state, 1))); }
+
+        // The job is done: drops the checkpoint so the next run starts over.
+        void complete() noexcept { _completed = true; }
+        bool completed() const noexcept { return _completed; }
+
+    private:
+        checkpoint_store _store;
+        std::string _key;
+        T _state{};
+        bool _resumed{false};
+        bool _completed{false};
+    };
+
+    namespace detail
+    {
+        // Saves whatever the callable reached when it returns (stop, timeout
+        // or exception alike), on the worker thread, so the snapshot is never
+        // taken while the state is being mutated.
+        template <class T, class F>
+        struct checkpoint_runner
+        {
+            void operator()(std::stop_token st)
+            {
+                checkpoint<T> cp(store, key);
+                struct finish
+                {
+                    checkpoint<T> &cp;
+                    checkpoint_store &store;
+                    ~finish()
+                    {
+                        try
+                        {
+                            if (cp.completed())
+                                store.erase(cp.key());
+                            else
+                                cp.save();
+                        }
+                        catch (...)
+                        {
+                        }
+                    }
+                } guard{cp, store};
+                fn(st, cp);
+            }
+
+            checkpoint_store store;
+            std::string key;
+            F fn;
+        };
+    } // namespace detail
+
+    // Runs f(std::stop_token, tw::checkpoint<T>&, args...) on a TimedWorker
+    // that is stopped after `timeout` and given as long again to return.
+    // The state reached by then is stored under `key`; a later worker with
+    // the same key and store resumes from it. T must be trivially copyable.
+    template <class T, class LogS = std::ostream, class Rep, class Period, class F, class... Args>
+        requires std::is_trivially_copyable_v<T> &&
+                 std::invocable<std::decay_t<F> &, std::stop_token, checkpoint<T> &, std::decay_t<Args> &...>
+    auto make_checkpointed_worker(checkpoint_store store, std::string key, std::chrono::duration<Rep, Period> timeout,
+                                  F &&f, LogS &ls = std::cerr, Args &&...args)
+    {
+        auto bound = [func = std::forward<F>(f), tup = std::make_tuple(std::forward<Args>(args)...)](
+                         std::stop_token st, checkpoint<T> &cp) mutable
+        {
+            std::apply([&](auto &...cur)
+                       { func(st, cp, cur...); }, tup);
+        };
+        return make_timed_worker(timeout, timeout,
+                                 detail::checkpoint_runner<T, decltype(bound)>{std::move(store), std::move(key), std::move(bound)},
+                                 ls);
+    }
+
+} // namespace tw
+
+#endif // TW_CHECKPOINT_HPP
@@ -0,0 +1,178 @@
+#ifndef TW_DETAIL_DETACH_BUDGET_HPP
+#define TW_DETAIL_DETACH_BUDGET_HPP
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <system_error>
+
+namespace tw
+{
+    // What make_timed_worker does while the detached-thread cap is reached.
+    // block and run_inline do so on the calling thread, so a worker must
+    // not be created from a timer callback or under a lock its callable
+    // (or anyone else it keeps waiting) needs.
+    enum class detach_policy : std::uint8_t
+    {
+        // throw std::system_error(resource_unavailable_try_again)
+        reject,
+        // wait up to block_timeout for detached threads to return, then reject
+        block,
+        // run the callable on the caller's thread until its run deadline
+        // (or creation + timeout); workers with neither are rejected
+        run_inline
+    };
+
+    struct detach_budget_options
+    {
+        // detached threads allowed to be still running; 0 means no limit
+        std::size_t max_detached{0};
+        detach_policy policy{detach_policy::reject};
+        std::chrono::nanoseconds block_timeout{std::chrono::milliseconds(100)};
+    };
+
+    struct detach_metrics
+    {
+        // detached threads that have not returned yet
+        std::size_t running{0};
+        std::size_t peak{0};
+        std::size_t limit{0};
+        std::uint64_t detached{0};
+        std::uint64_t rejected{0};
+        // workers admitted only after waiting
+        std::uint64_t blocked{0};
+        std::uint64_t ran_inline{0};
+    };
+
+    namespace detail
+    {
+        // Process-wide count of detached-but-running worker threads. The
+        // common case, no limit or room left, is two relaxed loads.
+        class detach_budget
+        {
+        public:
+            // Leaked: detached threads may return during static destruction.
+            static detach_budget &global()
+            {
+                static auto *b = new detach_budget;
+                return *b;
+            }
+
+            void configure(detach_budget_options const &opts)
+            {
+                {
+                    std::lock_guard lk(_mtx);
+                    _policy = opts.policy;
+                    _blockFor = opts.block_timeout;
+                    _limit.store(opts.max_detached, std::memory_order_relaxed);
+                }
+                _cv.notify_all();
+            }
+
+            // True to start a thread, false to run inline; throws when the
+            // worker is rejected.
+            bool admit(bool can_inline)
+            {
+                auto limit = _limit.load(std::memory_order_relaxed);
+                if (limit == 0 || _running.load(std::memory_order_relaxed) < limit)
+                    return true;
+
+                std::unique_lock lk(_mtx);
+                switch (_policy)
+                {
+                case detach_policy::block:
+                {
+                    ++_waiters;
+                    bool room = _cv.wait_for(lk, _blockFor, [this]
+                                             { return has_room(); });
+                    --_waiters;
+                    if (room)
+                    {
+                        ++_blocked;
+                        return true;
+                    }
+                    break;
+                }
+                case detach_policy::run_inline:
+                    if (has_room())
+                        return true;
+                    if (can_inline)
+                    {
+                        ++_inline;
+                        return false;
+                    }
+                    break;
+                case detach_policy::reject:
+                    if (has_room())
+                        return true;
+                    break;
+                }
+                ++_rejected;
+                throw std::system_error(std::make_error_code(std::errc::resource_unavailable_try_again),
+                                        "tw: detached thread budget exhausted");
+            }
+
+            void acquire() noexcept
+            {
+                auto n = _running.fetch_add(1, std::memory_order_relaxed) + 1;
+                _detached.fetch_add(1, std::memory_order_relaxed);
+                auto peak = _peak.load(std::memory_order_relaxed);
+                while (peak < n && !_peak.compare_exchange_weak(peak, n, std::memory_order_relaxed))
+                    ;
+            }
+
+            void release() noexcept
+            {
+                _running.fetch_sub(1, std::memory_order_relaxed);
+                std::lock_guard lk(_mtx);
+                // each waiter re-checks has_room(); a single wakeup could go
+                // to one that then finds the slot taken by a non-waiter
+                if (_waiters)
+                    _cv.notify_all();
+            }
+
+            detach_metrics metrics() const
+            {
+                std::lock_guard lk(_mtx);
+                return {_running.load(std::memory_order_relaxed), _peak.load(std::memory_order_relaxed),
+                        _limit.load(std::memory_order_relaxed), _detached.load(std::memory_order_relaxed),
+                        _rejected, _blocked, _inline};
+            }
+
+        private:
+            detach_budget() = default;
+
+            bool has_room() const noexcept
+            {
+                auto limit = _limit.load(std::memory_order_relaxed);
+                return limit == 0 || _running.load(std::memory_order_relaxed) < limit;
+            }
+
+            mutable std::mutex _mtx;
+            std::condition_variable _cv;
+            std::atomic<std::size_t> _limit{0};
+            std::atomic<std::size_t> _running{0};
+            std::atomic<std::size_t> _peak{0};
+            std::atomic<std::uint64_t> _detached{0};
+            detach_policy _policy{detach_policy::reject};
+            std::chrono::nanoseconds _blockFor{0};
+            std::size_t _waiters{0};
+            std::uint64_t _rejected{0};
+            std::uint64_t _blocked{0};
+            std::uint64_t _inline{0};
+        };
+    } // namespace detail
+
+    // Caps the threads left running by forced detaches, so a hung
+    // dependency cannot exhaust RLIMIT_NPROC or memory.
+    inline void set_detach_budget(detach_budget_options const &opts) { detail::detach_budget::global().configure(opts); }
+
+    inline detach_metrics detach_stats() { return detail::detach_budget::global().metrics(); }
+
+} // namespace tw
+
+#endif // TW_DETAIL_DETACH_BUDGET_HPP
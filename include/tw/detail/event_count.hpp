@@ -0,0 +1,99 @@
+#ifndef TW_DETAIL_EVENT_COUNT_HPP
+#define TW_DETAIL_EVENT_COUNT_HPP
+#pragma once
+
+#include <tw/detail/completion_flag.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if !defined(__linux__)
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace tw
+{
+    namespace detail
+    {
+        // Lets lock-free structures block without a lock on the fast path.
+        // A waiter takes a key, re-checks its condition, then sleeps until the
+        // key goes stale; notify() is a single load while nobody waits.
+        //
+        //   auto key = ev.prepare_wait();
+        //   if (condition()) { ev.cancel_wait(); ... }
+        //   else ev.wait_until(key, deadline);    // also ends the wait
+        class event_count
+        {
+        public:
+            using Clock = std::chrono::steady_clock;
+
+            std::uint32_t prepare_wait() noexcept
+            {
+                _waiters.fetch_add(1, std::memory_order_seq_cst);
+                return _epoch.load(std::memory_order_seq_cst);
+            }
+
+            void cancel_wait() noexcept { _waiters.fetch_sub(1, std::memory_order_seq_cst); }
+
+            // Returns false if the deadline passed before a notification.
+            bool wait_until(std::uint32_t key, Clock::time_point deadline) noexcept
+            {
+                bool notified = true;
+#if defined(__linux__)
+                while (_epoch.load(std::memory_order_acquire) == key)
+                {
+                    if (Clock::now() >= deadline)
+                    {
+                        notified = false;
+                        break;
+                    }
+                    if (deadline == Clock::time_point::max())
+                        futex_wait(_epoch, key);
+                    else
+                        futex_wait_until(_epoch, key, deadline);
+                }
+#else
+                std::unique_lock lk(_mtx);
+                notified = _cv.wait_until(lk, deadline, [&]
+                                          { return _epoch.load(std::memory_order_acquire) != key; });
+#endif
+                cancel_wait();
+                return notified;
+            }
+
+            void notify() noexcept
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (_waiters.load(std::memory_order_relaxed) != 0)
+                    wake();
+            }
+
+            // Wakes regardless of registered waiters (used by stop callbacks).
+            void wake() noexcept
+            {
+#if defined(__linux__)
+                _epoch.fetch_add(1, std::memory_order_seq_cst);
+                futex_wake_all(_epoch);
+#else
+                {
+                    std::lock_guard lk(_mtx);
+                    _epoch.fetch_add(1, std::memory_order_seq_cst);
+                }
+                _cv.notify_all();
+#endif
+            }
+
+        private:
+            std::atomic<std::uint32_t> _epoch{0};
+            std::atomic<std::uint32_t> _waiters{0};
+#if !defined(__linux__)
+            std::mutex _mtx;
+            std::condition_variable _cv;
+#endif
+        };
+    } // namespace detail
+} // namespace tw
+
+#endif // TW_DETAIL_EVENT_COUNT_HPP
@@ -0,0 +1,133 @@
+#ifndef TW_DETAIL_RESUME_QUEUE_HPP
+#define TW_DETAIL_RESUME_QUEUE_HPP
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace tw
+{
+    namespace detail
+    {
+        // Intrusive continuation. The owner embeds the node and keeps it
+        // alive until it has run; the callback may destroy the owner.
+        class resume_node
+        {
+        public:
+            using callback = void (*)(resume_node &) noexcept;
+
+            explicit resume_node(callback run) noexcept : _run(run) {}
+
+            resume_node(const resume_node &) = delete;
+            resume_node &operator=(const resume_node &) = delete;
+
+        private:
+            friend class resume_queue;
+
+            callback _run;
+            resume_node *_next{nullptr};
+        };
+
+        // Runs the continuations that timer callbacks hand off, so user code
+        // after a co_await or a sender completion, and the launch of a
+        // scheduled worker, never runs on (or blocks) the timer_service
+        // thread. A thread is added whenever every existing one is busy, up
+        // to a cap.
+        class resume_queue
+        {
+        public:
+            explicit resume_queue(std::size_t max_threads = std::max(4u, std::thread::hardware_concurrency()))
+                : _max(std::max<std::size_t>(max_threads, 1))
+            {
+            }
+
+            ~resume_queue()
+            {
+                for (auto &t : _threads)
+                    t.request_stop();
+                _cv.notify_all();
+            }
+
+            resume_queue(const resume_queue &) = delete;
+            resume_queue &operator=(const resume_queue &) = delete;
+
+            // Intentionally leaked, like timer_service::global().
+            static resume_queue &global()
+            {
+                static resume_queue *q = new resume_queue;
+                return *q;
+            }
+
+            // Runs n inline if no thread can be started at all.
+            void post(resume_node &n) noexcept
+            {
+                std::unique_lock lk(_mtx);
+                if (_idle == 0 && _threads.size() < _max)
+                {
+                    try
+                    {
+                        _threads.emplace_back([this](std::stop_token st)
+                                              { run(st); });
+                        ++_idle;
+                    }
+                    catch (...)
+                    {
+                    }
+                }
+                if (_threads.empty())
+                {
+                    lk.unlock();
+                    n._run(n);
+                    return;
+                }
+
+                n._next = nullptr;
+                if (_tail)
+                    _tail->_next = &n;
+                else
+                    _head = &n;
+                _tail = &n;
+                lk.unlock();
+                _cv.notify_one();
+            }
+
+        private:
+            void run(std::stop_token st)
+            {
+                std::unique_lock lk(_mtx);
+                for (;;)
+                {
+                    _cv.wait(lk, st, [this]
+                             { return _head != nullptr; });
+                    if (!_head)
+                        return;
+
+                    auto *n = _head;
+                    _head = n->_next;
+                    if (!_head)
+                        _tail = nullptr;
+                    --_idle;
+                    lk.unlock();
+                    n->_run(*n);
+                    lk.lock();
+                    ++_idle;
+                }
+            }
+
+            std::size_t _max;
+            std::mutex _mtx;
+            std::condition_variable_any _cv;
+            resume_node *_head{nullptr};
+            resume_node *_tail{nullptr};
+            std::size_t _idle{0};
+            std::vector<std::jthread> _threads;
+        };
+    } // namespace detail
+} // namespace tw
+
+#endif // TW_DETAIL_RESUME_QUEUE_HPP
@@ -0,0 +1,268 @@
+#ifndef TW_DETAIL_WORKER_REGISTRY_HPP
+#define TW_DETAIL_WORKER_REGISTRY_HPP
+#pragma once
+
+#include <tw/detail/completion_flag.hpp>
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stop_token>
+#include <thread>
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace tw
+{
+    struct emergency_report
+    {
+        // workers live when the emergency stop was handled
+        std::size_t workers{0};
+        // of those, the ones that returned before the emergency deadline
+        std::size_t finished{0};
+    };
+
+    namespace detail
+    {
+        // What the registry may touch of a live worker, from a signal
+        // handler (emergency) or from the reaper thread (stop, done).
+        struct worker_entry
+        {
+            completion_flag done;
+            std::atomic_bool emergency{false};
+            // set once `stop` has been filled in
+            std::atomic_bool armed{false};
+            std::stop_source stop{std::nostopstate};
+        };
+
+        inline std::atomic_bool emergency_flag{false};
+        inline std::atomic<std::int64_t> emergency_budget_ns{100'000'000};
+
+        inline bool emergency_requested() noexcept { return emergency_flag.load(std::memory_order_relaxed); }
+
+        // Lock-free set of live workers. Slots live in blocks that are never
+        // freed, so walking them is async-signal-safe. A walker pins a slot
+        // while it dereferences the entry; leave() waits for pins to drain,
+        // so an entry is never destroyed under a walker.
+        class worker_registry
+        {
+            static_assert(std::atomic<worker_entry *>::is_always_lock_free &&
+                              std::atomic<std::uint32_t>::is_always_lock_free && std::atomic_bool::is_always_lock_free,
+                          "the emergency path must be lock-free");
+
+            struct block;
+
+        public:
+            using worker_clock = std::chrono::steady_clock;
+
+            struct slot
+            {
+                std::atomic<worker_entry *> entry{nullptr};
+                std::atomic<std::uint32_t> pins{0};
+                // fixed when the block is created
+                block *home{nullptr};
+                std::uint64_t bit{0};
+            };
+
+            // Created with the first worker and intentionally leaked, like
+            // the timer service.
+            static worker_registry &global()
+            {
+                static worker_registry *r = []
+                {
+                    auto *p = new worker_registry;
+                    instance.store(p, std::memory_order_release);
+                    return p;
+                }();
+                return *r;
+            }
+
+            // nullptr until the first worker was created; safe in a handler.
+            static worker_registry *existing() noexcept { return instance.load(std::memory_order_acquire); }
+
+            // Tries the block that last had room first, so enrolling does
+            // not rescan the full blocks ahead of it; each of those costs
+            // one load of its free bitmap.
+            slot *enroll(worker_entry *e)
+            {
+                auto *hint = _hint.load(std::memory_order_acquire);
+                if (hint)
+                    if (auto *s = claim(*hint, e))
+                        return s;
+                for (auto *b = _head.load(std::memory_order_acquire); b; b = b->next)
+                    if (b != hint)
+                        if (auto *s = claim(*b, e))
+                        {
+                            _hint.store(b, std::memory_order_release);
+                            return s;
+                        }
+
+                auto *b = new block;
+                b->used.store(1, std::memory_order_relaxed);
+                b->slots[0].entry.store(e, std::memory_order_relaxed);
+                auto *head = _head.load(std::memory_order_relaxed);
+                do
+                    b->next = head;
+                while (!_head.compare_exchange_weak(head, b, std::memory_order_release, std::memory_order_relaxed));
+                _hint.store(b, std::memory_order_release);
+                return &b->slots[0];
+            }
+
+            static void leave(slot *s) noexcept
+            {
+                s->entry.store(nullptr, std::memory_order_seq_cst);
+                while (s->pins.load(std::memory_order_seq_cst) != 0)
+                    std::this_thread::yield();
+                // reusable only once no walker can still see the old entry
+                s->home->used.fetch_and(~s->bit, std::memory_order_release);
+                if (auto *r = existing())
+                    r->_hint.store(s->home, std::memory_order_release);
+            }
+
+            // Calls f(entry) for every live worker while its slot is pinned.
+            template <class F>
+            void for_each(F &&f) noexcept
+            {
+                for (auto *b = _head.load(std::memory_order_acquire); b; b = b->next)
+                    for (auto &s : b->slots)
+                    {
+                        if (s.entry.load(std::memory_order_relaxed) == nullptr)
+                            continue;
+                        s.pins.fetch_add(1, std::memory_order_seq_cst);
+                        if (auto *e = s.entry.load(std::memory_order_seq_cst))
+                            f(*e);
+                        s.pins.fetch_sub(1, std::memory_order_seq_cst);
+                    }
+            }
+
+            // Async-signal-safe: flags every worker and wakes the reaper.
+            void signal() noexcept
+            {
+                for_each([](worker_entry &e)
+                         { e.emergency.store(true, std::memory_order_relaxed); });
+#if defined(__linux__)
+                std::uint64_t one = 1;
+                [[maybe_unused]] auto n = ::write(_wakeFd, &one, sizeof one);
+#elif defined(__unix__) || defined(__APPLE__)
+                char one = 1;
+                [[maybe_unused]] auto n = ::write(_wakeFd, &one, 1);
+#endif
+            }
+
+            bool wait_report(worker_clock::time_point deadline, emergency_report &out) noexcept
+            {
+                if (!_reported.wait_until(deadline))
+                    return false;
+                out = _report;
+                return true;
+            }
+
+        private:
+            struct block
+            {
+                block() noexcept
+                {
+                    for (unsigned i = 0; i < 64; ++i)
+                    {
+                        slots[i].home = this;
+                        slots[i].bit = std::uint64_t{1} << i;
+                    }
+                }
+
+                slot slots[64];
+                // bit i set while slots[i] is taken
+                std::atomic<std::uint64_t> used{0};
+                block *next{nullptr};
+            };
+
+            static slot *claim(block &b, worker_entry *e) noexcept
+            {
+                auto used = b.used.load(std::memory_order_relaxed);
+                while (~used)
+                {
+                    auto bit = std::uint64_t{1} << std::countr_one(used);
+                    auto prev = b.used.fetch_or(bit, std::memory_order_acq_rel);
+                    if (!(prev & bit))
+                    {
+                        auto &s = b.slots[std::countr_zero(bit)];
+                        s.entry.store(e, std::memory_order_seq_cst);
+                        return &s;
+                    }
+                    used = prev | bit;
+                }
+                return nullptr;
+            }
+
+            worker_registry()
+            {
+#if defined(__linux__)
+                _wakeFd = ::eventfd(0, EFD_CLOEXEC);
+                _readFd = _wakeFd;
+#elif defined(__unix__) || defined(__APPLE__)
+                int fds[2];
+                if (::pipe(fds) == 0)
+                {
+                    ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+                    ::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+                    ::fcntl(fds[1], F_SETFL, O_NONBLOCK);
+                    _readFd = fds[0];
+                    _wakeFd = fds[1];
+                }
+#endif
+                if (_readFd >= 0)
+                    std::thread([this]
+                                { reap(); })
+                        .detach();
+            }
+
+            // Reaper thread: sleeps until signal(), then stops every worker
+            // and waits for them against one deadline.
+            void reap() noexcept
+            {
+#if defined(__unix__) || defined(__APPLE__)
+                for (;;)
+                {
+                    std::uint64_t buf;
+                    auto n = ::read(_readFd, &buf, sizeof buf);
+                    if (n > 0)
+                        break;
+                }
+#endif
+                auto deadline = worker_clock::now() +
+                                std::chrono::nanoseconds(emergency_budget_ns.load(std::memory_order_relaxed));
+                emergency_report rep;
+                for_each([](worker_entry &e)
+                         {
+                    if (e.armed.load(std::memory_order_acquire))
+                        e.stop.request_stop(); });
+                for_each([&](worker_entry &e)
+                         {
+                    ++rep.workers;
+                    if (e.done.wait_until(deadline))
+                        ++rep.finished; });
+                _report = rep;
+                _reported.set();
+            }
+
+            static inline std::atomic<worker_registry *> instance{nullptr};
+
+            std::atomic<block *> _head{nullptr};
+            // a block that recently had a free slot
+            std::atomic<block *> _hint{nullptr};
+            int _wakeFd{-1};
+            int _readFd{-1};
+            emergency_report _report;
+            completion_flag _reported;
+        };
+    } // namespace detail
+} // namespace tw
+
+#endif // TW_DETAIL_WORKER_REGISTRY_HPP
@@ -0,0 +1,98 @@
+#ifndef TW_DETAIL_WORKER_TRACE_HPP
+#define TW_DETAIL_WORKER_TRACE_HPP
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace tw
+{
+    enum class trace_outcome : std::uint8_t
+    {
+        // returned on its own
+        completed,
+        // returned after stop was requested
+        stopped,
+        // threw
+        failed,
+        // still running when its handle gave up on it
+        detached,
+        // stopped before it started
+        skipped
+    };
+
+    // One TimedWorker, as seen when its handle was destroyed.
+    struct trace_record
+    {
+        // since the recorder started
+        std::chrono::nanoseconds created{0};
+        // run budget, or the shutdown grace for single-timeout workers
+        std::chrono::nanoseconds timeout{0};
+        // from start until the callable returned; from creation until the
+        // detach for detached ones
+        std::chrono::nanoseconds run{0};
+        trace_outcome outcome{trace_outcome::completed};
+
+        friend bool operator==(trace_record const &, trace_record const &) = default;
+    };
+
+    namespace detail
+    {
+        struct trace_sink
+        {
+            virtual void write(trace_record const &r) noexcept = 0;
+
+        protected:
+            ~trace_sink() = default;
+        };
+
+        // Per-worker timestamps, written by the worker thread before it
+        // sets `done` and read by the handle after it has seen `done`.
+        struct worker_trace
+        {
+            bool on{false};
+            std::chrono::steady_clock::time_point created{};
+            std::chrono::steady_clock::time_point started{};
+            std::chrono::steady_clock::time_point ended{};
+            std::chrono::steady_clock::duration timeout{};
+            trace_outcome outcome{trace_outcome::skipped};
+        };
+
+        inline std::atomic_bool trace_on{false};
+        inline std::mutex trace_mtx;
+        inline trace_sink *trace_target = nullptr;
+        inline std::chrono::steady_clock::time_point trace_origin{};
+
+        inline bool tracing() noexcept { return trace_on.load(std::memory_order_relaxed); }
+
+        inline void trace_attach(trace_sink *s, std::chrono::steady_clock::time_point origin)
+        {
+            std::lock_guard lk(trace_mtx);
+            trace_target = s;
+            trace_origin = origin;
+            trace_on.store(true, std::memory_order_relaxed);
+        }
+
+        // Returns once no write to `s` is in progress.
+        inline void trace_detach(trace_sink *s)
+        {
+            std::lock_guard lk(trace_mtx);
+            if (trace_target != s)
+                return;
+            trace_target = nullptr;
+            trace_on.store(false, std::memory_order_relaxed);
+        }
+
+        inline void trace_write(worker_trace const &t, std::chrono::steady_clock::duration run,
+                                trace_outcome outcome) noexcept
+        {
+            std::lock_guard lk(trace_mtx);
+            if (trace_target)
+                trace_target->write({t.created - trace_origin, t.timeout, run, outcome});
+        }
+    } // namespace detail
+} // namespace tw
+
+#endif // TW_DETAIL_WORKER_TRACE_HPP
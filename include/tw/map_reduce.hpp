@@ -0,0 +1,207 @@
+#ifndef TW_MAP_REDUCE_HPP
+#define TW_MAP_REDUCE_HPP
+#pragma once
+
+#include <tw/detail/completion_flag.hpp>
+#include <tw/timed_worker.hpp>
+#include <tw/worker_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <stop_token>
+#include <utility>
+#include <vector>
+
+namespace tw
+{
+    template <class Acc>
+    struct map_reduce_result
+    {
+        Acc value;
+        // inputs folded into `value`
+        std::size_t mapped{0};
+        std::size_t total{0};
+        // first exception thrown by map or reduce; its chunk stopped there
+        std::exception_ptr error;
+
+        double coverage() const noexcept { return total ? static_cast<double>(mapped) / static_cast<double>(total) : 1.0; }
+        bool complete() const noexcept { return mapped == total && !error; }
+    };
+
+    namespace detail
+    {
+        enum class chunk_phase : std::uint8_t
+        {
+            queued,
+            running,
+            finished,
+            abandoned
+        };
+
+        // Everything a chunk touches. Chunks share ownership, so the call can
+        // return at the deadline while some are still mapping.
+        template <class View, class Acc, class Map, class Reduce>
+        struct map_reduce_state
+        {
+            map_reduce_state(View in, Acc acc, Map m, Reduce r, std::size_t chunks)
+                : inputs(std::move(in)), init(std::move(acc)), map(std::move(m)), reduce(std::move(r)),
+                  slots(chunks), counts(chunks), errors(chunks),
+                  phase(std::make_unique<std::atomic<chunk_phase>[]>(chunks)), outstanding(chunks)
+            {
+            }
+
+            // false if the chunk was abandoned before it started
+            bool claim(std::size_t i, chunk_phase to) noexcept
+            {
+                auto expected = chunk_phase::queued;
+                return phase[i].compare_exchange_strong(expected, to, std::memory_order_acq_rel);
+            }
+
+            void release() noexcept
+            {
+                if (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    done.set();
+            }
+
+            void run_chunk(std::size_t c, std::size_t lo, std::size_t hi, std::stop_token const &pst)
+            {
+                if (!claim(c, chunk_phase::running))
+                    return;
+                std::stop_source chunkStop;
+                std::stop_callback byDeadline(src.get_token(), forward_stop{&chunkStop});
+                std::stop_callback byPool(pst, forward_stop{&chunkStop});
+                auto st = chunkStop.get_token();
+                stop_scope scope(st);
+                auto first = std::ranges::begin(inputs);
+
+                Acc acc = init;
+                std::size_t n = 0;
+                try
+                {
+                    for (auto i = lo; i < hi && !st.stop_requested(); ++i, ++n)
+                    {
+                        auto v = static_cast<Acc>(map(st, first[static_cast<std::ptrdiff_t>(i)]));
+                        // a value cut short by the stop is not folded in
+                        if (st.stop_requested())
+                            break;
+                        // folds into a copy, so a throwing reduce leaves the
+                        // last good accumulator
+                        acc = reduce(Acc(acc), std::move(v));
+                    }
+                }
+                catch (...)
+                {
+                    errors[c] = std::current_exception();
+                }
+                slots[c].emplace(std::move(acc));
+                counts[c] = n;
+                phase[c].store(chunk_phase::finished, std::memory_order_release);
+                release();
+            }
+
+            View inputs;
+            Acc init;
+            Map map;
+            Reduce reduce;
+            std::vector<std::optional<Acc>> slots;
+            std::vector<std::size_t> counts;
+            std::vector<std::exception_ptr> errors;
+            std::unique_ptr<std::atomic<chunk_phase>[]> phase;
+            std::atomic<std::size_t> outstanding;
+            std::stop_source src;
+            completion_flag done;
+        };
+    } // namespace detail
+
+    // Splits `inputs` into chunks folded on the pool: each chunk keeps a
+    // local accumulator, starting from `init`, and folds with
+    // acc = reduce(acc, map(st, x)). The only shared write is one slot per
+    // chunk when it ends. Finished chunks are then merged pairwise in a tree.
+    // `reduce` must be associative, and `init` must be its identity.
+    //
+    // At the deadline the token passed to map is stopped, chunks that never
+    // started are abandoned and the call returns with the chunks that had
+    // finished; chunks still mapping count as not covered. A value map
+    // returns once its token is stopped is discarded. They share
+    // ownership of init, map and reduce, and of `inputs` when it is passed
+    // as an rvalue. An lvalue range is only borrowed, so it must outlive
+    // map calls still in flight at the deadline. The deadline is real time:
+    // map_reduce builds no workers of its own and ignores a clock_scope.
+    template <class LogS, std::ranges::viewable_range R, class Acc, class Map, class Reduce, class C, class D>
+        requires std::ranges::random_access_range<std::views::all_t<R>> &&
+                 std::invocable<Map &, std::stop_token, std::ranges::range_reference_t<std::views::all_t<R>>> &&
+                 std::invocable<Reduce &, Acc &&, Acc &&>
+    map_reduce_result<Acc> map_reduce(worker_pool<LogS> &pool, R &&inputs, Acc init, Map map, Reduce reduce,
+                                      std::chrono::time_point<C, D> deadline, std::size_t chunks = 0)
+    {
+        auto total = static_cast<std::size_t>(std::ranges::size(inputs));
+        if (chunks == 0)
+            chunks = pool.size() * 4;
+        chunks = std::clamp<std::size_t>(chunks, 1, std::max<std::size_t>(total, 1));
+
+        using state_t = detail::map_reduce_state<std::views::all_t<R>, Acc, Map, Reduce>;
+        auto state = std::make_shared<state_t>(std::views::all(std::forward<R>(inputs)), std::move(init),
+                                               std::move(map), std::move(reduce), chunks);
+        auto until = detail::to_worker_time(deadline);
+        detail::scoped_deadline limit(state->src, until);
+
+        // a full pool queue is waited on only until the deadline, so this
+        // is also safe from inside a pool task
+        for (std::size_t c = 0; c < chunks; ++c)
+        {
+            auto lo = c * total / chunks, hi = (c + 1) * total / chunks;
+            bool submitted = pool.submit_until([state, c, lo, hi](std::stop_token pst)
+                                               { state->run_chunk(c, lo, hi, pst); },
+                                               until);
+            if (!submitted && state->claim(c, detail::chunk_phase::abandoned))
+                state->release();
+        }
+
+        if (!state->done.wait_until(until))
+        {
+            state->src.request_stop();
+            for (std::size_t c = 0; c < chunks; ++c)
+                if (state->claim(c, detail::chunk_phase::abandoned))
+                    state->release();
+        }
+
+        map_reduce_result<Acc> out{state->init, 0, total, nullptr};
+        std::vector<Acc> parts;
+        parts.reserve(chunks);
+        for (std::size_t c = 0; c < chunks; ++c)
+        {
+            if (state->phase[c].load(std::memory_order_acquire) != detail::chunk_phase::finished)
+                continue;
+            out.mapped += state->counts[c];
+            if (state->errors[c] && !out.error)
+                out.error = state->errors[c];
+            parts.push_back(std::move(*state->slots[c]));
+        }
+        for (std::size_t step = 1; step < parts.size(); step *= 2)
+            for (std::size_t i = 0; i + step < parts.size(); i += 2 * step)
+                parts[i] = state->reduce(std::move(parts[i]), std::move(parts[i + step]));
+        if (!parts.empty())
+            out.value = std::move(parts.front());
+        return out;
+    }
+
+    template <class LogS, std::ranges::viewable_range R, class Acc, class Map, class Reduce, class Rep, class Period>
+    map_reduce_result<Acc> map_reduce(worker_pool<LogS> &pool, R &&inputs, Acc init, Map map, Reduce reduce,
+                                      std::chrono::duration<Rep, Period> budget, std::size_t chunks = 0)
+    {
+        return map_reduce(pool, std::forward<R>(inputs), std::move(init), std::move(map), std::move(reduce),
+                          detail::add_sat(detail::worker_clock::now(), detail::to_worker_duration(budget)), chunks);
+    }
+
+} // namespace tw
+
+#endif // TW_MAP_REDUCE_HPP
@@ -0,0 +1,259 @@
+#ifndef TW_PERIODIC_WORKER_HPP
+#define TW_PERIODIC_WORKER_HPP
+#pragma once
+
+#include <tw/timed_worker.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <time.h>
+#endif
+
+namespace tw
+{
+    namespace detail
+    {
+        // Absolute-deadline sleep. On Linux steady_clock is CLOCK_MONOTONIC,
+        // so clock_nanosleep(TIMER_ABSTIME) wakes at the exact tick instead of
+        // accumulating the error of relative sleeps.
+        inline void sleep_until_abs(std::chrono::steady_clock::time_point tp) noexcept
+        {
+#if defined(__linux__)
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+            if (ns <= 0)
+                return;
+            timespec ts{static_cast<time_t>(ns / 1'000'000'000), static_cast<long>(ns % 1'000'000'000)};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+            {
+            }
+#else
+            std::this_thread::sleep_until(tp);
+#endif
+        }
+    } // namespace detail
+
+    struct periodic_stats
+    {
+        std::uint64_t runs{0};
+        std::uint64_t missed_ticks{0};
+        std::uint64_t timed_out_runs{0};
+        std::uint64_t failed_runs{0};
+        // start time minus scheduled tick time
+        std::chrono::nanoseconds last_jitter{0};
+        std::chrono::nanoseconds min_jitter{0};
+        std::chrono::nanoseconds max_jitter{0};
+        std::chrono::nanoseconds mean_jitter{0};
+    };
+
+    namespace detail
+    {
+        // State the loop thread touches. Shared with the thread so that a
+        // detached loop never writes into a destroyed PeriodicWorker.
+        struct periodic_state
+        {
+            using Clock = std::chrono::steady_clock;
+
+            periodic_state(Clock::duration p, Clock::duration t) noexcept
+                : period(std::max(p, Clock::duration(1))), runTimeout(t)
+            {
+            }
+
+            void record_jitter(Clock::duration d) noexcept
+            {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+                bool first = runs.load(std::memory_order_relaxed) == 0;
+                lastJitter.store(ns, std::memory_order_relaxed);
+                sumJitter.store(sumJitter.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+                if (first || ns < minJitter.load(std::memory_order_relaxed))
+                    minJitter.store(ns, std::memory_order_relaxed);
+                if (first || ns > maxJitter.load(std::memory_order_relaxed))
+                    maxJitter.store(ns, std::memory_order_relaxed);
+            }
+
+            Clock::duration period;
+            Clock::duration runTimeout;
+            std::mutex mtx;
+            std::condition_variable_any cv;
+            std::atomic<std::uint64_t> runs{0};
+            std::atomic<std::uint64_t> missed{0};
+            std::atomic<std::uint64_t> timedOut{0};
+            std::atomic<std::uint64_t> failed{0};
+            std::atomic<std::int64_t> lastJitter{0};
+            std::atomic<std::int64_t> minJitter{0};
+            std::atomic<std::int64_t> maxJitter{0};
+            std::atomic<std::int64_t> sumJitter{0};
+        };
+
+        struct periodic_access;
+    } // namespace detail
+
+    // Runs a callable every `period` on a single TimedWorker thread. Tick k
+    // is due at start + k * period; a run that overruns skips the ticks it
+    // covered (counted as missed) rather than shifting the schedule. Each
+    // run gets its own stop_token, triggered when the run exceeds
+    // per_run_timeout or when the worker itself is stopped. On destruction
+    // the run in progress gets per_run_timeout to return before the thread
+    // is detached.
+    template <class LogStream = std::ostream>
+    class PeriodicWorker
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        friend struct detail::periodic_access;
+
+        void request_stop() noexcept { _w.request_stop(); }
+
+        bool done() const noexcept { return _w.done(); }
+        bool detached() const noexcept { return _w.detached(); }
+
+        periodic_stats stats() const noexcept
+        {
+            periodic_stats s;
+            s.runs = _st->runs.load(std::memory_order_relaxed);
+            s.missed_ticks = _st->missed.load(std::memory_order_relaxed);
+            s.timed_out_runs = _st->timedOut.load(std::memory_order_relaxed);
+            s.failed_runs = _st->failed.load(std::memory_order_relaxed);
+            s.last_jitter = std::chrono::nanoseconds(_st->lastJitter.load(std::memory_order_relaxed));
+            s.min_jitter = std::chrono::nanoseconds(_st->minJitter.load(std::memory_order_relaxed));
+            s.max_jitter = std::chrono::nanoseconds(_st->maxJitter.load(std::memory_order_relaxed));
+            if (s.runs)
+                s.mean_jitter = std::chrono::nanoseconds(_st->sumJitter.load(std::memory_order_relaxed) /
+                                                         static_cast<std::int64_t>(s.runs));
+            return s;
+        }
+
+        PeriodicWorker(PeriodicWorker &&) noexcept = default;
+        // TimedWorker holds a reference, so it cannot be move-assigned either
+        PeriodicWorker &operator=(PeriodicWorker &&) = delete;
+        PeriodicWorker(const PeriodicWorker &) = delete;
+        PeriodicWorker &operator=(const PeriodicWorker &) = delete;
+
+        // Stopping, the grace wait and the detach are TimedWorker's.
+        ~PeriodicWorker() = default;
+
+    private:
+        PeriodicWorker(std::shared_ptr<detail::periodic_state> st, TimedWorker<LogStream> w) noexcept
+            : _st(std::move(st)), _w(std::move(w))
+        {
+        }
+
+        template <class F>
+        static void loop(detail::periodic_state &s, LogStream &log, std::stop_token st, F &func)
+        {
+            auto tick = Clock::now();
+            while (!st.stop_requested())
+            {
+                if (!wait_for_tick(s, st, tick))
+                    break;
+
+                auto began = Clock::now();
+                s.record_jitter(began - tick);
+                run_once(s, log, st, func, detail::add_sat(began, s.runTimeout));
+
+                // next tick strictly in the future, counting the ones we slept through
+                tick = detail::add_sat(tick, s.period);
+                auto now = Clock::now();
+                if (tick <= now)
+                {
+                    auto behind = (now - tick) / s.period + 1;
+                    s.missed.fetch_add(static_cast<std::uint64_t>(behind), std::memory_order_relaxed);
+                    tick += behind * s.period;
+                }
+            }
+        }
+
+        // Coarse, stop-aware wait on the condition variable, then a precise
+        // absolute sleep for the final stretch.
+        static bool wait_for_tick(detail::periodic_state &s, std::stop_token const &st, Clock::time_point tick)
+        {
+            constexpr auto precise_window = std::chrono::milliseconds(1);
+            if (tick - Clock::now() > precise_window)
+            {
+                std::unique_lock lk(s.mtx);
+                s.cv.wait_until(lk, st, tick - precise_window, []
+                                { return false; });
+            }
+            if (st.stop_requested())
+                return false;
+            detail::sleep_until_abs(tick);
+            return !st.stop_requested();
+        }
+
+        template <class F>
+        static void run_once(detail::periodic_state &s, LogStream &log, std::stop_token const &outer, F &func,
+                             Clock::time_point runDeadline)
+        {
+            std::stop_source runStop;
+            std::stop_callback forward(outer, detail::forward_stop{&runStop});
+            detail::scoped_deadline limit(runStop, runDeadline);
+
+            try
+            {
+                detail::stop_scope scope(runStop.get_token());
+                func(runStop.get_token());
+            }
+            catch (std::exception const &ex)
+            {
+                s.failed.fetch_add(1, std::memory_order_relaxed);
+                log << "[PeriodicWorker] unhandled exception: " << ex.what() << '\n';
+            }
+            catch (...)
+            {
+                s.failed.fetch_add(1, std::memory_order_relaxed);
+                log << "[PeriodicWorker] unknown exception\n";
+            }
+
+            if (limit.finish())
+                s.timedOut.fetch_add(1, std::memory_order_relaxed);
+            s.runs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::shared_ptr<detail::periodic_state> _st;
+        TimedWorker<LogStream> _w;
+    };
+
+    namespace detail
+    {
+        struct periodic_access
+        {
+            template <class LogS, class F>
+            static PeriodicWorker<LogS> make(worker_clock::duration period, worker_clock::duration runTimeout, F &&f,
+                                             LogS &ls)
+            {
+                auto st = std::make_shared<periodic_state>(period, runTimeout);
+                auto w = worker_access::make_service(runTimeout,
+                                                     [st, log = &ls, func = std::forward<F>(f)](std::stop_token tok) mutable
+                                                     { PeriodicWorker<LogS>::loop(*st, *log, std::move(tok), func); }, ls);
+                return PeriodicWorker<LogS>(std::move(st), std::move(w));
+            }
+        };
+    } // namespace detail
+
+    template <class LogS = std::ostream, class Rep1, class Period1, class Rep2, class Period2, class F, class... Args>
+        requires timed_callable<F, Args...>
+    auto make_periodic_worker(std::chrono::duration<Rep1, Period1> period,
+                              std::chrono::duration<Rep2, Period2> per_run_timeout,
+                              F &&f, LogS &ls = std::cerr, Args &&...args)
+    {
+        return detail::periodic_access::make(detail::to_worker_duration(period),
+                                             detail::to_worker_duration(per_run_timeout),
+                                             detail::bind_worker(std::forward<F>(f), std::forward<Args>(args)...), ls);
+    }
+
+} // namespace tw
+
+#endif // TW_PERIODIC_WORKER_HPP
@@ -0,0 +1,436 @@
+#ifndef TW_PIPELINE_HPP
+#define TW_PIPELINE_HPP
+#pragma once
+
+#include <tw/channel.hpp>
+#include <tw/timed_worker.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tw
+{
+    struct stage_options
+    {
+        // workers serving the stage; the callable runs concurrently on all
+        std::size_t workers{1};
+        // capacity of the stage's input channel (rounded up to a power of two)
+        std::size_t queue{64};
+        // service budget per item; stop is requested on the item's token
+        std::chrono::nanoseconds budget{std::chrono::milliseconds(10)};
+        // time a stopped worker gets to return before it is detached
+        std::chrono::nanoseconds shutdown_grace{std::chrono::milliseconds(10)};
+    };
+
+    struct stage_metrics
+    {
+        std::string name;
+        std::size_t queue_depth{0};
+        std::uint64_t processed{0};
+        // dropped because the item's end-to-end deadline passed
+        std::uint64_t expired{0};
+        // dropped because the stage budget ran out
+        std::uint64_t timed_out{0};
+        // dropped because the callable threw
+        std::uint64_t failed{0};
+        // dropped because the pipeline was stopped or downstream had closed
+        std::uint64_t stopped{0};
+        // items the callable ran on, whatever became of them
+        std::uint64_t serviced{0};
+        std::chrono::nanoseconds service_total{0};
+        std::chrono::nanoseconds service_max{0};
+
+        std::uint64_t dropped() const noexcept { return expired + timed_out + failed + stopped; }
+
+        std::chrono::nanoseconds service_mean() const noexcept
+        {
+            return serviced ? service_total / static_cast<std::int64_t>(serviced) : std::chrono::nanoseconds{0};
+        }
+    };
+
+    namespace detail
+    {
+        template <class T>
+        struct pipeline_item
+        {
+            T value;
+            worker_clock::time_point deadline;
+        };
+
+        template <class T>
+        using pipeline_channel = channel<pipeline_item<T>>;
+
+        template <class LogStream>
+        struct pipeline_stage
+        {
+            virtual ~pipeline_stage() = default;
+            virtual void start(LogStream &log) = 0;
+            virtual void request_stop() noexcept = 0;
+            // Waits for the workers up to `since` plus the stage's grace and
+            // emergency-stops those still running.
+            virtual void join_by(worker_clock::time_point since) = 0;
+            virtual stage_metrics metrics() const = 0;
+        };
+
+        template <class In, class Out, class F>
+        struct stage_state
+        {
+            using Clock = worker_clock;
+
+            stage_state(std::string n, stage_options const &o, std::shared_ptr<pipeline_channel<In>> i, F f)
+                : name(std::move(n)), opts(o), in(std::move(i)), fn(std::move(f)), active(o.workers)
+            {
+            }
+
+            void run(std::stop_token const &st)
+            {
+                while (auto item = in->pop(st))
+                {
+                    auto start = Clock::now();
+                    if (start >= item->deadline)
+                    {
+                        expired.fetch_add(1, std::memory_order_relaxed);
+                        continue;
+                    }
+
+                    auto budgetEnd = add_sat(start, opts.budget);
+                    bool byBudget = budgetEnd < item->deadline;
+                    std::stop_source src;
+                    std::stop_callback onStop(st, forward_stop{&src});
+                    scoped_deadline limit(src, byBudget ? budgetEnd : item->deadline);
+
+                    std::optional<Out> result;
+                    bool threw = false;
+                    try
+                    {
+                        stop_scope scope(src.get_token());
+                        result.emplace(fn(src.get_token(), std::move(item->value)));
+                    }
+                    catch (...)
+                    {
+                        threw = true;
+                    }
+                    bool late = limit.finish();
+                    record(Clock::now() - start);
+
+                    if (threw)
+                        failed.fetch_add(1, std::memory_order_relaxed);
+                    else if (late && !st.stop_requested())
+                        (byBudget ? timed_out : expired).fetch_add(1, std::memory_order_relaxed);
+                    else if (st.stop_requested())
+                    {
+                        stopped.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                    }
+                    else
+                        forward(std::move(*result), item->deadline, st);
+                }
+            }
+
+            // Backpressure: blocks on a full downstream channel, but only up
+            // to the item's end-to-end deadline.
+            void forward(Out &&v, Clock::time_point deadline, std::stop_token const &st)
+            {
+                switch (out->push(pipeline_item<Out>{std::move(v), deadline}, st, deadline))
+                {
+                case channel_status::ok:
+                    processed.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                case channel_status::timed_out:
+                    expired.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                default:
+                    stopped.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+            }
+
+            void record(Clock::duration d) noexcept
+            {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+                serviced.fetch_add(1, std::memory_order_relaxed);
+                service_total.fetch_add(ns, std::memory_order_relaxed);
+                auto prev = service_max.load(std::memory_order_relaxed);
+                while (prev < ns && !service_max.compare_exchange_weak(prev, ns, std::memory_order_relaxed))
+                {
+                }
+            }
+
+            // The last worker to leave lets downstream drain and finish.
+            void worker_exited() noexcept
+            {
+                if (active.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    out->close();
+            }
+
+            stage_metrics metrics() const
+            {
+                stage_metrics m;
+                m.name = name;
+                m.queue_depth = in->size();
+                m.processed = processed.load(std::memory_order_relaxed);
+                m.expired = expired.load(std::memory_order_relaxed);
+                m.timed_out = timed_out.load(std::memory_order_relaxed);
+                m.failed = failed.load(std::memory_order_relaxed);
+                m.stopped = stopped.load(std::memory_order_relaxed);
+                m.serviced = serviced.load(std::memory_order_relaxed);
+                m.service_total = std::chrono::nanoseconds(service_total.load(std::memory_order_relaxed));
+                m.service_max = std::chrono::nanoseconds(service_max.load(std::memory_order_relaxed));
+                return m;
+            }
+
+            const std::string name;
+            const stage_options opts;
+            std::shared_ptr<pipeline_channel<In>> in;
+            std::shared_ptr<pipeline_channel<Out>> out;
+            F fn;
+            std::atomic<std::size_t> active;
+            std::atomic<std::uint64_t> processed{0}, expired{0}, timed_out{0}, failed{0}, stopped{0}, serviced{0};
+            std::atomic<std::int64_t> service_total{0}, service_max{0};
+        };
+
+        // Owns one worker's share of the stage; its destructor reports the
+        // exit even when the worker was stopped before it ran.
+        template <class State>
+        struct stage_runner
+        {
+            explicit stage_runner(std::shared_ptr<State> s) : state(std::move(s)) {}
+            stage_runner(stage_runner &&) = default;
+            stage_runner &operator=(stage_runner &&) = delete;
+
+            ~stage_runner()
+            {
+                if (state)
+                    state->worker_exited();
+            }
+
+            void operator()(std::stop_token st) { state->run(st); }
+
+            std::shared_ptr<State> state;
+        };
+
+        template <class In, class Out, class F, class LogStream>
+        struct pipeline_stage_for final : pipeline_stage<LogStream>
+        {
+            explicit pipeline_stage_for(std::shared_ptr<stage_state<In, Out, F>> s) : state(std::move(s)) {}
+
+            void start(LogStream &log) override
+            {
+                workers.reserve(state->opts.workers);
+                for (std::size_t i = 0; i < state->opts.workers; ++i)
+                    workers.push_back(detail::make_service_worker(state->opts.shutdown_grace,
+                                                                 stage_runner<stage_state<In, Out, F>>(state), log));
+            }
+
+            void request_stop() noexcept override
+            {
+                for (auto &w : workers)
+                    w.request_stop();
+            }
+
+            void join_by(worker_clock::time_point since) override
+            {
+                auto deadline = add_sat(since, to_worker_duration(state->opts.shutdown_grace));
+                for (auto &w : workers)
+                    if (!w.wait_until(deadline))
+                        w.emergency_stop();
+            }
+
+            stage_metrics metrics() const override { return state->metrics(); }
+
+            std::shared_ptr<stage_state<In, Out, F>> state;
+            std::vector<TimedWorker<LogStream>> workers;
+        };
+    } // namespace detail
+
+    template <class In, class Cur, class LogStream>
+    class pipeline_builder;
+
+    // Stages connected by bounded channels, each served by its own timed
+    // workers. Every item carries an end-to-end deadline: it is dropped at
+    // whichever stage finds it expired, and a stage's per-item budget is cut
+    // short by it. Built with make_pipeline<In>().stage(...)...build().
+    template <class In, class Out, class LogStream = std::ostream>
+    class pipeline
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        pipeline(pipeline &&o) noexcept
+            : _head(std::move(o._head)), _tail(std::move(o._tail)), _stages(std::move(o._stages)),
+              _expiredAtOutput(o._expiredAtOutput.load(std::memory_order_relaxed))
+        {
+        }
+        pipeline(const pipeline &) = delete;
+        pipeline &operator=(const pipeline &) = delete;
+
+        // Stops every stage at once and gives all workers their grace from
+        // that one moment, so shutdown takes at most the longest grace.
+        ~pipeline()
+        {
+            for (auto &s : _stages)
+                s->request_stop();
+            auto now = Clock::now();
+            for (auto &s : _stages)
+                s->join_by(now);
+        }
+
+        // Blocks while the first stage is saturated, up to the item's
+        // deadline: timed_out then means the item was not admitted.
+        template <class C, class D>
+        channel_status push(In v, std::chrono::time_point<C, D> deadline, std::stop_token st = {})
+        {
+            auto dl = detail::to_worker_time(deadline);
+            return _head->push(detail::pipeline_item<In>{std::move(v), dl}, std::move(st), dl);
+        }
+
+        template <class Rep, class Period>
+        channel_status push(In v, std::chrono::duration<Rep, Period> budget, std::stop_token st = {})
+        {
+            return push(std::move(v), detail::add_sat(Clock::now(), detail::to_worker_duration(budget)), std::move(st));
+        }
+
+        template <class Rep, class Period>
+        channel_status try_push(In v, std::chrono::duration<Rep, Period> budget)
+        {
+            auto dl = detail::add_sat(Clock::now(), detail::to_worker_duration(budget));
+            return _head->try_push(detail::pipeline_item<In>{std::move(v), dl});
+        }
+
+        // Results that expire while waiting here are dropped and counted in
+        // expired_at_output(). closed once the pipeline has drained after
+        // close().
+        channel_status pop(Out &out, std::stop_token st = {}, Clock::time_point deadline = Clock::time_point::max())
+        {
+            for (;;)
+            {
+                detail::pipeline_item<Out> item{};
+                auto s = _tail->pop(item, st, deadline);
+                if (s != channel_status::ok)
+                    return s;
+                if (Clock::now() < item.deadline)
+                {
+                    out = std::move(item.value);
+                    return s;
+                }
+                _expiredAtOutput.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        template <class Rep, class Period>
+        channel_status pop(Out &out, std::stop_token st, std::chrono::duration<Rep, Period> wait)
+        {
+            return pop(out, std::move(st), detail::add_sat(Clock::now(), detail::to_worker_duration(wait)));
+        }
+
+        // No more input; stages finish what is queued and close in turn.
+        void close() noexcept { _head->close(); }
+
+        std::vector<stage_metrics> metrics() const
+        {
+            std::vector<stage_metrics> out;
+            out.reserve(_stages.size());
+            for (auto &s : _stages)
+                out.push_back(s->metrics());
+            return out;
+        }
+
+        std::uint64_t expired_at_output() const noexcept { return _expiredAtOutput.load(std::memory_order_relaxed); }
+        std::size_t stages() const noexcept { return _stages.size(); }
+
+    private:
+        template <class, class, class>
+        friend class pipeline_builder;
+
+        pipeline(std::shared_ptr<detail::pipeline_channel<In>> head, std::shared_ptr<detail::pipeline_channel<Out>> tail,
+                 std::vector<std::unique_ptr<detail::pipeline_stage<LogStream>>> stages)
+            : _head(std::move(head)), _tail(std::move(tail)), _stages(std::move(stages))
+        {
+        }
+
+        std::shared_ptr<detail::pipeline_channel<In>> _head;
+        std::shared_ptr<detail::pipeline_channel<Out>> _tail;
+        std::vector<std::unique_ptr<detail::pipeline_stage<LogStream>>> _stages;
+        std::atomic<std::uint64_t> _expiredAtOutput{0};
+    };
+
+    // Accumulates stages; nothing runs until build().
+    template <class In, class Cur, class LogStream>
+    class pipeline_builder
+    {
+    public:
+        explicit pipeline_builder(LogStream &log) : _log(&log) {}
+
+        // F is called as f(std::stop_token, Cur&&) and returns the input of
+        // the next stage.
+        template <class F>
+            requires std::invocable<F &, std::stop_token, Cur &&>
+        auto stage(std::string name, stage_options const &opts, F f) &&
+        {
+            using Next = std::remove_cvref_t<std::invoke_result_t<F &, std::stop_token, Cur &&>>;
+            static_assert(!std::is_void_v<Next>, "a stage must produce a value for the next one");
+
+            stage_options o = opts;
+            o.workers = std::max<std::size_t>(o.workers, 1);
+            auto in = std::make_shared<detail::pipeline_channel<Cur>>(o.queue);
+            connect(in);
+
+            auto state = std::make_shared<detail::stage_state<Cur, Next, F>>(std::move(name), o, in, std::move(f));
+            pipeline_builder<In, Next, LogStream> next(*_log);
+            next._head = std::move(_head);
+            next._stages = std::move(_stages);
+            next._stages.push_back(std::make_unique<detail::pipeline_stage_for<Cur, Next, F, LogStream>>(state));
+            next._connect = [state](std::shared_ptr<detail::pipeline_channel<Next>> ch)
+            { state->out = std::move(ch); };
+            return next;
+        }
+
+        // output_queue bounds results not yet popped.
+        pipeline<In, Cur, LogStream> build(std::size_t output_queue = 64) &&
+        {
+            auto tail = std::make_shared<detail::pipeline_channel<Cur>>(output_queue);
+            connect(tail);
+            for (auto &s : _stages)
+                s->start(*_log);
+            return pipeline<In, Cur, LogStream>(std::move(_head), std::move(tail), std::move(_stages));
+        }
+
+    private:
+        template <class, class, class>
+        friend class pipeline_builder;
+
+        void connect(std::shared_ptr<detail::pipeline_channel<Cur>> const &ch)
+        {
+            if (_connect)
+                _connect(ch);
+            else if constexpr (std::is_same_v<In, Cur>)
+                _head = ch;
+        }
+
+        LogStream *_log;
+        std::shared_ptr<detail::pipeline_channel<In>> _head;
+        std::vector<std::unique_ptr<detail::pipeline_stage<LogStream>>> _stages;
+        std::function<void(std::shared_ptr<detail::pipeline_channel<Cur>>)> _connect;
+    };
+
+    template <class In, class LogS = std::ostream>
+    pipeline_builder<In, In, LogS> make_pipeline(LogS &ls = std::cerr)
+    {
+        return pipeline_builder<In, In, LogS>(ls);
+    }
+
+} // namespace tw
+
+#endif // TW_PIPELINE_HPP
@@ -0,0 +1,244 @@
+#ifndef TW_SCHEDULED_WORKER_HPP
+#define TW_SCHEDULED_WORKER_HPP
+#pragma once
+
+#include <tw/detail/resume_queue.hpp>
+#include <tw/timed_worker.hpp>
+#include <tw/timer_service.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+namespace tw
+{
+    namespace detail
+    {
+        enum class sched_phase : int
+        {
+            pending,
+            cancelled,
+            starting,
+            running
+        };
+
+        // Lives on the heap only while scheduled; the timer_service entry is
+        // the whole cost of a task that has not started yet. The worker is
+        // built on a resume_queue thread: admission against the detach
+        // budget may block or run the callable inline, and neither may
+        // happen on the timer thread.
+        template <class LogStream>
+        struct scheduled_state : timer_node, resume_node
+        {
+            explicit scheduled_state(LogStream &log) noexcept
+                : timer_node(&on_fire), resume_node(&on_launch), log(log)
+            {
+            }
+            virtual ~scheduled_state() = default;
+
+            virtual TimedWorker<LogStream> *launch() = 0;
+
+            static void on_fire(timer_node &n) noexcept
+            {
+                auto &self = static_cast<scheduled_state &>(n);
+
+                int expected = static_cast<int>(sched_phase::pending);
+                if (!self.phase.compare_exchange_strong(expected, static_cast<int>(sched_phase::starting),
+                                                        std::memory_order_acq_rel))
+                {
+                    auto keep = std::move(self.self);
+                    return;
+                }
+                resume_queue::global().post(self);
+            }
+
+            static void on_launch(resume_node &n) noexcept
+            {
+                auto &self = static_cast<scheduled_state &>(n);
+                auto keep = std::move(self.self);
+
+                sched_phase next = sched_phase::running;
+                try
+                {
+                    self.worker.reset(self.launch());
+                }
+                catch (...)
+                {
+                    next = sched_phase::cancelled;
+                    try
+                    {
+                        self.log << "[TimedWorker] scheduled start failed\n";
+                    }
+                    catch (...)
+                    {
+                    }
+                }
+                self.phase.store(static_cast<int>(next), std::memory_order_release);
+                self.phase.notify_all();
+            }
+
+            std::atomic_int phase{static_cast<int>(sched_phase::pending)};
+            std::unique_ptr<TimedWorker<LogStream>> worker;
+            std::shared_ptr<scheduled_state> self;
+            LogStream &log;
+        };
+
+        template <class LogStream, class Launch>
+        struct scheduled_state_for final : scheduled_state<LogStream>
+        {
+            scheduled_state_for(LogStream &log, Launch l) : scheduled_state<LogStream>(log), launcher(std::move(l)) {}
+
+            TimedWorker<LogStream> *launch() override { return launcher(); }
+
+            Launch launcher;
+        };
+    } // namespace detail
+
+    // Handle to a TimedWorker that starts at a given time. Until then no
+    // thread exists. In cancel() a compare-and-swap on the phase decides
+    // whether the cancel or the start wins; a winning cancel then takes the
+    // timer mutex and removes the entry from the timer heap (O(log n)).
+    template <class LogStream = std::ostream>
+    class ScheduledTimedWorker
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit ScheduledTimedWorker(std::shared_ptr<detail::scheduled_state<LogStream>> st) noexcept
+            : _st(std::move(st))
+        {
+        }
+
+        ScheduledTimedWorker(ScheduledTimedWorker &&) noexcept = default;
+        ScheduledTimedWorker &operator=(ScheduledTimedWorker &&o) noexcept
+        {
+            if (this != &o)
+            {
+                release();
+                _st = std::move(o._st);
+            }
+            return *this;
+        }
+        ScheduledTimedWorker(const ScheduledTimedWorker &) = delete;
+        ScheduledTimedWorker &operator=(const ScheduledTimedWorker &) = delete;
+
+        // Cancels (if pending) or stops and joins/detaches (if started).
+        ~ScheduledTimedWorker() { release(); }
+
+        // Returns true if the worker will never start. The phase CAS is
+        // the decision; the heap removal under the timer lock follows it.
+        bool cancel() noexcept
+        {
+            if (!_st)
+                return true;
+            int expected = static_cast<int>(detail::sched_phase::pending);
+            if (_st->phase.compare_exchange_strong(expected, static_cast<int>(detail::sched_phase::cancelled),
+                                                   std::memory_order_acq_rel))
+            {
+                // free the entry now rather than when its time comes; if it
+                // is firing already, on_fire sees the cancel and lets go
+                if (timer_service::global().cancel(*_st))
+                    _st->self.reset();
+                return true;
+            }
+            return expected == static_cast<int>(detail::sched_phase::cancelled);
+        }
+
+        bool started() const noexcept { return phase() >= detail::sched_phase::starting; }
+        bool cancelled() const noexcept { return phase() == detail::sched_phase::cancelled; }
+        bool done() const noexcept
+        {
+            auto *w = worker();
+            return w && w->done();
+        }
+
+        // Cancels a pending start or asks the running worker to stop.
+        void request_stop() noexcept
+        {
+            if (cancel())
+                return;
+            if (auto *w = wait_started())
+                w->request_stop();
+        }
+
+        void emergency_stop() noexcept
+        {
+            if (cancel())
+                return;
+            if (auto *w = wait_started())
+                w->emergency_stop();
+        }
+
+        // The running worker, or nullptr if it has not started (yet).
+        TimedWorker<LogStream> *worker() const noexcept
+        {
+            return phase() == detail::sched_phase::running ? _st->worker.get() : nullptr;
+        }
+
+    private:
+        detail::sched_phase phase() const noexcept
+        {
+            return _st ? static_cast<detail::sched_phase>(_st->phase.load(std::memory_order_acquire))
+                       : detail::sched_phase::cancelled;
+        }
+
+        TimedWorker<LogStream> *wait_started() const noexcept
+        {
+            int p = static_cast<int>(detail::sched_phase::starting);
+            while (_st->phase.load(std::memory_order_acquire) == p)
+                _st->phase.wait(p, std::memory_order_acquire);
+            return worker();
+        }
+
+        void release() noexcept
+        {
+            if (!_st)
+                return;
+            if (!cancel())
+            {
+                wait_started();
+                _st->worker.reset();
+            }
+            _st.reset();
+        }
+
+        std::shared_ptr<detail::scheduled_state<LogStream>> _st;
+    };
+
+    template <class LogS = std::ostream, class C, class D, class Rep, class Period, class F, class... Args>
+        requires timed_callable<F, Args...>
+    auto make_timed_worker_at(std::chrono::time_point<C, D> start, std::chrono::duration<Rep, Period> timeout,
+                              F &&f, LogS &ls = std::cerr, Args &&...args)
+    {
+        auto launch = [timeout, &ls, func = std::forward<F>(f),
+                       tup = std::make_tuple(std::forward<Args>(args)...)]() mutable
+        {
+            return std::apply([&](auto &...cur)
+                              { return new TimedWorker<LogS>(
+                                    make_timed_worker(timeout, std::move(func), ls, std::move(cur)...)); },
+                              tup);
+        };
+
+        using state_t = detail::scheduled_state_for<LogS, decltype(launch)>;
+        auto st = std::make_shared<state_t>(ls, std::move(launch));
+        st->self = st;
+        timer_service::global().schedule(*st, detail::to_worker_time(start));
+        return ScheduledTimedWorker<LogS>(std::move(st));
+    }
+
+    template <class LogS = std::ostream, class Rep1, class Period1, class Rep2, class Period2, class F, class... Args>
+        requires timed_callable<F, Args...>
+    auto make_timed_worker_after(std::chrono::duration<Rep1, Period1> delay, std::chrono::duration<Rep2, Period2> timeout,
+                                 F &&f, LogS &ls = std::cerr, Args &&...args)
+    {
+        return make_timed_worker_at(detail::add_sat(std::chrono::steady_clock::now(), detail::to_worker_duration(delay)), timeout,
+                                    std::forward<F>(f), ls, std::forward<Args>(args)...);
+    }
+
+} // namespace tw
+
+#endif // TW_SCHEDULED_WORKER_HPP
@@ -0,0 +1,651 @@
+#ifndef TW_SENDER_HPP
+#define TW_SENDER_HPP
+#pragma once
+
+#include <tw/detail/resume_queue.hpp>
+#include <tw/stop_token.hpp>
+#include <tw/timed_result.hpp>
+#include <tw/timed_worker.hpp>
+#include <tw/timer_service.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <concepts>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+// A deliberately small, member-function based subset of P2300:
+//
+//   sender    - has `sender_concept = tw::sender_t`, a `value_type` (void or a
+//               single value) and `connect(receiver) &&` returning an
+//               operation state.
+//   receiver  - has set_value(v...), set_error(std::exception_ptr),
+//               set_stopped(), and optionally get_stop_token().
+//   operation - non-movable, has start() noexcept.
+//
+// Operation states embed everything they need, so connecting and starting
+// a pipeline never allocates.
+
+namespace tw
+{
+    struct sender_t
+    {
+    };
+
+    template <class S>
+    concept sender = std::derived_from<typename std::remove_cvref_t<S>::sender_concept, sender_t>;
+
+    template <class S>
+    using sender_value_t = typename std::remove_cvref_t<S>::value_type;
+
+    namespace detail
+    {
+        template <class R>
+        auto get_stop_token(const R &r) noexcept
+        {
+            if constexpr (requires { r.get_stop_token(); })
+                return r.get_stop_token();
+            else
+                return never_stop_token{};
+        }
+
+        template <class R>
+        using stop_token_of_t = decltype(detail::get_stop_token(std::declval<const R &>()));
+
+        template <class T>
+        struct value_box
+        {
+            T value;
+        };
+
+        template <>
+        struct value_box<void>
+        {
+        };
+
+        struct stopped_tag
+        {
+        };
+
+        template <class T>
+        using completion_slot = std::variant<std::monostate, value_box<T>, std::exception_ptr, stopped_tag>;
+
+        template <class T, class R>
+        void deliver_value(R &r, value_box<T> &box) noexcept
+        {
+            if constexpr (std::is_void_v<T>)
+                r.set_value();
+            else
+                r.set_value(std::move(box.value));
+        }
+
+        template <class... Ts>
+        struct first_or_void
+        {
+            using type = void;
+        };
+
+        template <class T, class... Ts>
+        struct first_or_void<T, Ts...>
+        {
+            using type = T;
+        };
+
+        // ---- just -----------------------------------------------------------
+
+        template <class R, class... Ts>
+        class just_op
+        {
+        public:
+            just_op(R r, std::tuple<Ts...> vs) : _r(std::move(r)), _vs(std::move(vs)) {}
+            just_op(const just_op &) = delete;
+            just_op &operator=(const just_op &) = delete;
+
+            void start() noexcept
+            {
+                std::apply([this](Ts &...vs)
+                           { _r.set_value(std::move(vs)...); }, _vs);
+            }
+
+        private:
+            R _r;
+            std::tuple<Ts...> _vs;
+        };
+
+        template <class... Ts>
+        struct just_sender
+        {
+            static_assert(sizeof...(Ts) <= 1, "tw senders complete with at most one value");
+
+            using sender_concept = sender_t;
+            using value_type = typename first_or_void<Ts...>::type;
+
+            std::tuple<Ts...> vs;
+
+            template <class R>
+            just_op<R, Ts...> connect(R r) &&
+            {
+                return just_op<R, Ts...>(std::move(r), std::move(vs));
+            }
+        };
+
+        // ---- then -----------------------------------------------------------
+
+        template <class T, class F>
+        struct then_result
+        {
+            using type = std::invoke_result_t<F, T>;
+        };
+
+        template <class F>
+        struct then_result<void, F>
+        {
+            using type = std::invoke_result_t<F>;
+        };
+
+        template <class R, class F>
+        struct then_receiver
+        {
+            R r;
+            F f;
+
+            template <class... Vs>
+            void set_value(Vs &&...vs) noexcept
+            {
+                try
+                {
+                    if constexpr (std::is_void_v<std::invoke_result_t<F, Vs...>>)
+                    {
+                        std::invoke(f, std::forward<Vs>(vs)...);
+                        r.set_value();
+                    }
+                    else
+                    {
+                        r.set_value(std::invoke(f, std::forward<Vs>(vs)...));
+                    }
+                }
+                catch (...)
+                {
+                    r.set_error(std::current_exception());
+                }
+            }
+
+            void set_error(std::exception_ptr e) noexcept { r.set_error(std::move(e)); }
+            void set_stopped() noexcept { r.set_stopped(); }
+            auto get_stop_token() const noexcept { return detail::get_stop_token(r); }
+        };
+
+        template <class S, class F>
+        struct then_sender
+        {
+            using sender_concept = sender_t;
+            using value_type = typename then_result<sender_value_t<S>, F>::type;
+
+            S s;
+            F f;
+
+            template <class R>
+            auto connect(R r) &&
+            {
+                return std::move(s).connect(then_receiver<R, F>{std::move(r), std::move(f)});
+            }
+        };
+
+        template <class F>
+        struct then_closure
+        {
+            F f;
+
+            template <sender S>
+            friend auto operator|(S &&s, then_closure c)
+            {
+                return then_sender<std::decay_t<S>, F>{std::forward<S>(s), std::move(c.f)};
+            }
+        };
+
+        // ---- schedule_at ----------------------------------------------------
+
+        // Completes with set_value() on a resume_queue thread at a time
+        // point, or with set_stopped() as soon as the receiver's token fires.
+        template <class R>
+        class schedule_op : private timer_node, private resume_node
+        {
+        public:
+            schedule_op(R r, timer_node::Clock::time_point when)
+                : timer_node(&on_fire), resume_node(&on_resume), _r(std::move(r)), _when(when)
+            {
+            }
+            schedule_op(const schedule_op &) = delete;
+            schedule_op &operator=(const schedule_op &) = delete;
+
+            void start() noexcept
+            {
+                auto tok = detail::get_stop_token(_r);
+                if (tok.stop_requested())
+                {
+                    _r.set_stopped();
+                    return;
+                }
+                _refs.store(2, std::memory_order_relaxed);
+                _cb.emplace(tok, stop_fn{this});
+                timer_service::global().schedule(*this, _when);
+                if (tok.stop_requested())
+                    interrupt();
+                if (release())
+                    complete();
+            }
+
+        private:
+            struct stop_fn
+            {
+                schedule_op *self;
+                void operator()() const noexcept { self->interrupt(); }
+            };
+
+            void interrupt() noexcept
+            {
+                auto &svc = timer_service::global();
+                if (svc.cancel(*this))
+                {
+                    _stopped = true;
+                    svc.schedule(*this, timer_node::Clock::time_point::min());
+                }
+            }
+
+            bool release() noexcept { return _refs.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+            void complete() noexcept
+            {
+                _cb.reset();
+                if (_stopped)
+                    _r.set_stopped();
+                else
+                    _r.set_value();
+            }
+
+            static void on_fire(timer_node &n) noexcept
+            {
+                auto &self = static_cast<schedule_op &>(n);
+                if (self.release())
+                    resume_queue::global().post(self);
+            }
+
+            static void on_resume(resume_node &n) noexcept { static_cast<schedule_op &>(n).complete(); }
+
+            using token_t = stop_token_of_t<R>;
+
+            R _r;
+            timer_node::Clock::time_point _when;
+            std::atomic_int _refs{0};
+            bool _stopped{false};
+            std::optional<stop_callback_for_t<token_t, stop_fn>> _cb;
+        };
+
+        struct schedule_sender
+        {
+            using sender_concept = sender_t;
+            using value_type = void;
+
+            timer_node::Clock::time_point when;
+
+            template <class R>
+            schedule_op<R> connect(R r) &&
+            {
+                return schedule_op<R>(std::move(r), when);
+            }
+        };
+
+        // ---- with_timeout ---------------------------------------------------
+
+        struct scheduler_state
+        {
+            timer_node::Clock::duration default_timeout;
+            inplace_stop_source emergency;
+        };
+
+        // Runs the inner sender with its own inplace stop source. That source
+        // is triggered by the deadline, by the downstream receiver's token and
+        // by a scheduler's emergency stop, but only ever from the timer
+        // thread, so it is never destroyed while request_stop() runs. The
+        // downstream completion is then posted to the resume_queue.
+        template <class S, class R>
+        class timeout_op : private timer_node, private resume_node
+        {
+            using value_type = sender_value_t<S>;
+
+            struct inner_receiver
+            {
+                timeout_op *op;
+
+                template <class... Vs>
+                void set_value(Vs &&...vs) noexcept
+                {
+                    if constexpr (std::is_void_v<value_type>)
+                        op->_slot.template emplace<1>();
+                    else
+                        op->_slot.template emplace<1>(value_box<value_type>{value_type(std::forward<Vs>(vs)...)});
+                    op->inner_done();
+                }
+
+                void set_error(std::exception_ptr e) noexcept
+                {
+                    op->_slot.template emplace<2>(std::move(e));
+                    op->inner_done();
+                }
+
+                void set_stopped() noexcept
+                {
+                    op->_slot.template emplace<3>();
+                    op->inner_done();
+                }
+
+                inplace_stop_token get_stop_token() const noexcept { return op->_stop.get_token(); }
+            };
+
+            enum class cause : std::uint8_t
+            {
+                deadline,
+                downstream,
+                emergency
+            };
+
+            struct forward_fn
+            {
+                timeout_op *self;
+                cause why;
+                void operator()() const noexcept { self->interrupt(why); }
+            };
+
+            using token_t = stop_token_of_t<R>;
+            using inner_op_t = decltype(std::declval<S>().connect(std::declval<inner_receiver>()));
+
+        public:
+            timeout_op(S s, R r, timer_node::Clock::duration timeout, std::shared_ptr<scheduler_state> sched)
+                : timer_node(&on_fire), resume_node(&on_resume), _r(std::move(r)), _timeout(timeout),
+                  _sched(std::move(sched)),
+                  _inner(std::move(s).connect(inner_receiver{this}))
+            {
+            }
+            timeout_op(const timeout_op &) = delete;
+            timeout_op &operator=(const timeout_op &) = delete;
+
+            void start() noexcept
+            {
+                auto deadline = detail::add_sat(timer_node::Clock::now(), _timeout);
+
+                _refs.store(2, std::memory_order_relaxed);
+                timer_service::global().schedule(*this, deadline);
+                _downstream_cb.emplace(detail::get_stop_token(_r), forward_fn{this, cause::downstream});
+                if (_sched)
+                    _emergency_cb.emplace(_sched->emergency.get_token(), forward_fn{this, cause::emergency});
+                _inner.start();
+            }
+
+        private:
+            // any thread: route the stop through the timer thread
+            void interrupt(cause why) noexcept
+            {
+                auto &svc = timer_service::global();
+                if (svc.cancel(*this))
+                {
+                    _cause = why;
+                    svc.schedule(*this, timer_node::Clock::time_point::min());
+                }
+            }
+
+            static void on_fire(timer_node &n) noexcept
+            {
+                auto &self = static_cast<timeout_op &>(n);
+                self._stop.request_stop();
+                if (self.release())
+                    resume_queue::global().post(self);
+            }
+
+            static void on_resume(resume_node &n) noexcept { static_cast<timeout_op &>(n).deliver(); }
+
+            void inner_done() noexcept
+            {
+                if (timer_service::global().cancel(*this))
+                    release();
+                if (release())
+                    deliver();
+            }
+
+            bool release() noexcept { return _refs.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+            void deliver() noexcept
+            {
+                _downstream_cb.reset();
+                _emergency_cb.reset();
+                switch (_slot.index())
+                {
+                case 1:
+                    deliver_value<value_type>(_r, std::get<1>(_slot));
+                    break;
+                case 2:
+                    _r.set_error(std::move(std::get<2>(_slot)));
+                    break;
+                default:
+                    if (_stop.stop_requested() && _cause == cause::deadline)
+                        _r.set_error(std::make_exception_ptr(timeout_error{}));
+                    else
+                        _r.set_stopped();
+                    break;
+                }
+            }
+
+            R _r;
+            timer_node::Clock::duration _timeout;
+            std::shared_ptr<scheduler_state> _sched;
+            inplace_stop_source _stop;
+            std::atomic_int _refs{0};
+            cause _cause{cause::deadline};
+            completion_slot<value_type> _slot;
+            std::optional<stop_callback_for_t<token_t, forward_fn>> _downstream_cb;
+            std::optional<inplace_stop_callback<forward_fn>> _emergency_cb;
+            inner_op_t _inner;
+        };
+
+        template <class S>
+        struct timeout_sender
+        {
+            using sender_concept = sender_t;
+            using value_type = sender_value_t<S>;
+
+            S s;
+            timer_node::Clock::duration timeout;
+            std::shared_ptr<scheduler_state> sched;
+
+            template <class R>
+            timeout_op<S, R> connect(R r) &&
+            {
+                return timeout_op<S, R>(std::move(s), std::move(r), timeout, std::move(sched));
+            }
+        };
+
+        struct timeout_closure
+        {
+            timer_node::Clock::duration timeout;
+
+            template <sender S>
+            friend auto operator|(S &&s, timeout_closure c)
+            {
+                return timeout_sender<std::decay_t<S>>{std::forward<S>(s), c.timeout, nullptr};
+            }
+        };
+
+        // ---- sync_wait ------------------------------------------------------
+
+        template <class T>
+        struct sync_wait_state
+        {
+            std::mutex mtx;
+            std::condition_variable cv;
+            bool done{false};
+            completion_slot<T> slot;
+
+            template <std::size_t I, class... Args>
+            void finish(Args &&...args) noexcept
+            {
+                std::lock_guard lk(mtx);
+                slot.template emplace<I>(std::forward<Args>(args)...);
+                done = true;
+                cv.notify_all();
+            }
+        };
+
+        template <class T>
+        struct sync_wait_receiver
+        {
+            sync_wait_state<T> *st;
+
+            template <class... Vs>
+            void set_value(Vs &&...vs) noexcept
+            {
+                if constexpr (std::is_void_v<T>)
+                    st->template finish<1>();
+                else
+                    st->template finish<1>(value_box<T>{T(std::forward<Vs>(vs)...)});
+            }
+
+            void set_error(std::exception_ptr e) noexcept { st->template finish<2>(std::move(e)); }
+            void set_stopped() noexcept { st->template finish<3>(); }
+        };
+    } // namespace detail
+
+    template <class... Ts>
+    detail::just_sender<std::decay_t<Ts>...> just(Ts &&...vs)
+    {
+        return {std::tuple<std::decay_t<Ts>...>(std::forward<Ts>(vs)...)};
+    }
+
+    template <sender S, class F>
+    auto then(S &&s, F &&f)
+    {
+        return detail::then_sender<std::decay_t<S>, std::decay_t<F>>{std::forward<S>(s), std::forward<F>(f)};
+    }
+
+    template <class F>
+    detail::then_closure<std::decay_t<F>> then(F &&f)
+    {
+        return {std::forward<F>(f)};
+    }
+
+    // Gives any sender TimedWorker-style deadline semantics: when the budget
+    // runs out the sender's stop token is triggered, and if it then completes
+    // with set_stopped() the downstream receiver sees set_error(timeout_error).
+    template <sender S, class Rep, class Period>
+    auto with_timeout(S &&s, std::chrono::duration<Rep, Period> timeout)
+    {
+        return detail::timeout_sender<std::decay_t<S>>{
+            std::forward<S>(s), detail::to_worker_duration(timeout), nullptr};
+    }
+
+    template <class Rep, class Period>
+    detail::timeout_closure with_timeout(std::chrono::duration<Rep, Period> timeout)
+    {
+        return {detail::to_worker_duration(timeout)};
+    }
+
+    // Scheduler driven by the shared timer thread (no dedicated thread per
+    // operation); completions run on the shared resume_queue. Senders
+    // adapted with timed() get the scheduler's default budget and are all
+    // cancelled by emergency_stop().
+    class timed_scheduler
+    {
+    public:
+        using Clock = timer_node::Clock;
+
+        timed_scheduler() : timed_scheduler(Clock::duration::max()) {}
+
+        template <class Rep, class Period>
+        explicit timed_scheduler(std::chrono::duration<Rep, Period> default_timeout)
+            : _state(std::make_shared<detail::scheduler_state>())
+        {
+            _state->default_timeout = detail::to_worker_duration(default_timeout);
+        }
+
+        detail::schedule_sender schedule() const noexcept { return {Clock::now()}; }
+        detail::schedule_sender schedule_at(Clock::time_point tp) const noexcept { return {tp}; }
+
+        template <class Rep, class Period>
+        detail::schedule_sender schedule_after(std::chrono::duration<Rep, Period> d) const
+        {
+            return {detail::add_sat(Clock::now(), detail::to_worker_duration(d))};
+        }
+
+        template <sender S>
+        auto timed(S &&s) const
+        {
+            return detail::timeout_sender<std::decay_t<S>>{std::forward<S>(s), _state->default_timeout, _state};
+        }
+
+        template <sender S, class Rep, class Period>
+        auto timed(S &&s, std::chrono::duration<Rep, Period> timeout) const
+        {
+            return detail::timeout_sender<std::decay_t<S>>{
+                std::forward<S>(s), detail::to_worker_duration(timeout), _state};
+        }
+
+        // Stops every operation started through timed(); later ones complete
+        // with set_stopped() immediately.
+        void emergency_stop() noexcept { _state->emergency.request_stop(); }
+        bool emergency_requested() const noexcept { return _state->emergency.stop_requested(); }
+
+        friend bool operator==(const timed_scheduler &a, const timed_scheduler &b) noexcept
+        {
+            return a._state == b._state;
+        }
+
+    private:
+        std::shared_ptr<detail::scheduler_state> _state;
+    };
+
+    // Blocks until the sender completes. A timeout_error becomes timed_out,
+    // set_stopped() becomes stopped, any other error is reported as failed.
+    template <sender S>
+    timed_result<sender_value_t<S>> sync_wait(S &&s)
+    {
+        using T = sender_value_t<S>;
+        detail::sync_wait_state<T> st;
+        auto op = std::decay_t<S>(std::forward<S>(s)).connect(detail::sync_wait_receiver<T>{&st});
+        op.start();
+
+        std::unique_lock lk(st.mtx);
+        st.cv.wait(lk, [&]
+                   { return st.done; });
+
+        switch (st.slot.index())
+        {
+        case 1:
+            if constexpr (std::is_void_v<T>)
+                return timed_result<T>(timed_status::completed);
+            else
+                return timed_result<T>(timed_status::completed, std::move(std::get<1>(st.slot).value));
+        case 2:
+            try
+            {
+                std::rethrow_exception(std::get<2>(st.slot));
+            }
+            catch (const timeout_error &)
+            {
+                return timed_result<T>(timed_status::timed_out);
+            }
+            catch (...)
+            {
+                return timed_result<T>(std::current_exception());
+            }
+        default:
+            return timed_result<T>(timed_status::stopped);
+        }
+    }
+
+} // namespace tw
+
+#endif // TW_SENDER_HPP
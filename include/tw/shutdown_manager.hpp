@@ -0,0 +1,166 @@
+#ifndef TW_SHUTDOWN_MANAGER_HPP
+#define TW_SHUTDOWN_MANAGER_HPP
+#pragma once
+
+#include <tw/detail/completion_flag.hpp>
+#include <tw/timed_worker.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace tw
+{
+    struct shutdown_tier_report
+    {
+        int tier{0};
+        std::size_t workers{0};
+        // returned before the tier's deadline; the rest were detached
+        std::size_t finished{0};
+        std::chrono::nanoseconds elapsed{0};
+    };
+
+    struct shutdown_report
+    {
+        std::vector<shutdown_tier_report> tiers;
+        std::chrono::nanoseconds elapsed{0};
+
+        std::size_t workers() const noexcept
+        {
+            std::size_t n = 0;
+            for (auto const &t : tiers)
+                n += t.workers;
+            return n;
+        }
+
+        std::size_t finished() const noexcept
+        {
+            std::size_t n = 0;
+            for (auto const &t : tiers)
+                n += t.finished;
+            return n;
+        }
+
+        bool clean() const noexcept { return finished() == workers(); }
+    };
+
+    // Owns workers grouped in priority tiers and tears them down in order,
+    // lowest tier first, within one global budget. All workers of a tier
+    // are stopped together and joined in parallel. A tier may use an equal
+    // share of what is left of the budget, so time a tier does not need
+    // goes to the tiers after it. Workers still running when their tier's
+    // share is spent are detached.
+    template <class LogStream = std::ostream>
+    class shutdown_manager
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit shutdown_manager(std::chrono::nanoseconds budget = std::chrono::seconds(1))
+            : _budget(detail::to_worker_duration(budget))
+        {
+        }
+
+        shutdown_manager(const shutdown_manager &) = delete;
+        shutdown_manager &operator=(const shutdown_manager &) = delete;
+
+        ~shutdown_manager() { shutdown(); }
+
+        // After shutdown() a worker is no longer kept: it is destroyed, and
+        // so stopped, right away.
+        void add(int tier, TimedWorker<LogStream> w)
+        {
+            std::lock_guard lk(_mtx);
+            if (!_done)
+                _tiers[tier].push_back(std::move(w));
+        }
+
+        std::size_t size() const
+        {
+            std::lock_guard lk(_mtx);
+            std::size_t n = 0;
+            for (auto const &[tier, ws] : _tiers)
+                n += ws.size();
+            return n;
+        }
+
+        bool shut_down() const
+        {
+            std::lock_guard lk(_mtx);
+            return _done;
+        }
+
+        shutdown_report shutdown() { return shutdown(_budget); }
+
+        // Only the first call shuts down; later ones wait for it and return
+        // its report. The workers are stopped without the lock held, so
+        // they may still call into the manager meanwhile.
+        template <class Rep, class Period>
+        shutdown_report shutdown(std::chrono::duration<Rep, Period> budget)
+        {
+            tier_map tiers;
+            bool first;
+            {
+                std::lock_guard lk(_mtx);
+                first = !_done;
+                _done = true;
+                tiers.swap(_tiers);
+            }
+            if (!first)
+            {
+                _reported.wait();
+                std::lock_guard lk(_mtx);
+                return _report;
+            }
+
+            shutdown_report report;
+            auto start = Clock::now();
+            auto end = detail::add_sat(start, detail::to_worker_duration(budget));
+            auto left = static_cast<Clock::rep>(tiers.size());
+            for (auto &[tier, ws] : tiers)
+            {
+                auto t0 = Clock::now();
+                auto share = end > t0 ? (end - t0) / left : Clock::duration::zero();
+                --left;
+                auto deadline = detail::add_sat(t0, share);
+
+                for (auto &w : ws)
+                    w.request_stop();
+                shutdown_tier_report rep{tier, ws.size()};
+                for (auto &w : ws)
+                {
+                    if (w.wait_until(deadline))
+                        ++rep.finished;
+                    else
+                        w.emergency_stop();
+                }
+                ws.clear();
+                rep.elapsed = Clock::now() - t0;
+                report.tiers.push_back(rep);
+            }
+            report.elapsed = Clock::now() - start;
+
+            std::lock_guard lk(_mtx);
+            _report = report;
+            _reported.set();
+            return report;
+        }
+
+    private:
+        using tier_map = std::map<int, std::vector<TimedWorker<LogStream>>>;
+
+        Clock::duration _budget;
+        mutable std::mutex _mtx;
+        tier_map _tiers;
+        bool _done{false};
+        shutdown_report _report;
+        detail::completion_flag _reported;
+    };
+
+} // namespace tw
+
+#endif // TW_SHUTDOWN_MANAGER_HPP
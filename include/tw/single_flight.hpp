@@ -0,0 +1,293 @@
+#ifndef TW_SINGLE_FLIGHT_HPP
+#define TW_SINGLE_FLIGHT_HPP
+#pragma once
+
+#include <tw/detail/completion_flag.hpp>
+#include <tw/timed_result.hpp>
+#include <tw/timed_worker.hpp>
+
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tw
+{
+    namespace detail
+    {
+        // Outcome of one flight. The worker thread keeps it alive, so it is
+        // written safely even after every caller has left.
+        template <class T>
+        struct flight_state
+        {
+            std::stop_source abandon;
+            std::chrono::steady_clock::time_point deadline{};
+            std::optional<T> value;
+            std::exception_ptr error;
+            timed_status status{timed_status::stopped};
+            completion_flag done;
+
+            timed_result<T> result() const
+            {
+                if (error)
+                    return timed_result<T>(error);
+                if (value)
+                    return timed_result<T>(status, *value);
+                return timed_result<T>(status);
+            }
+        };
+
+        // Runs a flight's computation; completes the flight even if the
+        // worker never got to call it (stop came before the thread started).
+        // A runner unwound from a failed launch leaves that to the launcher,
+        // which reports the failure.
+        template <class T, class F>
+        struct flight_runner
+        {
+            using Clock = std::chrono::steady_clock;
+
+            flight_runner(std::shared_ptr<flight_state<T>> s, F f) : state(std::move(s)), fn(std::move(f)) {}
+            flight_runner(flight_runner &&) = default;
+            flight_runner &operator=(flight_runner &&) = delete;
+
+            ~flight_runner()
+            {
+                if (state && !state->done.is_set() && std::uncaught_exceptions() == 0)
+                {
+                    state->status = Clock::now() >= state->deadline ? timed_status::timed_out : timed_status::stopped;
+                    state->done.set();
+                }
+            }
+
+            void operator()(std::stop_token wst)
+            {
+                // stop when the budget runs out or every caller has left
+                std::stop_source inner;
+                std::stop_callback byDeadline(wst, forward_stop{&inner});
+                std::stop_callback byCallers(state->abandon.get_token(), forward_stop{&inner});
+                try
+                {
+                    state->value.emplace(fn(inner.get_token()));
+                    state->status = !inner.stop_requested()             ? timed_status::completed
+                                    : Clock::now() >= state->deadline ? timed_status::timed_out
+                                                                      : timed_status::stopped;
+                }
+                catch (...)
+                {
+                    state->error = std::current_exception();
+                    state->status = timed_status::failed;
+                }
+                state->done.set();
+            }
+
+            std::shared_ptr<flight_state<T>> state;
+            F fn;
+        };
+    } // namespace detail
+
+    // Deduplicates concurrent timed computations by key. The first caller
+    // for a key starts a TimedWorker; callers arriving while it runs attach
+    // to it and share its result. Every caller waits only up to its own
+    // deadline, and the computation is asked to stop only once all of its
+    // callers have given up (or its own budget runs out).
+    template <class Key, class T, class LogStream = std::ostream, class Hash = std::hash<Key>>
+    class single_flight
+    {
+        static_assert(!std::is_void_v<T>, "single_flight shares a value; use a placeholder type for void work");
+
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit single_flight(LogStream &log = std::cerr,
+                               std::chrono::nanoseconds shutdown_grace = std::chrono::milliseconds(10))
+            : _log(log), _grace(shutdown_grace)
+        {
+        }
+
+        single_flight(const single_flight &) = delete;
+        single_flight &operator=(const single_flight &) = delete;
+
+        // Computations still running, abandoned or not, are stopped together
+        // and get shutdown_grace in all, counted from the same moment.
+        ~single_flight()
+        {
+            std::vector<TimedWorker<LogStream> *> running;
+            for (auto &[key, e] : _flights)
+                if (e.worker)
+                    running.push_back(e.worker.get());
+            for (auto &w : _retired)
+                running.push_back(w.get());
+
+            for (auto *w : running)
+                w->request_stop();
+            auto deadline = detail::add_sat(detail::worker_clock::now(), _grace);
+            for (auto *w : running)
+                if (!w->wait_until(deadline))
+                    w->emergency_stop();
+        }
+
+        // `budget` bounds the shared computation and is only used by the
+        // caller that starts it; `wait_deadline` bounds this caller's wait.
+        template <class Rep, class Period, class C, class D, class F>
+            requires std::invocable<std::decay_t<F> &, std::stop_token> &&
+                     std::convertible_to<std::invoke_result_t<std::decay_t<F> &, std::stop_token>, T>
+        timed_result<T> run(Key const &key, std::chrono::duration<Rep, Period> budget,
+                            std::chrono::time_point<C, D> wait_deadline, F &&f)
+        {
+            auto until = detail::to_worker_time(wait_deadline);
+            std::shared_ptr<detail::flight_state<T>> st;
+            bool starter = false;
+            std::vector<std::unique_ptr<TimedWorker<LogStream>>> reap;
+            {
+                std::lock_guard lk(_mtx);
+                collect_retired(reap);
+
+                auto it = _flights.find(key);
+                if (it != _flights.end() && it->second.state->done.is_set())
+                {
+                    // finished but not yet collected: start afresh
+                    if (it->second.worker)
+                        _retired.push_back(std::move(it->second.worker));
+                    _flights.erase(it);
+                    it = _flights.end();
+                }
+                if (it == _flights.end())
+                {
+                    it = _flights.emplace(key, entry(std::make_shared<detail::flight_state<T>>())).first;
+                    starter = true;
+                }
+                ++it->second.waiters;
+                st = it->second.state;
+            }
+            reap.clear();
+
+            // the worker is built outside the lock: admission against the
+            // detach budget may block, or run the computation right here
+            if (starter)
+                start(key, st, budget, std::forward<F>(f));
+
+            bool finished = st->done.wait_until(until);
+            leave(key, st);
+            if (!finished)
+                return timed_result<T>(timed_status::timed_out);
+            return st->result();
+        }
+
+        template <class Rep1, class Period1, class Rep2, class Period2, class F>
+            requires std::invocable<std::decay_t<F> &, std::stop_token> &&
+                     std::convertible_to<std::invoke_result_t<std::decay_t<F> &, std::stop_token>, T>
+        timed_result<T> run(Key const &key, std::chrono::duration<Rep1, Period1> budget,
+                            std::chrono::duration<Rep2, Period2> wait, F &&f)
+        {
+            return run(key, budget, detail::add_sat(Clock::now(), detail::to_worker_duration(wait)),
+                       std::forward<F>(f));
+        }
+
+        // Keys with a computation in progress.
+        std::size_t in_flight() const
+        {
+            std::lock_guard lk(_mtx);
+            return _flights.size();
+        }
+
+    private:
+        struct entry
+        {
+            explicit entry(std::shared_ptr<detail::flight_state<T>> s) noexcept : state(std::move(s)) {}
+
+            std::shared_ptr<detail::flight_state<T>> state;
+            std::unique_ptr<TimedWorker<LogStream>> worker;
+            std::size_t waiters{0};
+        };
+
+        using map_t = std::unordered_map<Key, entry, Hash>;
+
+        // Runs the flight's computation in a new worker, then hands the
+        // worker to its map entry. Called without _mtx held.
+        template <class Rep, class Period, class F>
+        void start(Key const &key, std::shared_ptr<detail::flight_state<T>> const &st,
+                   std::chrono::duration<Rep, Period> budget, F &&f)
+        {
+            st->deadline = detail::add_sat(Clock::now(), detail::to_worker_duration(budget));
+
+            std::unique_ptr<TimedWorker<LogStream>> w;
+            try
+            {
+                w = std::make_unique<TimedWorker<LogStream>>(make_timed_worker(
+                    st->deadline, _grace, detail::flight_runner<T, std::decay_t<F>>(st, std::forward<F>(f)), _log));
+            }
+            catch (...)
+            {
+                // callers that attached meanwhile see the failure too
+                st->error = std::current_exception();
+                st->status = timed_status::failed;
+                st->done.set();
+                leave(key, st);
+                throw;
+            }
+
+            std::lock_guard lk(_mtx);
+            auto it = _flights.find(key);
+            // the entry can only have gone if the computation has finished;
+            // w then joins right away, after the lock is released
+            if (it != _flights.end() && it->second.state == st)
+                it->second.worker = std::move(w);
+        }
+
+        void leave(Key const &key, std::shared_ptr<detail::flight_state<T>> const &st)
+        {
+            std::unique_ptr<TimedWorker<LogStream>> gone;
+            {
+                std::lock_guard lk(_mtx);
+                auto it = _flights.find(key);
+                if (it == _flights.end() || it->second.state != st)
+                    return;
+                if (--it->second.waiters != 0 && !st->done.is_set())
+                    return;
+
+                if (!st->done.is_set())
+                {
+                    st->abandon.request_stop();
+                    if (it->second.worker)
+                        _retired.push_back(std::move(it->second.worker));
+                }
+                else
+                {
+                    gone = std::move(it->second.worker);
+                }
+                _flights.erase(it);
+            }
+            // a finished worker joins immediately
+        }
+
+        void collect_retired(std::vector<std::unique_ptr<TimedWorker<LogStream>>> &out)
+        {
+            for (auto &w : _retired)
+            {
+                if (w->done())
+                    out.push_back(std::move(w));
+            }
+            std::erase(_retired, nullptr);
+        }
+
+        LogStream &_log;
+        std::chrono::nanoseconds _grace;
+        mutable std::mutex _mtx;
+        map_t _flights;
+        // abandoned computations that have not returned yet
+        std::vector<std::unique_ptr<TimedWorker<LogStream>>> _retired;
+    };
+
+} // namespace tw
+
+#endif // TW_SINGLE_FLIGHT_HPP
@@ -0,0 +1,291 @@
+#ifndef TW_SLICE_SCHEDULER_HPP
+#define TW_SLICE_SCHEDULER_HPP
+#pragma once
+
+#include <tw/detail/completion_flag.hpp>
+#include <tw/this_worker.hpp>
+#include <tw/timed_result.hpp>
+#include <tw/timed_worker.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tw
+{
+    // What a time-sliced callable returns after each slice.
+    enum class slice : std::uint8_t
+    {
+        yield,
+        done
+    };
+
+    struct slice_options
+    {
+        std::size_t threads{std::thread::hardware_concurrency()};
+        // longest a task runs before this_worker::yield_point() says so
+        std::chrono::nanoseconds quantum{std::chrono::milliseconds(1)};
+        // time a stopped worker gets to return before it is detached
+        std::chrono::nanoseconds shutdown_grace{std::chrono::milliseconds(10)};
+    };
+
+    namespace detail
+    {
+        struct sliced_task
+        {
+            using Clock = worker_clock;
+
+            virtual ~sliced_task() = default;
+            virtual slice step(std::stop_token const &st) = 0;
+
+            void finish(timed_status s, std::exception_ptr err = nullptr) noexcept
+            {
+                status = s;
+                error = std::move(err);
+                done.set();
+            }
+
+            Clock::time_point deadline;
+            std::stop_source src;
+            std::atomic<std::uint64_t> slices{0};
+            timed_status status{timed_status::stopped};
+            std::exception_ptr error;
+            completion_flag done;
+        };
+
+        template <class F>
+        struct sliced_task_for final : sliced_task
+        {
+            explicit sliced_task_for(F f) : fn(std::move(f)) {}
+            slice step(std::stop_token const &st) override { return fn(st); }
+            F fn;
+        };
+
+        // Round-robin run queue shared with the scheduler's workers.
+        struct slice_queue
+        {
+            std::mutex mtx;
+            std::condition_variable_any cv;
+            std::deque<std::shared_ptr<sliced_task>> ready;
+            bool closed{false};
+
+            void push(std::shared_ptr<sliced_task> t)
+            {
+                {
+                    std::lock_guard lk(mtx);
+                    if (!closed)
+                    {
+                        ready.push_back(std::move(t));
+                        t = nullptr;
+                    }
+                }
+                if (t)
+                    t->finish(timed_status::stopped);
+                else
+                    cv.notify_one();
+            }
+
+            std::shared_ptr<sliced_task> pop(std::stop_token const &st)
+            {
+                std::unique_lock lk(mtx);
+                if (!cv.wait(lk, st, [this]
+                             { return !ready.empty() || closed; }) ||
+                    ready.empty())
+                    return nullptr;
+                auto t = std::move(ready.front());
+                ready.pop_front();
+                return t;
+            }
+
+            // Tasks that never get another slice report stopped.
+            void close()
+            {
+                std::deque<std::shared_ptr<sliced_task>> left;
+                {
+                    std::lock_guard lk(mtx);
+                    closed = true;
+                    left.swap(ready);
+                }
+                cv.notify_all();
+                for (auto &t : left)
+                    t->finish(timed_status::stopped);
+            }
+        };
+    } // namespace detail
+
+    // Handle to a task running on a slice_scheduler.
+    class slice_handle
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        slice_handle() = default;
+        explicit slice_handle(std::shared_ptr<detail::sliced_task> t) noexcept : _t(std::move(t)) {}
+
+        bool valid() const noexcept { return static_cast<bool>(_t); }
+        bool done() const noexcept { return _t->done.is_set(); }
+        void wait() const noexcept { _t->done.wait(); }
+        bool wait_until(Clock::time_point tp) const noexcept { return _t->done.wait_until(tp); }
+
+        // Takes effect at the task's next yield_point() or slice boundary.
+        void request_stop() noexcept { _t->src.request_stop(); }
+
+        // Slices the task has been given so far.
+        std::uint64_t slices() const noexcept { return _t->slices.load(std::memory_order_relaxed); }
+
+        // Blocks until the task has finished.
+        timed_result<void> result() const
+        {
+            wait();
+            if (_t->error)
+                return timed_result<void>(_t->error);
+            return timed_result<void>(_t->status);
+        }
+
+    private:
+        std::shared_ptr<detail::sliced_task> _t;
+    };
+
+    // Multiplexes many long-running callables over a fixed set of workers.
+    // A task is called as f(std::stop_token) -> tw::slice, runs until
+    // this_worker::yield_point() reports its quantum spent, then returns
+    // slice::yield with its progress kept in its own state. It goes to the
+    // back of the run queue, so short tasks are never stuck behind long
+    // ones. Each task also has a global deadline: a task still running
+    // when it passes is stopped, mid-slice if need be, and reports
+    // timed_out. A running slice is also stopped when the scheduler is.
+    template <class LogStream = std::ostream>
+    class slice_scheduler
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit slice_scheduler(slice_options const &opts = {}, LogStream &log = std::cerr)
+            : _quantum(detail::to_worker_duration(opts.quantum)), _grace(detail::to_worker_duration(opts.shutdown_grace)),
+              _clock(detail::current_clock), _q(std::make_shared<detail::slice_queue>())
+        {
+            auto threads = std::max<std::size_t>(opts.threads, 1);
+            _workers.reserve(threads);
+            for (std::size_t i = 0; i < threads; ++i)
+                _workers.push_back(detail::make_service_worker(opts.shutdown_grace, [q = _q, quantum = _quantum, clock = _clock](std::stop_token st)
+                                                              {
+                    while (auto t = q->pop(st))
+                        run_slice(*q, std::move(t), quantum, clock, st); }, log));
+        }
+
+        slice_scheduler(const slice_scheduler &) = delete;
+        slice_scheduler &operator=(const slice_scheduler &) = delete;
+
+        // Tasks that have not finished report stopped. Running slices get
+        // shutdown_grace to return, all counted from the same moment.
+        ~slice_scheduler()
+        {
+            _q->close();
+            for (auto &w : _workers)
+                w.request_stop();
+            auto deadline = detail::add_sat(now(_clock), _grace);
+            for (auto &w : _workers)
+                if (!w.wait_until(deadline))
+                    w.emergency_stop();
+        }
+
+        template <class F, class C, class D>
+            requires std::invocable<F &, std::stop_token const &> &&
+                     std::same_as<std::invoke_result_t<F &, std::stop_token const &>, slice>
+        slice_handle spawn(F f, std::chrono::time_point<C, D> deadline)
+        {
+            auto t = std::make_shared<detail::sliced_task_for<F>>(std::move(f));
+            t->deadline = detail::to_worker_time(deadline);
+            slice_handle h(t);
+            _q->push(std::move(t));
+            return h;
+        }
+
+        template <class F, class Rep, class Period>
+            requires std::invocable<F &, std::stop_token const &> &&
+                     std::same_as<std::invoke_result_t<F &, std::stop_token const &>, slice>
+        slice_handle spawn(F f, std::chrono::duration<Rep, Period> budget)
+        {
+            return spawn(std::move(f), detail::add_sat(detail::clock_now(), detail::to_worker_duration(budget)));
+        }
+
+        std::size_t threads() const noexcept { return _workers.size(); }
+
+        std::size_t queued() const
+        {
+            std::lock_guard lk(_q->mtx);
+            return _q->ready.size();
+        }
+
+    private:
+        static Clock::time_point now(virtual_clock *clock) { return clock ? clock->now() : Clock::now(); }
+
+        // Task deadlines follow the scheduler's clock; the quantum is always
+        // real time.
+        static void run_slice(detail::slice_queue &q, std::shared_ptr<detail::sliced_task> t, Clock::duration quantum,
+                              virtual_clock *clock, std::stop_token const &wst)
+        {
+            if (now(clock) >= t->deadline)
+            {
+                t->src.request_stop();
+                return t->finish(timed_status::timed_out);
+            }
+            if (t->src.stop_requested())
+                return t->finish(timed_status::stopped);
+
+            slice r;
+            bool late;
+            t->slices.fetch_add(1, std::memory_order_relaxed);
+            {
+                auto st = t->src.get_token();
+                std::stop_callback byScheduler(wst, detail::forward_stop{&t->src});
+                detail::scoped_deadline limit(t->src, t->deadline, clock);
+                detail::slice_scope scope(detail::add_sat(Clock::now(), quantum), st);
+                try
+                {
+                    r = t->step(st);
+                }
+                catch (...)
+                {
+                    return t->finish(timed_status::failed, std::current_exception());
+                }
+                late = limit.finish();
+            }
+
+            if (late)
+                return t->finish(timed_status::timed_out);
+            if (r == slice::done)
+            {
+                if (t->src.stop_requested())
+                    t->finish(timed_status::stopped);
+                else
+                    t->finish(now(clock) > t->deadline ? timed_status::timed_out : timed_status::completed);
+                return;
+            }
+            q.push(std::move(t));
+        }
+
+        Clock::duration _quantum;
+        Clock::duration _grace;
+        // the clock the scheduler was built under, if any
+        virtual_clock *_clock;
+        std::shared_ptr<detail::slice_queue> _q;
+        std::vector<TimedWorker<LogStream>> _workers;
+    };
+
+} // namespace tw
+
+#endif // TW_SLICE_SCHEDULER_HPP
@@ -0,0 +1,238 @@
+#ifndef TW_STOP_TOKEN_HPP
+#define TW_STOP_TOKEN_HPP
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+namespace tw
+{
+    class inplace_stop_source;
+
+    // Token that can never be stopped; its callbacks are empty.
+    struct never_stop_token
+    {
+        static constexpr bool stop_requested() noexcept { return false; }
+        static constexpr bool stop_possible() noexcept { return false; }
+        friend constexpr bool operator==(never_stop_token, never_stop_token) noexcept { return true; }
+    };
+
+    class inplace_stop_token
+    {
+    public:
+        inplace_stop_token() noexcept = default;
+
+        bool stop_requested() const noexcept;
+        bool stop_possible() const noexcept { return _src != nullptr; }
+
+        friend bool operator==(inplace_stop_token a, inplace_stop_token b) noexcept { return a._src == b._src; }
+
+    private:
+        friend class inplace_stop_source;
+        template <class F>
+        friend class inplace_stop_callback;
+
+        explicit inplace_stop_token(const inplace_stop_source *src) noexcept : _src(src) {}
+
+        const inplace_stop_source *_src{nullptr};
+    };
+
+    namespace detail
+    {
+        class inplace_callback_base
+        {
+        public:
+            inplace_callback_base(const inplace_callback_base &) = delete;
+            inplace_callback_base &operator=(const inplace_callback_base &) = delete;
+
+        protected:
+            using invoke_fn = void (*)(inplace_callback_base &) noexcept;
+
+            explicit inplace_callback_base(invoke_fn fn) noexcept : _invoke(fn) {}
+
+        private:
+            friend class tw::inplace_stop_source;
+
+            invoke_fn _invoke;
+            inplace_callback_base *_next{nullptr};
+            inplace_callback_base *_prev{nullptr};
+            bool *_removed{nullptr};
+            std::atomic_bool _finished{false};
+        };
+    } // namespace detail
+
+    // Non-allocating, non-movable stop source meant to live inside an
+    // operation state. Callbacks are stored intrusively in the callback
+    // objects themselves; the source must outlive every registered callback.
+    class inplace_stop_source
+    {
+    public:
+        inplace_stop_source() noexcept = default;
+        inplace_stop_source(const inplace_stop_source &) = delete;
+        inplace_stop_source &operator=(const inplace_stop_source &) = delete;
+
+        inplace_stop_token get_token() const noexcept { return inplace_stop_token(this); }
+        bool stop_requested() const noexcept { return _stopped.load(std::memory_order_acquire); }
+
+        // Runs every registered callback on the calling thread. Returns false
+        // if stop had already been requested.
+        bool request_stop() noexcept
+        {
+            std::unique_lock lk(_mtx);
+            if (_stopped.load(std::memory_order_relaxed))
+                return false;
+            _stopped.store(true, std::memory_order_release);
+            _notifier = std::this_thread::get_id();
+
+            while (_head)
+            {
+                auto *cb = _head;
+                unlink(cb);
+                _executing = cb;
+                bool removed = false;
+                cb->_removed = &removed;
+                lk.unlock();
+
+                cb->_invoke(*cb);
+
+                lk.lock();
+                _executing = nullptr;
+                if (!removed)
+                {
+                    cb->_removed = nullptr;
+                    cb->_finished.store(true, std::memory_order_release);
+                }
+            }
+            return true;
+        }
+
+    private:
+        template <class F>
+        friend class inplace_stop_callback;
+
+        // Returns false (without registering) if stop was already requested.
+        bool try_add(detail::inplace_callback_base *cb) noexcept
+        {
+            std::lock_guard lk(_mtx);
+            if (_stopped.load(std::memory_order_relaxed))
+                return false;
+            cb->_next = _head;
+            if (_head)
+                _head->_prev = cb;
+            _head = cb;
+            return true;
+        }
+
+        void remove(detail::inplace_callback_base *cb) noexcept
+        {
+            std::unique_lock lk(_mtx);
+            if (cb->_prev || _head == cb)
+            {
+                unlink(cb);
+                return;
+            }
+            if (_executing != cb)
+                return;
+            if (_notifier == std::this_thread::get_id())
+            {
+                // destroyed from inside its own callback
+                *cb->_removed = true;
+                return;
+            }
+            lk.unlock();
+            while (!cb->_finished.load(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+
+        void unlink(detail::inplace_callback_base *cb) noexcept
+        {
+            if (cb->_prev)
+                cb->_prev->_next = cb->_next;
+            else
+                _head = cb->_next;
+            if (cb->_next)
+                cb->_next->_prev = cb->_prev;
+            cb->_next = cb->_prev = nullptr;
+        }
+
+        std::atomic_bool _stopped{false};
+        mutable std::mutex _mtx;
+        detail::inplace_callback_base *_head{nullptr};
+        detail::inplace_callback_base *_executing{nullptr};
+        std::thread::id _notifier;
+    };
+
+    inline bool inplace_stop_token::stop_requested() const noexcept
+    {
+        return _src && _src->stop_requested();
+    }
+
+    template <class F>
+    class inplace_stop_callback : private detail::inplace_callback_base
+    {
+    public:
+        template <class G>
+        inplace_stop_callback(inplace_stop_token tok, G &&g) noexcept(std::is_nothrow_constructible_v<F, G>)
+            : detail::inplace_callback_base(&invoke), _fn(std::forward<G>(g)),
+              _src(const_cast<inplace_stop_source *>(tok._src))
+        {
+            if (_src && !_src->try_add(this))
+            {
+                _src = nullptr;
+                _fn();
+            }
+        }
+
+        ~inplace_stop_callback()
+        {
+            if (_src)
+                _src->remove(this);
+        }
+
+    private:
+        static void invoke(detail::inplace_callback_base &b) noexcept
+        {
+            static_cast<inplace_stop_callback &>(b)._fn();
+        }
+
+        F _fn;
+        inplace_stop_source *_src;
+    };
+
+    // Callback type to pair with a given stop token type.
+    template <class Token, class F>
+    struct stop_callback_for;
+
+    template <class F>
+    struct stop_callback_for<std::stop_token, F>
+    {
+        using type = std::stop_callback<F>;
+    };
+
+    template <class F>
+    struct stop_callback_for<inplace_stop_token, F>
+    {
+        using type = inplace_stop_callback<F>;
+    };
+
+    template <class F>
+    struct stop_callback_for<never_stop_token, F>
+    {
+        struct type
+        {
+            template <class G>
+            type(never_stop_token, G &&) noexcept
+            {
+            }
+        };
+    };
+
+    template <class Token, class F>
+    using stop_callback_for_t = typename stop_callback_for<Token, F>::type;
+
+} // namespace tw
+
+#endif // TW_STOP_TOKEN_HPP
@@ -0,0 +1,366 @@
+#ifndef TW_STREAMING_WORKER_HPP
+#define TW_STREAMING_WORKER_HPP
+#pragma once
+
+#include <tw/detail/event_count.hpp>
+#include <tw/timed_worker.hpp>
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stop_token>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tw
+{
+    namespace detail
+    {
+        // Wait-free single-producer/single-consumer ring. Each side owns one
+        // cursor and keeps a cached copy of the other's, so the common case
+        // touches no shared cache line at all.
+        template <class T>
+        class spsc_ring
+        {
+        public:
+            using Clock = std::chrono::steady_clock;
+
+            explicit spsc_ring(std::size_t capacity)
+                : _mask(std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity) - 1),
+                  _slots(std::make_unique<slot[]>(_mask + 1))
+            {
+            }
+
+            spsc_ring(const spsc_ring &) = delete;
+            spsc_ring &operator=(const spsc_ring &) = delete;
+
+            ~spsc_ring()
+            {
+                auto h = _head.load(std::memory_order_relaxed);
+                auto t = _tail.load(std::memory_order_relaxed);
+                for (; h != t; ++h)
+                    _slots[h & _mask].ptr()->~T();
+            }
+
+            std::size_t capacity() const noexcept { return _mask + 1; }
+
+            std::size_t size() const noexcept
+            {
+                return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+            }
+
+            // ---- producer side ----
+
+            template <class U>
+            bool try_push(U &&v)
+            {
+                auto t = _tail.load(std::memory_order_relaxed);
+                if (t - _headCache > _mask)
+                {
+                    _headCache = _head.load(std::memory_order_acquire);
+                    if (t - _headCache > _mask)
+                        return false;
+                }
+                ::new (static_cast<void *>(_slots[t & _mask].storage)) T(std::forward<U>(v));
+                _tail.store(t + 1, std::memory_order_release);
+                _notEmpty.notify();
+                return true;
+            }
+
+            // Blocks while full, until stop or the deadline.
+            template <class U>
+            bool push(U &&v, std::stop_token const &st, Clock::time_point deadline)
+            {
+                if (try_push(std::forward<U>(v)))
+                    return true;
+                std::stop_callback onStop(st, wake_full{this});
+                for (;;)
+                {
+                    auto key = _notFull.prepare_wait();
+                    if (try_push(std::forward<U>(v)))
+                    {
+                        _notFull.cancel_wait();
+                        return true;
+                    }
+                    if (st.stop_requested())
+                    {
+                        _notFull.cancel_wait();
+                        return false;
+                    }
+                    if (!_notFull.wait_until(key, deadline))
+                        return try_push(std::forward<U>(v));
+                }
+            }
+
+            // The producer will push nothing more.
+            void finish() noexcept
+            {
+                _finished.store(true, std::memory_order_release);
+                _notEmpty.wake();
+            }
+
+            // ---- consumer side ----
+
+            std::optional<T> try_pop()
+            {
+                auto h = _head.load(std::memory_order_relaxed);
+                if (h == _tailCache)
+                {
+                    _tailCache = _tail.load(std::memory_order_acquire);
+                    if (h == _tailCache)
+                        return std::nullopt;
+                }
+                auto &s = _slots[h & _mask];
+                std::optional<T> out(std::move(*s.ptr()));
+                s.ptr()->~T();
+                _head.store(h + 1, std::memory_order_release);
+                _notFull.notify();
+                return out;
+            }
+
+            // Blocks until an item arrives, the producer has finished, or the
+            // deadline passes.
+            std::optional<T> pop(Clock::time_point deadline)
+            {
+                for (;;)
+                {
+                    if (auto v = try_pop())
+                        return v;
+                    if (finished())
+                        return try_pop();
+                    auto key = _notEmpty.prepare_wait();
+                    if (_tail.load(std::memory_order_acquire) != _head.load(std::memory_order_relaxed) || finished())
+                    {
+                        _notEmpty.cancel_wait();
+                        continue;
+                    }
+                    if (!_notEmpty.wait_until(key, deadline))
+                        return try_pop();
+                }
+            }
+
+            bool finished() const noexcept { return _finished.load(std::memory_order_acquire); }
+
+        private:
+            struct slot
+            {
+                alignas(T) unsigned char storage[sizeof(T)];
+                T *ptr() noexcept { return std::launder(reinterpret_cast<T *>(storage)); }
+            };
+
+            struct wake_full
+            {
+                spsc_ring *ring;
+                void operator()() const noexcept { ring->_notFull.wake(); }
+            };
+
+            const std::size_t _mask;
+            std::unique_ptr<slot[]> _slots;
+            alignas(64) std::atomic<std::size_t> _head{0};
+            std::size_t _tailCache{0};
+            alignas(64) std::atomic<std::size_t> _tail{0};
+            std::size_t _headCache{0};
+            alignas(64) std::atomic_bool _finished{false};
+            event_count _notEmpty;
+            event_count _notFull;
+        };
+
+        // Marks the stream finished when the worker is done with the
+        // callable, including when it never got to run it.
+        template <class T, class F>
+        struct stream_runner
+        {
+            stream_runner(std::shared_ptr<spsc_ring<T>> r, std::chrono::steady_clock::time_point dl, F f)
+                : ring(std::move(r)), deadline(dl), fn(std::move(f))
+            {
+            }
+            stream_runner(stream_runner &&) = default;
+            stream_runner &operator=(stream_runner &&) = delete;
+
+            ~stream_runner()
+            {
+                if (ring)
+                    ring->finish();
+            }
+
+            void operator()(std::stop_token st);
+
+            std::shared_ptr<spsc_ring<T>> ring;
+            std::chrono::steady_clock::time_point deadline;
+            F fn;
+        };
+    } // namespace detail
+
+    // Producer end handed to a streaming worker's callable.
+    template <class T>
+    class stream_producer
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        stream_producer(detail::spsc_ring<T> &ring, std::stop_token st, Clock::time_point deadline) noexcept
+            : _ring(ring), _st(std::move(st)), _deadline(deadline)
+        {
+        }
+
+        // Blocks while the consumer is behind, but never past the worker's
+        // deadline or a stop request; false means the item was not queued.
+        bool push(T const &v) { return _ring.push(v, _st, _deadline); }
+        bool push(T &&v) { return _ring.push(std::move(v), _st, _deadline); }
+
+        bool try_push(T const &v) { return _ring.try_push(v); }
+        bool try_push(T &&v) { return _ring.try_push(std::move(v)); }
+
+        Clock::time_point deadline() const noexcept { return _deadline; }
+
+    private:
+        detail::spsc_ring<T> &_ring;
+        std::stop_token _st;
+        Clock::time_point _deadline;
+    };
+
+    template <class T, class F>
+    void detail::stream_runner<T, F>::operator()(std::stop_token st)
+    {
+        stream_producer<T> out(*ring, st, deadline);
+        fn(st, out);
+    }
+
+    // Owner end: a TimedWorker whose results are consumed while it runs.
+    // Whatever was produced stays readable after the worker finishes, times
+    // out or is stopped.
+    template <class T, class LogStream = std::ostream>
+    class StreamingTimedWorker
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        StreamingTimedWorker(std::shared_ptr<detail::spsc_ring<T>> ring, TimedWorker<LogStream> &&w)
+            : _ring(std::move(ring)), _readBy(detail::add_sat(w.deadline(), w.shutdown_grace())),
+              _worker(std::move(w))
+        {
+        }
+
+        StreamingTimedWorker(StreamingTimedWorker &&) noexcept = default;
+        StreamingTimedWorker(const StreamingTimedWorker &) = delete;
+        StreamingTimedWorker &operator=(const StreamingTimedWorker &) = delete;
+
+        // Next item; nullopt once the producer has finished and everything
+        // has been read, or once the run deadline plus the shutdown grace
+        // has passed without one (see timed_out()).
+        std::optional<T> next() { return _ring->pop(_readBy); }
+
+        // nullopt also when nothing arrived before the deadline.
+        template <class C, class D>
+        std::optional<T> next_until(std::chrono::time_point<C, D> deadline)
+        {
+            return _ring->pop(detail::to_worker_time(deadline));
+        }
+
+        template <class Rep, class Period>
+        std::optional<T> next_for(std::chrono::duration<Rep, Period> d)
+        {
+            return _ring->pop(detail::add_sat(Clock::now(), detail::to_worker_duration(d)));
+        }
+
+        std::optional<T> try_next() { return _ring->try_pop(); }
+
+        // Everything buffered right now.
+        std::vector<T> drain()
+        {
+            std::vector<T> out;
+            while (auto v = _ring->try_pop())
+                out.push_back(std::move(*v));
+            return out;
+        }
+
+        // The producer has returned; buffered items may remain.
+        bool finished() const noexcept { return _ring->finished(); }
+
+        // The producer overran its deadline and grace without returning;
+        // next() and the range no longer wait for it.
+        bool timed_out() const noexcept { return !_ring->finished() && Clock::now() >= _readBy; }
+        std::size_t buffered() const noexcept { return _ring->size(); }
+
+        void request_stop() noexcept { _worker.request_stop(); }
+        void emergency_stop() noexcept { _worker.emergency_stop(); }
+        bool done() const noexcept { return _worker.done(); }
+        TimedWorker<LogStream> &worker() noexcept { return _worker; }
+
+        class iterator
+        {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = T *;
+            using reference = T &;
+
+            iterator() = default;
+            explicit iterator(StreamingTimedWorker *owner) : _owner(owner) { ++*this; }
+
+            reference operator*() { return *_cur; }
+            pointer operator->() { return &*_cur; }
+
+            iterator &operator++()
+            {
+                _cur = _owner->next();
+                if (!_cur)
+                    _owner = nullptr;
+                return *this;
+            }
+            void operator++(int) { ++*this; }
+
+            friend bool operator==(iterator const &a, iterator const &b) noexcept { return a._owner == b._owner; }
+
+        private:
+            StreamingTimedWorker *_owner{nullptr};
+            std::optional<T> _cur;
+        };
+
+        // Blocks per item; ends when the producer has finished and the ring
+        // is empty, or when next() gives up on an overrunning producer.
+        iterator begin() { return iterator(this); }
+        iterator end() noexcept { return iterator(); }
+
+    private:
+        std::shared_ptr<detail::spsc_ring<T>> _ring;
+        Clock::time_point _readBy;
+        // declared last: stopped and joined before the ring handle goes
+        TimedWorker<LogStream> _worker;
+    };
+
+    // The callable receives (std::stop_token, tw::stream_producer<T>&, args...).
+    // Stop is requested once `timeout` has passed, and the destructor gives
+    // the producer the same amount of time to return.
+    template <class T, class LogS = std::ostream, class Rep, class Period, class F, class... Args>
+        requires std::invocable<std::decay_t<F> &, std::stop_token, stream_producer<T> &, std::decay_t<Args> &...>
+    auto make_streaming_timed_worker(std::chrono::duration<Rep, Period> timeout, std::size_t capacity,
+                                     F &&f, LogS &ls = std::cerr, Args &&...args)
+    {
+        auto ring = std::make_shared<detail::spsc_ring<T>>(capacity);
+        auto to = detail::to_worker_duration(timeout);
+        auto deadline = detail::add_sat(detail::clock_now(), to);
+
+        auto bound = [func = std::forward<F>(f), tup = std::make_tuple(std::forward<Args>(args)...)](
+                         std::stop_token st, stream_producer<T> &out) mutable
+        {
+            std::apply([&](auto &...cur)
+                       { func(st, out, cur...); }, tup);
+        };
+        detail::stream_runner<T, decltype(bound)> runner(ring, deadline, std::move(bound));
+        return StreamingTimedWorker<T, LogS>(ring, make_timed_worker(deadline, to, std::move(runner), ls));
+    }
+
+} // namespace tw
+
+#endif // TW_STREAMING_WORKER_HPP
@@ -0,0 +1,344 @@
+#ifndef TW_TASK_GRAPH_HPP
+#define TW_TASK_GRAPH_HPP
+#pragma once
+
+#include <tw/detail/completion_flag.hpp>
+#include <tw/timed_result.hpp>
+#include <tw/timed_worker.hpp>
+#include <tw/worker_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <stop_token>
+#include <utility>
+#include <vector>
+
+namespace tw
+{
+    using node_id = std::size_t;
+
+    // Outcome of one task_graph::run. Nodes skipped because an upstream
+    // node did not complete report `stopped`.
+    class graph_result
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        std::size_t size() const noexcept { return _results.size(); }
+        timed_result<void> const &operator[](node_id n) const { return _results.at(n); }
+
+        // Finish-by time the node was given.
+        Clock::time_point deadline(node_id n) const { return _deadlines.at(n); }
+
+        bool ok() const noexcept
+        {
+            return std::all_of(_results.begin(), _results.end(), [](auto const &r)
+                               { return r.ok(); });
+        }
+
+        std::size_t count(timed_status s) const noexcept
+        {
+            return static_cast<std::size_t>(std::count_if(_results.begin(), _results.end(), [s](auto const &r)
+                                                          { return r.status() == s; }));
+        }
+
+    private:
+        template <class>
+        friend class task_graph;
+
+        std::vector<timed_result<void>> _results;
+        std::vector<Clock::time_point> _deadlines;
+    };
+
+    namespace detail
+    {
+        struct graph_node
+        {
+            std::function<void(std::stop_token)> fn;
+            double weight;
+            std::vector<node_id> after;
+            std::vector<node_id> next;
+        };
+
+        // State of one run, shared with the pool tasks executing it.
+        struct graph_run
+        {
+            explicit graph_run(std::shared_ptr<const std::vector<graph_node>> n)
+                : nodes(std::move(n)), deadlines(nodes->size()),
+                  pending(std::make_unique<std::atomic<std::size_t>[]>(nodes->size())),
+                  cancelled(std::make_unique<std::atomic_bool[]>(nodes->size())),
+                  settled(std::make_unique<std::atomic_bool[]>(nodes->size())),
+                  results(nodes->size()), remaining(nodes->size())
+            {
+                for (std::size_t i = 0; i < nodes->size(); ++i)
+                    pending[i].store((*nodes)[i].after.size(), std::memory_order_relaxed);
+            }
+
+            std::shared_ptr<const std::vector<graph_node>> nodes;
+            std::vector<worker_clock::time_point> deadlines;
+            std::unique_ptr<std::atomic<std::size_t>[]> pending;
+            std::unique_ptr<std::atomic_bool[]> cancelled;
+            std::unique_ptr<std::atomic_bool[]> settled;
+            std::vector<timed_result<void>> results;
+            std::atomic<std::size_t> remaining;
+            std::stop_source src;
+            completion_flag done;
+        };
+    } // namespace detail
+
+    // Dependency graph of timed callables executed on a worker_pool.
+    // Independent branches run in parallel. A node that fails or times out
+    // cancels everything downstream of it.
+    //
+    // Each node's share of the overall deadline follows its position on
+    // the critical path. With `weight` as the expected relative cost, a
+    // node must finish by
+    //
+    //   start + budget * (heaviest path ending at it) / (heaviest path through it)
+    //
+    // so the nodes along the critical path split the budget in proportion
+    // to their cost, and nodes off it get the slack. A node that starts
+    // early keeps the time it gained.
+    //
+    // Building the graph is not thread-safe; run() may be called
+    // concurrently. The pool must outlive every run.
+    template <class LogStream = std::ostream>
+    class task_graph
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // `grace` is how long run() waits past the deadline for stopped
+        // nodes to return.
+        explicit task_graph(worker_pool<LogStream> &pool,
+                            std::chrono::nanoseconds grace = std::chrono::milliseconds(10))
+            : _pool(&pool), _grace(grace), _nodes(std::make_shared<std::vector<detail::graph_node>>())
+        {
+        }
+
+        template <class F>
+            requires std::invocable<F &, std::stop_token>
+        node_id add(F f, double weight = 1.0)
+        {
+            auto &nodes = mutable_nodes();
+            nodes.push_back(detail::graph_node{std::move(f), std::max(weight, 0.0), {}, {}});
+            return nodes.size() - 1;
+        }
+
+        // `node` starts only after `on` has completed.
+        void depends(node_id node, node_id on)
+        {
+            if (node >= size() || on >= size())
+                throw std::invalid_argument("tw::task_graph: unknown node");
+            if (node == on || reaches(node, on))
+                throw std::invalid_argument("tw::task_graph: dependency would form a cycle");
+            auto &nodes = mutable_nodes();
+            nodes[node].after.push_back(on);
+            nodes[on].next.push_back(node);
+        }
+
+        std::size_t size() const noexcept { return _nodes->size(); }
+
+        // Blocks until every node has settled, or until `deadline` plus the
+        // grace period; nodes still running then report timed_out.
+        template <class C, class D>
+        graph_result run(std::chrono::time_point<C, D> deadline)
+        {
+            auto dl = detail::to_worker_time(deadline);
+            auto r = std::make_shared<detail::graph_run>(_nodes);
+            allocate(*r, Clock::now(), dl);
+
+            for (node_id n = 0; n < r->nodes->size(); ++n)
+            {
+                if (!(*r->nodes)[n].after.empty())
+                    continue;
+                if (!_pool->submit_until(job(r, n), r->deadlines[n]))
+                {
+                    // queue still full at the node's deadline: it settles as
+                    // timed_out; pool shutting down: everything as stopped
+                    if (Clock::now() < r->deadlines[n])
+                        r->src.request_stop();
+                    drive(r, _pool, n, {});
+                }
+            }
+
+            if (r->nodes->empty() || !r->done.wait_until(detail::add_sat(dl, _grace)))
+                r->src.request_stop();
+
+            graph_result out;
+            out._deadlines = r->deadlines;
+            out._results.reserve(r->nodes->size());
+            for (node_id n = 0; n < r->nodes->size(); ++n)
+                out._results.push_back(r->settled[n].load(std::memory_order_acquire)
+                                           ? r->results[n]
+                                           : timed_result<void>(timed_status::timed_out));
+            return out;
+        }
+
+        template <class Rep, class Period>
+        graph_result run(std::chrono::duration<Rep, Period> budget)
+        {
+            return run(detail::add_sat(Clock::now(), detail::to_worker_duration(budget)));
+        }
+
+    private:
+        using run_ptr = std::shared_ptr<detail::graph_run>;
+
+        std::vector<detail::graph_node> &mutable_nodes()
+        {
+            // copy-on-write: runs in flight keep their snapshot
+            if (_nodes.use_count() > 1)
+                _nodes = std::make_shared<std::vector<detail::graph_node>>(*_nodes);
+            return *_nodes;
+        }
+
+        // true if `to` transitively depends on `from`
+        bool reaches(node_id from, node_id to) const
+        {
+            std::vector<node_id> stack{to};
+            std::vector<bool> seen(size());
+            while (!stack.empty())
+            {
+                auto n = stack.back();
+                stack.pop_back();
+                if (n == from)
+                    return true;
+                if (seen[n])
+                    continue;
+                seen[n] = true;
+                for (auto p : (*_nodes)[n].after)
+                    stack.push_back(p);
+            }
+            return false;
+        }
+
+        static void allocate(detail::graph_run &r, Clock::time_point start, Clock::time_point dl)
+        {
+            auto const &nodes = *r.nodes;
+            auto n = nodes.size();
+
+            std::vector<node_id> order;
+            order.reserve(n);
+            std::vector<std::size_t> indeg(n);
+            for (node_id i = 0; i < n; ++i)
+                if ((indeg[i] = nodes[i].after.size()) == 0)
+                    order.push_back(i);
+            for (std::size_t i = 0; i < order.size(); ++i)
+                for (auto s : nodes[order[i]].next)
+                    if (--indeg[s] == 0)
+                        order.push_back(s);
+
+            std::vector<double> upto(n), after(n);
+            for (auto i : order)
+            {
+                double longest = 0;
+                for (auto p : nodes[i].after)
+                    longest = std::max(longest, upto[p]);
+                upto[i] = longest + nodes[i].weight;
+            }
+            for (auto it = order.rbegin(); it != order.rend(); ++it)
+                for (auto s : nodes[*it].next)
+                    after[*it] = std::max(after[*it], nodes[s].weight + after[s]);
+
+            auto span = std::chrono::duration<double>(dl > start ? dl - start : Clock::duration::zero());
+            for (node_id i = 0; i < n; ++i)
+            {
+                double through = upto[i] + after[i];
+                double share = through > 0 ? upto[i] / through : 1.0;
+                r.deadlines[i] = dl == Clock::time_point::max() || share >= 1.0
+                                     ? dl
+                                     : std::min(dl, start + std::chrono::duration_cast<Clock::duration>(span * share));
+            }
+        }
+
+        auto job(run_ptr const &r, node_id n)
+        {
+            return [r, pool = _pool, n](std::stop_token st)
+            { drive(r, pool, n, st); };
+        }
+
+        static timed_result<void> execute(detail::graph_run &r, node_id n, std::stop_token const &pst)
+        {
+            if (r.cancelled[n].load(std::memory_order_relaxed) || r.src.stop_requested() || pst.stop_requested())
+                return timed_result<void>(timed_status::stopped);
+            auto dl = r.deadlines[n];
+            if (Clock::now() >= dl)
+                return timed_result<void>(timed_status::timed_out);
+
+            std::stop_source src;
+            std::stop_callback byGraph(r.src.get_token(), detail::forward_stop{&src});
+            std::stop_callback byPool(pst, detail::forward_stop{&src});
+            detail::scoped_deadline limit(src, dl);
+            try
+            {
+                detail::stop_scope scope(src.get_token());
+                (*r.nodes)[n].fn(src.get_token());
+            }
+            catch (...)
+            {
+                return timed_result<void>(std::current_exception());
+            }
+            // judged at return: the timer may still fire before finish()
+            // disarms it, after fn has already completed
+            auto returned = Clock::now();
+            bool stopped = src.stop_requested();
+            limit.finish();
+            if (returned >= dl)
+                return timed_result<void>(timed_status::timed_out);
+            if (stopped)
+                return timed_result<void>(timed_status::stopped);
+            return timed_result<void>(timed_status::completed);
+        }
+
+        static void settle(detail::graph_run &r, node_id n, timed_result<void> res, std::vector<node_id> &ready)
+        {
+            bool ok = res.ok();
+            r.results[n] = std::move(res);
+            r.settled[n].store(true, std::memory_order_release);
+            for (auto s : (*r.nodes)[n].next)
+            {
+                if (!ok)
+                    r.cancelled[s].store(true, std::memory_order_relaxed);
+                if (r.pending[s].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    ready.push_back(s);
+            }
+            if (r.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                r.done.set();
+        }
+
+        // Runs `first` and follows the graph: one ready successor continues
+        // on this thread, the others are offered to idle workers.
+        static void drive(run_ptr r, worker_pool<LogStream> *pool, node_id first, std::stop_token st)
+        {
+            std::vector<node_id> todo{first};
+            std::vector<node_id> ready;
+            while (!todo.empty())
+            {
+                auto n = todo.back();
+                todo.pop_back();
+                settle(*r, n, execute(*r, n, st), ready);
+                for (std::size_t i = 1; i < ready.size(); ++i)
+                    if (!pool->try_submit([r, pool, s = ready[i]](std::stop_token pst)
+                                          { drive(r, pool, s, pst); }))
+                        todo.push_back(ready[i]);
+                if (!ready.empty())
+                    todo.push_back(ready.front());
+                ready.clear();
+            }
+        }
+
+        worker_pool<LogStream> *_pool;
+        std::chrono::nanoseconds _grace;
+        std::shared_ptr<std::vector<detail::graph_node>> _nodes;
+    };
+
+} // namespace tw
+
+#endif // TW_TASK_GRAPH_HPP
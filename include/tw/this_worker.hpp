@@ -0,0 +1,102 @@
+#ifndef TW_THIS_WORKER_HPP
+#define TW_THIS_WORKER_HPP
+#pragma once
+
+#include <tw/timed_worker.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+namespace tw
+{
+    namespace detail
+    {
+        // Limits of the slice the calling thread is running, if any.
+        struct worker_slice
+        {
+            worker_clock::time_point end = worker_clock::time_point::max();
+            std::stop_token stop;
+        };
+
+        inline thread_local worker_slice const *current_slice = nullptr;
+
+        class slice_scope
+        {
+        public:
+            slice_scope(worker_clock::time_point end, std::stop_token st) noexcept
+                : _slice{end, std::move(st)}, _prev(std::exchange(current_slice, &_slice))
+            {
+            }
+
+            slice_scope(const slice_scope &) = delete;
+            slice_scope &operator=(const slice_scope &) = delete;
+
+            ~slice_scope() { current_slice = _prev; }
+
+        private:
+            worker_slice _slice;
+            worker_slice const *_prev;
+        };
+    } // namespace detail
+
+    namespace this_worker
+    {
+        // Cancellation point for time-sliced callables: true once the
+        // current slice is used up or stop was requested. The callable then
+        // keeps its place and returns tw::slice::yield. Always false outside
+        // a slice.
+        inline bool yield_point() noexcept
+        {
+            auto const *s = detail::current_slice;
+            return s && (s->stop.stop_requested() || detail::worker_clock::now() >= s->end);
+        }
+
+        // Sleeps until `tp`, but returns early once the calling worker, or
+        // the work item it is running (a time-sliced task, pool-run graph
+        // node or map_reduce chunk, pipeline item, periodic run), is asked to
+        // stop. Returns true if it slept the whole time. Outside a worker it
+        // is std::this_thread::sleep_until. In a clock_scope it sleeps on the
+        // virtual clock.
+        template <class C, class D>
+        bool sleep_until(std::chrono::time_point<C, D> const &tp)
+        {
+            std::stop_token st;
+            if (auto const *s = detail::current_slice)
+                st = s->stop;
+            else if (detail::current_stop)
+                st = *detail::current_stop;
+            if (auto *vc = detail::current_clock)
+            {
+                if (st.stop_possible())
+                    return vc->sleep_until(detail::to_worker_time(tp), st);
+                vc->sleep_until(detail::to_worker_time(tp));
+                return true;
+            }
+            if (!st.stop_possible())
+            {
+                std::this_thread::sleep_until(tp);
+                return true;
+            }
+
+            std::mutex mtx;
+            std::condition_variable_any cv;
+            std::unique_lock lk(mtx);
+            cv.wait_until(lk, st, tp, []
+                          { return false; });
+            return !st.stop_requested();
+        }
+
+        template <class Rep, class Period>
+        bool sleep_for(std::chrono::duration<Rep, Period> const &d)
+        {
+            return sleep_until(detail::add_sat(detail::clock_now(), detail::to_worker_duration(d)));
+        }
+    } // namespace this_worker
+
+} // namespace tw
+
+#endif // TW_THIS_WORKER_HPP
@@ -0,0 +1,403 @@
+#ifndef TW_TIMED_CACHE_HPP
+#define TW_TIMED_CACHE_HPP
+#pragma once
+
+#include <tw/detail/completion_flag.hpp>
+#include <tw/timed_result.hpp>
+#include <tw/timed_worker.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tw
+{
+    struct cache_options
+    {
+        std::size_t capacity{1024};
+        // how long a computed value is fresh
+        std::chrono::nanoseconds ttl{std::chrono::seconds(1)};
+        // after expiring, a value is still served immediately for this long
+        // while a background refresh runs
+        std::chrono::nanoseconds stale_for{std::chrono::seconds(1)};
+        // time a computation gets to return once the cache is destroyed
+        std::chrono::nanoseconds shutdown_grace{std::chrono::milliseconds(10)};
+    };
+
+    struct cache_stats
+    {
+        std::uint64_t hits{0};
+        std::uint64_t stale_hits{0};
+        std::uint64_t misses{0};
+        std::uint64_t refreshes{0};
+        std::uint64_t failed_refreshes{0};
+        std::uint64_t evictions{0};
+    };
+
+    namespace detail
+    {
+        template <class T>
+        struct cache_job
+        {
+            std::chrono::steady_clock::time_point deadline{};
+            std::optional<T> value;
+            std::exception_ptr error;
+            timed_status status{timed_status::stopped};
+            completion_flag done;
+        };
+
+        // Runs a cache computation; completes the job even if the worker
+        // never got to call it (stop came before the thread started). A
+        // runner unwound from a failed launch leaves that to the launcher.
+        template <class T, class F>
+        struct cache_runner
+        {
+            using Clock = std::chrono::steady_clock;
+
+            cache_runner(std::shared_ptr<cache_job<T>> j, F f) : job(std::move(j)), fn(std::move(f)) {}
+            cache_runner(cache_runner &&) = default;
+            cache_runner &operator=(cache_runner &&) = delete;
+
+            ~cache_runner()
+            {
+                if (job && !job->done.is_set() && std::uncaught_exceptions() == 0)
+                {
+                    job->status = Clock::now() >= job->deadline ? timed_status::timed_out : timed_status::stopped;
+                    job->done.set();
+                }
+            }
+
+            void operator()(std::stop_token st)
+            {
+                try
+                {
+                    job->value.emplace(fn(st));
+                    if (!st.stop_requested())
+                        job->status = timed_status::completed;
+                    else
+                        job->status = Clock::now() >= job->deadline ? timed_status::timed_out : timed_status::stopped;
+                }
+                catch (...)
+                {
+                    job->error = std::current_exception();
+                    job->status = timed_status::failed;
+                }
+                job->done.set();
+            }
+
+            std::shared_ptr<cache_job<T>> job;
+            F fn;
+        };
+    } // namespace detail
+
+    // Memoizes timed computations. Entries live in one contiguous slot array
+    // of fixed capacity and are evicted with the CLOCK (second chance)
+    // policy; lookups go through a hash index. Computations run on
+    // TimedWorkers and only ever write to their own job record, which the
+    // cache folds in on a later call, so a computation that overruns can
+    // never touch the cache itself.
+    //
+    // A fresh entry is a plain lookup. An expired entry is served as-is for
+    // stale_for while a background refresh runs; if that refresh times out
+    // or fails, the old value stays. Past stale_for (or on a miss) the caller
+    // waits up to the budget; on timeout it gets timed_out together with the
+    // old value, if there was one. A computation still running shutdown_grace
+    // past its budget is abandoned (its worker detached), so that a new one
+    // can start for the key.
+    template <class Key, class T, class LogStream = std::ostream, class Hash = std::hash<Key>>
+    class timed_cache
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit timed_cache(cache_options const &opts, LogStream &log = std::cerr)
+            : _opts(opts), _log(log), _slots(std::max<std::size_t>(opts.capacity, 1))
+        {
+            _index.reserve(_slots.size());
+        }
+
+        timed_cache(const timed_cache &) = delete;
+        timed_cache &operator=(const timed_cache &) = delete;
+
+        template <class Rep, class Period, class F>
+            requires std::invocable<std::decay_t<F> &, std::stop_token> &&
+                     std::convertible_to<std::invoke_result_t<std::decay_t<F> &, std::stop_token>, T>
+        timed_result<T> get(Key const &key, std::chrono::duration<Rep, Period> budget, F &&compute)
+        {
+            std::shared_ptr<detail::cache_job<T>> job;
+            bool starter = false;
+            bool stale = false;
+            std::optional<T> old;
+            std::vector<std::unique_ptr<TimedWorker<LogStream>>> reap;
+            {
+                std::lock_guard lk(_mtx);
+                harvest(reap);
+                auto now = Clock::now();
+
+                if (auto it = _index.find(key); it != _index.end())
+                {
+                    auto &s = _slots[it->second];
+                    s.referenced = true;
+                    if (now < s.expires)
+                    {
+                        ++_stats.hits;
+                        return timed_result<T>(timed_status::completed, *s.value);
+                    }
+                    old = s.value;
+                    stale = now - s.expires < _opts.stale_for;
+                }
+
+                auto j = _jobs.find(key);
+                if (stale)
+                {
+                    ++_stats.stale_hits;
+                    if (j == _jobs.end())
+                        ++_stats.refreshes;
+                }
+                else
+                {
+                    ++_stats.misses;
+                }
+                if (j == _jobs.end())
+                {
+                    auto fresh = std::make_shared<detail::cache_job<T>>();
+                    fresh->deadline = detail::add_sat(now, detail::to_worker_duration(budget));
+                    j = _jobs.emplace(key, job_entry(std::move(fresh))).first;
+                    starter = true;
+                }
+                job = j->second.state;
+            }
+            reap.clear();
+
+            // the worker is built outside the lock: admission against the
+            // detach budget may block, or run the computation right here
+            if (starter)
+            {
+                try
+                {
+                    start(key, job, std::forward<F>(compute));
+                }
+                catch (...)
+                {
+                    // e.g. the detach budget rejected the refresh: a stale
+                    // hit still serves the old value
+                    if (!stale)
+                        throw;
+                    std::lock_guard lk(_mtx);
+                    harvest(reap);
+                }
+            }
+            if (stale)
+                return timed_result<T>(timed_status::completed, std::move(*old));
+
+            if (!job->done.wait_until(detail::add_sat(Clock::now(), detail::to_worker_duration(budget))))
+                return old ? timed_result<T>(timed_status::timed_out, std::move(*old))
+                           : timed_result<T>(timed_status::timed_out);
+
+            {
+                std::lock_guard lk(_mtx);
+                harvest(reap);
+            }
+            if (job->status == timed_status::completed)
+                return timed_result<T>(timed_status::completed, *job->value);
+            if (old)
+                return timed_result<T>(job->status, std::move(*old));
+            if (job->error)
+                return timed_result<T>(job->error);
+            return timed_result<T>(job->status);
+        }
+
+        // Cached value regardless of age, without computing anything.
+        std::optional<T> peek(Key const &key) const
+        {
+            std::lock_guard lk(_mtx);
+            auto it = _index.find(key);
+            if (it == _index.end())
+                return std::nullopt;
+            return _slots[it->second].value;
+        }
+
+        // Drops the key's value and stops its computation in flight, whose
+        // result would predate the invalidation; callers waiting on that
+        // computation see it stopped. Waits for the computation to return
+        // (up to shutdown_grace) after releasing the lock.
+        void invalidate(Key const &key)
+        {
+            std::unique_ptr<TimedWorker<LogStream>> reap;
+            std::lock_guard lk(_mtx);
+            if (auto it = _index.find(key); it != _index.end())
+            {
+                _slots[it->second] = slot{};
+                _index.erase(it);
+            }
+            if (auto j = _jobs.find(key); j != _jobs.end())
+            {
+                reap = std::move(j->second.worker);
+                _jobs.erase(j);
+            }
+        }
+
+        std::size_t size() const
+        {
+            std::lock_guard lk(_mtx);
+            return _index.size();
+        }
+
+        std::size_t capacity() const noexcept { return _slots.size(); }
+
+        cache_stats stats() const
+        {
+            std::lock_guard lk(_mtx);
+            return _stats;
+        }
+
+    private:
+        struct slot
+        {
+            std::optional<Key> key;
+            std::optional<T> value;
+            Clock::time_point expires{};
+            bool referenced{false};
+        };
+
+        struct job_entry
+        {
+            explicit job_entry(std::shared_ptr<detail::cache_job<T>> s) noexcept : state(std::move(s)) {}
+
+            std::shared_ptr<detail::cache_job<T>> state;
+            std::unique_ptr<TimedWorker<LogStream>> worker;
+        };
+
+        using job_map = std::unordered_map<Key, job_entry, Hash>;
+
+        // Runs a job's computation in a new worker, then hands the worker to
+        // its entry. Called without _mtx held.
+        template <class F>
+        void start(Key const &key, std::shared_ptr<detail::cache_job<T>> const &job, F &&f)
+        {
+            std::unique_ptr<TimedWorker<LogStream>> w;
+            try
+            {
+                w = std::make_unique<TimedWorker<LogStream>>(
+                    make_timed_worker(job->deadline, _opts.shutdown_grace,
+                                      detail::cache_runner<T, std::decay_t<F>>(job, std::forward<F>(f)), _log));
+            }
+            catch (...)
+            {
+                // callers waiting on the job see the failure; the next
+                // harvest drops it
+                job->error = std::current_exception();
+                job->status = timed_status::failed;
+                job->done.set();
+                throw;
+            }
+
+            std::lock_guard lk(_mtx);
+            auto it = _jobs.find(key);
+            // the entry can only have gone if the job has finished or been
+            // abandoned; w then joins or detaches after the lock is released
+            if (it != _jobs.end() && it->second.state == job)
+                it->second.worker = std::move(w);
+        }
+
+        // Folds finished computations into the cache and gives up on those
+        // that outlived their budget and grace. Called with _mtx held; the
+        // workers are handed out to be joined (or detached) after unlocking.
+        void harvest(std::vector<std::unique_ptr<TimedWorker<LogStream>>> &out)
+        {
+            auto now = Clock::now();
+            for (auto it = _jobs.begin(); it != _jobs.end();)
+            {
+                auto &job = *it->second.state;
+                if (!job.done.is_set())
+                {
+                    if (now < detail::add_sat(job.deadline, detail::to_worker_duration(_opts.shutdown_grace)))
+                    {
+                        ++it;
+                        continue;
+                    }
+                    try
+                    {
+                        _log << "[timed_cache] abandoning hung computation\n";
+                    }
+                    catch (...)
+                    {
+                    }
+                    ++_stats.failed_refreshes;
+                }
+                else if (job.status == timed_status::completed)
+                    store(it->first, *job.value);
+                else
+                    ++_stats.failed_refreshes;
+                out.push_back(std::move(it->second.worker));
+                it = _jobs.erase(it);
+            }
+        }
+
+        void store(Key const &key, T value)
+        {
+            std::size_t i;
+            if (auto it = _index.find(key); it != _index.end())
+            {
+                i = it->second;
+            }
+            else
+            {
+                i = victim();
+                _index.emplace(key, i);
+                _slots[i].key = key;
+            }
+            _slots[i].value = std::move(value);
+            _slots[i].expires = detail::add_sat(Clock::now(), detail::to_worker_duration(_opts.ttl));
+            _slots[i].referenced = true;
+        }
+
+        // CLOCK: sweep the hand, giving referenced slots a second chance.
+        std::size_t victim()
+        {
+            for (;;)
+            {
+                auto &s = _slots[_hand];
+                std::size_t i = _hand;
+                _hand = (_hand + 1) % _slots.size();
+                if (!s.key)
+                    return i;
+                if (s.referenced)
+                {
+                    s.referenced = false;
+                    continue;
+                }
+                _index.erase(*s.key);
+                s = slot{};
+                ++_stats.evictions;
+                return i;
+            }
+        }
+
+        cache_options _opts;
+        LogStream &_log;
+        mutable std::mutex _mtx;
+        std::vector<slot> _slots;
+        std::unordered_map<Key, std::size_t, Hash> _index;
+        std::size_t _hand{0};
+        cache_stats _stats;
+        // declared last: running computations are stopped before the rest goes
+        job_map _jobs;
+    };
+
+} // namespace tw
+
+#endif // TW_TIMED_CACHE_HPP
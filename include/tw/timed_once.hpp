@@ -0,0 +1,271 @@
+#ifndef TW_TIMED_ONCE_HPP
+#define TW_TIMED_ONCE_HPP
+#pragma once
+
+#include <tw/detail/completion_flag.hpp>
+#include <tw/timed_result.hpp>
+#include <tw/timed_worker.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tw
+{
+    struct once_options
+    {
+        // attempts before a failure becomes final; 1 means never retry
+        unsigned max_attempts{1};
+        // an attempt still running this long after its budget is abandoned
+        // (its worker detached) so that a retry can start
+        std::chrono::nanoseconds shutdown_grace{std::chrono::milliseconds(10)};
+    };
+
+    namespace detail
+    {
+        template <class T>
+        struct once_attempt
+        {
+            std::chrono::steady_clock::time_point deadline{};
+            std::optional<T> value;
+            std::exception_ptr error;
+            timed_status status{timed_status::stopped};
+            // where the first attempt to produce a value publishes it; shared
+            // so that a detached runner never writes into a destroyed
+            // timed_once
+            std::shared_ptr<std::atomic<once_attempt *>> ready;
+            completion_flag done;
+        };
+
+        // Completes the attempt even if the worker never got to call it.
+        template <class T, class F>
+        struct once_runner
+        {
+            once_runner(std::shared_ptr<once_attempt<T>> a, F f) : attempt(std::move(a)), init(std::move(f)) {}
+            once_runner(once_runner &&) = default;
+            once_runner &operator=(once_runner &&) = delete;
+
+            ~once_runner()
+            {
+                if (attempt && !attempt->done.is_set())
+                    attempt->done.set();
+            }
+
+            void operator()(std::stop_token st)
+            {
+                try
+                {
+                    attempt->value.emplace(init(st));
+                    attempt->status = timed_status::completed;
+                    once_attempt<T> *none = nullptr;
+                    attempt->ready->compare_exchange_strong(none, attempt.get(), std::memory_order_acq_rel);
+                }
+                catch (...)
+                {
+                    attempt->error = std::current_exception();
+                    attempt->status = timed_status::failed;
+                }
+                attempt->done.set();
+            }
+
+            std::shared_ptr<once_attempt<T>> attempt;
+            F init;
+        };
+    } // namespace detail
+
+    // call_once with a time limit. The first caller starts the initializer
+    // on a TimedWorker; every caller (including the first) then waits on a
+    // futex only up to its own deadline. Once a value exists, get() is a
+    // single atomic load; the runner publishes it as soon as it is made,
+    // so ready() and try_get() see it without a further call.
+    //
+    // A late value is still kept: a caller that timed out may find the
+    // value ready on its next call. A failed or hung attempt is retried by
+    // the next caller while once_options::max_attempts allows it.
+    template <class T, class LogStream = std::ostream>
+    class timed_once
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit timed_once(once_options const &opts = {}, LogStream &log = std::cerr) : _opts(opts), _log(log) {}
+
+        timed_once(const timed_once &) = delete;
+        timed_once &operator=(const timed_once &) = delete;
+
+        // The initialized value, or nullptr.
+        T *try_get() noexcept
+        {
+            auto *a = _ready->load(std::memory_order_acquire);
+            return a ? &*a->value : nullptr;
+        }
+
+        bool ready() const noexcept { return _ready->load(std::memory_order_acquire) != nullptr; }
+
+        // Begins initialization (if nobody has) without waiting for it, so
+        // independent components can be initialized concurrently.
+        template <class Rep, class Period, class F>
+            requires std::invocable<std::decay_t<F> &, std::stop_token> &&
+                     std::convertible_to<std::invoke_result_t<std::decay_t<F> &, std::stop_token>, T>
+        void start(std::chrono::duration<Rep, Period> budget, F &&init)
+        {
+            if (!ready())
+                attempt_for(budget, std::forward<F>(init));
+        }
+
+        // `budget` bounds the initializer (used by whoever starts an
+        // attempt); `wait_deadline` bounds this caller's wait.
+        template <class Rep, class Period, class C, class D, class F>
+            requires std::invocable<std::decay_t<F> &, std::stop_token> &&
+                     std::convertible_to<std::invoke_result_t<std::decay_t<F> &, std::stop_token>, T>
+        timed_result<std::reference_wrapper<T>> get(std::chrono::duration<Rep, Period> budget,
+                                                     std::chrono::time_point<C, D> wait_deadline, F &&init)
+        {
+            if (auto *v = try_get())
+                return {timed_status::completed, std::ref(*v)};
+
+            auto a = attempt_for(budget, std::forward<F>(init));
+            if (!a)
+                return final_result();
+            if (!a->done.wait_until(detail::to_worker_time(wait_deadline)))
+                return timed_result<std::reference_wrapper<T>>(timed_status::timed_out);
+
+            std::vector<std::unique_ptr<TimedWorker<LogStream>>> reap;
+            {
+                std::lock_guard lk(_mtx);
+                settle(reap);
+            }
+            if (auto *v = try_get())
+                return {timed_status::completed, std::ref(*v)};
+            if (a->error)
+                return timed_result<std::reference_wrapper<T>>(a->error);
+            return timed_result<std::reference_wrapper<T>>(timed_status::timed_out);
+        }
+
+        template <class Rep1, class Period1, class Rep2, class Period2, class F>
+            requires std::invocable<std::decay_t<F> &, std::stop_token> &&
+                     std::convertible_to<std::invoke_result_t<std::decay_t<F> &, std::stop_token>, T>
+        timed_result<std::reference_wrapper<T>> get(std::chrono::duration<Rep1, Period1> budget,
+                                                     std::chrono::duration<Rep2, Period2> wait, F &&init)
+        {
+            return get(budget, detail::add_sat(Clock::now(), detail::to_worker_duration(wait)), std::forward<F>(init));
+        }
+
+        unsigned attempts() const
+        {
+            std::lock_guard lk(_mtx);
+            return _attempts;
+        }
+
+    private:
+        using attempt_ptr = std::shared_ptr<detail::once_attempt<T>>;
+
+        // The attempt to wait on, starting one if needed; null once every
+        // attempt has been used up. The worker is built outside the lock:
+        // admission against the detach budget may block, or run the
+        // initializer right here. If that throws, once_runner still
+        // completes the attempt.
+        template <class Rep, class Period, class F>
+        attempt_ptr attempt_for(std::chrono::duration<Rep, Period> budget, F &&init)
+        {
+            std::vector<std::unique_ptr<TimedWorker<LogStream>>> reap;
+            attempt_ptr a;
+            {
+                std::lock_guard lk(_mtx);
+                settle(reap);
+                if (ready() || (_current && !_current->done.is_set()))
+                    return _current;
+                if (_attempts >= std::max(_opts.max_attempts, 1u))
+                    return nullptr;
+
+                ++_attempts;
+                a = std::make_shared<detail::once_attempt<T>>();
+                a->deadline = detail::add_sat(Clock::now(), detail::to_worker_duration(budget));
+                a->ready = _ready;
+                _current = a;
+                _tried.push_back(a);
+                if (_worker)
+                    reap.push_back(std::move(_worker));
+            }
+
+            auto w = std::make_unique<TimedWorker<LogStream>>(
+                make_timed_worker(a->deadline, _opts.shutdown_grace,
+                                  detail::once_runner<T, std::decay_t<F>>(a, std::forward<F>(init)), _log));
+            std::lock_guard lk(_mtx);
+            // a later attempt may have replaced this one; w then goes after
+            // the lock is released
+            if (_current == a && !_worker)
+                _worker = std::move(w);
+            return a;
+        }
+
+        // Records a failed attempt, or gives up on one that outlived its
+        // budget and grace. A completed one has already published itself.
+        // Called with _mtx held.
+        void settle(std::vector<std::unique_ptr<TimedWorker<LogStream>>> &reap)
+        {
+            if (!_current)
+                return;
+            if (_current->done.is_set())
+            {
+                if (_current->status != timed_status::completed)
+                    _failed = _current;
+                if (_worker)
+                    reap.push_back(std::move(_worker));
+                return;
+            }
+            if (ready())
+                return;
+            if (_attempts < std::max(_opts.max_attempts, 1u) &&
+                Clock::now() >= detail::add_sat(_current->deadline, _opts.shutdown_grace))
+            {
+                try
+                {
+                    _log << "[timed_once] abandoning hung initializer\n";
+                }
+                catch (...)
+                {
+                }
+                _failed = _current;
+                _current.reset();
+                reap.push_back(std::move(_worker));
+            }
+        }
+
+        timed_result<std::reference_wrapper<T>> final_result() const
+        {
+            std::lock_guard lk(_mtx);
+            if (_failed && _failed->error)
+                return timed_result<std::reference_wrapper<T>>(_failed->error);
+            return timed_result<std::reference_wrapper<T>>(timed_status::timed_out);
+        }
+
+        once_options _opts;
+        LogStream &_log;
+        mutable std::mutex _mtx;
+        std::shared_ptr<std::atomic<detail::once_attempt<T> *>> _ready{
+            std::make_shared<std::atomic<detail::once_attempt<T> *>>(nullptr)};
+        attempt_ptr _current;
+        attempt_ptr _failed;
+        // every attempt made, so that one finishing after it was abandoned
+        // can still publish a value that outlives its runner
+        std::vector<attempt_ptr> _tried;
+        unsigned _attempts{0};
+        // declared last: an unfinished initializer is stopped first
+        std::unique_ptr<TimedWorker<LogStream>> _worker;
+    };
+
+} // namespace tw
+
+#endif // TW_TIMED_ONCE_HPP
@@ -0,0 +1,128 @@
+#ifndef TW_TIMED_RESULT_HPP
+#define TW_TIMED_RESULT_HPP
+#pragma once
+
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace tw
+{
+    // How a timed operation ended.
+    enum class timed_status : std::uint8_t
+    {
+        completed,
+        timed_out,
+        stopped,
+        failed
+    };
+
+    class timeout_error : public std::runtime_error
+    {
+    public:
+        timeout_error() : std::runtime_error("tw: operation timed out") {}
+    };
+
+    class stopped_error : public std::runtime_error
+    {
+    public:
+        stopped_error() : std::runtime_error("tw: operation stopped") {}
+    };
+
+    namespace detail
+    {
+        [[noreturn]] inline void throw_for(timed_status s, std::exception_ptr const &err)
+        {
+            if (err)
+                std::rethrow_exception(err);
+            if (s == timed_status::timed_out)
+                throw timeout_error{};
+            throw stopped_error{};
+        }
+    } // namespace detail
+
+    // Outcome of a timed operation: a status plus, when the operation got as
+    // far as producing one, its value (or the exception it failed with).
+    // A value may be present together with timed_out/stopped when the callee
+    // returned a fallback after observing the cancellation.
+    template <class T>
+    class timed_result
+    {
+    public:
+        timed_result(timed_status s = timed_status::stopped) noexcept : _status(s) {}
+
+        template <class U = T>
+            requires std::is_constructible_v<T, U &&>
+        timed_result(timed_status s, U &&v) : _status(s), _value(std::in_place, std::forward<U>(v))
+        {
+        }
+
+        timed_result(std::exception_ptr err) noexcept : _status(timed_status::failed), _error(std::move(err)) {}
+
+        timed_status status() const noexcept { return _status; }
+        bool ok() const noexcept { return _status == timed_status::completed; }
+        explicit operator bool() const noexcept { return ok(); }
+
+        bool has_value() const noexcept { return _value.has_value(); }
+        std::exception_ptr error() const noexcept { return _error; }
+
+        T &value() &
+        {
+            if (!_value)
+                detail::throw_for(_status, _error);
+            return *_value;
+        }
+        T const &value() const &
+        {
+            if (!_value)
+                detail::throw_for(_status, _error);
+            return *_value;
+        }
+        T &&value() && { return std::move(value()); }
+
+        template <class U>
+        T value_or(U &&fallback) const &
+        {
+            return _value ? *_value : static_cast<T>(std::forward<U>(fallback));
+        }
+
+        T &operator*() & { return value(); }
+        T const &operator*() const & { return value(); }
+        T *operator->() { return &value(); }
+        T const *operator->() const { return &value(); }
+
+    private:
+        timed_status _status;
+        std::optional<T> _value;
+        std::exception_ptr _error;
+    };
+
+    template <>
+    class timed_result<void>
+    {
+    public:
+        timed_result(timed_status s = timed_status::stopped) noexcept : _status(s) {}
+        timed_result(std::exception_ptr err) noexcept : _status(timed_status::failed), _error(std::move(err)) {}
+
+        timed_status status() const noexcept { return _status; }
+        bool ok() const noexcept { return _status == timed_status::completed; }
+        explicit operator bool() const noexcept { return ok(); }
+        std::exception_ptr error() const noexcept { return _error; }
+
+        void value() const
+        {
+            if (!ok())
+                detail::throw_for(_status, _error);
+        }
+
+    private:
+        timed_status _status;
+        std::exception_ptr _error;
+    };
+
+} // namespace tw
+
+#endif // TW_TIMED_RESULT_HPP
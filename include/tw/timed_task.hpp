@@ -0,0 +1,626 @@
+#ifndef TW_TIMED_TASK_HPP
+#define TW_TIMED_TASK_HPP
+#pragma once
+
+#include <tw/detail/resume_queue.hpp>
+#include <tw/timed_result.hpp>
+#include <tw/timed_worker.hpp>
+#include <tw/timer_service.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <utility>
+
+namespace tw
+{
+    template <class T = void>
+    class timed_task;
+
+    namespace detail
+    {
+        using task_clock = std::chrono::steady_clock;
+
+        // What every co_await inside a timed_task gets to see.
+        struct task_context
+        {
+            std::stop_token stop;
+            task_clock::time_point deadline = task_clock::time_point::max();
+        };
+
+        // Several wake-up sources race for one suspended coroutine. The first
+        // to claim picks the status; the last to release may resume.
+        class resume_latch
+        {
+        public:
+            void arm(int sources) noexcept { _refs.store(sources, std::memory_order_relaxed); }
+
+            bool claim(timed_status s) noexcept
+            {
+                bool expected = false;
+                if (!_claimed.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+                    return false;
+                _status = s;
+                return true;
+            }
+
+            bool release() noexcept { return _refs.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+            timed_status status() const noexcept { return _status; }
+
+        private:
+            std::atomic_int _refs{0};
+            std::atomic_bool _claimed{false};
+            timed_status _status{timed_status::completed};
+        };
+
+        template <class V>
+        struct ready_awaiter
+        {
+            V value;
+            bool await_ready() const noexcept { return true; }
+            void await_suspend(std::coroutine_handle<>) const noexcept {}
+            V await_resume() { return std::move(value); }
+        };
+
+        // Suspends until a time point, the task deadline or a stop request,
+        // whichever comes first. Resumed on the resume_queue.
+        class delay_awaiter : private timer_node, private resume_node
+        {
+        public:
+            delay_awaiter(task_context ctx, task_clock::time_point target) noexcept
+                : timer_node(&on_fire), resume_node(&on_resume), _ctx(std::move(ctx)), _target(target),
+                  _wake(std::min(target, _ctx.deadline))
+            {
+            }
+
+            bool await_ready() noexcept
+            {
+                if (_ctx.stop.stop_requested())
+                {
+                    _status = timed_status::stopped;
+                    return true;
+                }
+                if (task_clock::now() >= _wake)
+                {
+                    _status = _wake < _target ? timed_status::timed_out : timed_status::completed;
+                    return true;
+                }
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> h)
+            {
+                _h = h;
+                _latch.arm(2);
+                _cb.emplace(_ctx.stop, stop_fn{this});
+                timer_service::global().schedule(*this, _wake);
+                if (_ctx.stop.stop_requested())
+                    interrupt();
+                return !_latch.release();
+            }
+
+            timed_result<void> await_resume() noexcept
+            {
+                _cb.reset();
+                return _status;
+            }
+
+        private:
+            struct stop_fn
+            {
+                delay_awaiter *self;
+                void operator()() const noexcept { self->interrupt(); }
+            };
+
+            void interrupt() noexcept
+            {
+                auto &svc = timer_service::global();
+                if (svc.cancel(*this))
+                {
+                    _stopped = true;
+                    svc.schedule(*this, task_clock::time_point::min());
+                }
+            }
+
+            static void on_fire(timer_node &n) noexcept
+            {
+                auto &self = static_cast<delay_awaiter &>(n);
+                if (self._stopped)
+                    self._status = timed_status::stopped;
+                else
+                    self._status = self._wake < self._target ? timed_status::timed_out : timed_status::completed;
+                if (self._latch.release())
+                    resume_queue::global().post(self);
+            }
+
+            static void on_resume(resume_node &n) noexcept { static_cast<delay_awaiter &>(n)._h.resume(); }
+
+            task_context _ctx;
+            task_clock::time_point _target;
+            task_clock::time_point _wake;
+            std::coroutine_handle<> _h;
+            resume_latch _latch;
+            bool _stopped{false};
+            timed_status _status{timed_status::completed};
+            std::optional<std::stop_callback<stop_fn>> _cb;
+        };
+
+        // Suspends until a TimedWorker finishes. The worker's own deadline and
+        // the task deadline both resume the coroutine with timed_out and ask
+        // the worker to stop; its owner still decides join vs detach.
+        // Resumption never happens on the worker thread, so the coroutine may
+        // destroy the worker right after co_await returns.
+        template <class L>
+        class worker_awaiter : private timer_node, private completion_hook, private resume_node
+        {
+        public:
+            worker_awaiter(TimedWorker<L> &w, task_context ctx) noexcept
+                : timer_node(&on_timer), completion_hook(&on_done), resume_node(&on_resume), _w(w),
+                  _ctx(std::move(ctx)),
+                  _wake(std::min(w.deadline(), _ctx.deadline))
+            {
+            }
+
+            bool await_ready() noexcept
+            {
+                if (_w.done())
+                    return true;
+                if (_ctx.stop.stop_requested())
+                    return ready_with(timed_status::stopped);
+                if (task_clock::now() >= _wake)
+                    return ready_with(timed_status::timed_out);
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> h)
+            {
+                _h = h;
+                _latch.arm(3);
+                if (!_w.add_completion_hook(*this))
+                    return false;
+                _cb.emplace(_ctx.stop, stop_fn{this});
+                auto &svc = timer_service::global();
+                svc.schedule(*this, _wake);
+                // a worker that finished before the timer was armed could
+                // not take it back in on_done
+                if (_w.done() && svc.cancel(static_cast<timer_node &>(*this)))
+                    _latch.release();
+                if (_ctx.stop.stop_requested())
+                    interrupt();
+                return !_latch.release();
+            }
+
+            timed_result<void> await_resume() noexcept
+            {
+                _cb.reset();
+                return _latch.status();
+            }
+
+        private:
+            struct stop_fn
+            {
+                worker_awaiter *self;
+                void operator()() const noexcept { self->interrupt(); }
+            };
+
+            bool ready_with(timed_status s) noexcept
+            {
+                _latch.claim(s);
+                _w.request_stop();
+                return true;
+            }
+
+            void interrupt() noexcept
+            {
+                auto &svc = timer_service::global();
+                if (svc.cancel(static_cast<timer_node &>(*this)))
+                {
+                    _stopped = true;
+                    svc.schedule(*this, task_clock::time_point::min());
+                }
+            }
+
+            // worker thread
+            static void on_done(completion_hook &h) noexcept
+            {
+                auto &self = static_cast<worker_awaiter &>(h);
+                auto &svc = timer_service::global();
+                self._latch.claim(timed_status::completed);
+                if (svc.cancel(static_cast<timer_node &>(self)))
+                    self._latch.release();
+                if (self._latch.release())
+                    resume_queue::global().post(self);
+            }
+
+            // timer thread
+            static void on_timer(timer_node &n) noexcept
+            {
+                auto &self = static_cast<worker_awaiter &>(n);
+                if (self._latch.claim(self._stopped ? timed_status::stopped : timed_status::timed_out))
+                    self._w.request_stop();
+                if (self._w.remove_completion_hook(self))
+                    self._latch.release();
+                if (self._latch.release())
+                    resume_queue::global().post(self);
+            }
+
+            static void on_resume(resume_node &n) noexcept { static_cast<worker_awaiter &>(n)._h.resume(); }
+
+            TimedWorker<L> &_w;
+            task_context _ctx;
+            task_clock::time_point _wake;
+            std::coroutine_handle<> _h;
+            resume_latch _latch;
+            bool _stopped{false};
+            std::optional<std::stop_callback<stop_fn>> _cb;
+        };
+
+        // Only root tasks (started with start()/sync_wait) pay for this.
+        struct task_root
+        {
+            std::stop_source source;
+            std::optional<std::stop_callback<forward_stop>> forward;
+            std::mutex mtx;
+            std::condition_variable cv;
+            bool finished{false};
+        };
+
+        class task_promise_base
+        {
+        public:
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            struct final_awaiter
+            {
+                bool await_ready() const noexcept { return false; }
+
+                template <class P>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+                {
+                    auto &p = h.promise();
+                    p.finish();
+                    if (p._continuation)
+                        return p._continuation;
+                    {
+                        // the frame may be destroyed as soon as the lock is released
+                        std::lock_guard lk(p._root->mtx);
+                        p._root->finished = true;
+                        p._root->cv.notify_all();
+                    }
+                    return std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept {}
+            };
+
+            final_awaiter final_suspend() noexcept { return {}; }
+            void unhandled_exception() noexcept { _error = std::current_exception(); }
+
+            // tw awaitables learn about the task's stop token and deadline
+            // through bind(); anything else is awaited unchanged.
+            template <class A>
+            decltype(auto) await_transform(A &&a)
+            {
+                if constexpr (requires { std::forward<A>(a).bind(_ctx); })
+                    return std::forward<A>(a).bind(_ctx);
+                else
+                    return std::forward<A>(a);
+            }
+
+            template <class L>
+            worker_awaiter<L> await_transform(TimedWorker<L> &w) noexcept
+            {
+                return worker_awaiter<L>(w, _ctx);
+            }
+
+            void set_budget(task_clock::duration d) noexcept { _budget = d; }
+
+            void bind(task_context ctx) noexcept
+            {
+                _ctx = std::move(ctx);
+                if (_budget)
+                {
+                    auto now = task_clock::now();
+                    if (_ctx.deadline - now > *_budget)
+                        _ctx.deadline = now + *_budget;
+                }
+            }
+
+            void make_root(task_clock::time_point deadline, std::stop_token external)
+            {
+                _root = std::make_unique<task_root>();
+                if (external.stop_possible())
+                    _root->forward.emplace(std::move(external), forward_stop{&_root->source});
+                bind({_root->source.get_token(), deadline});
+            }
+
+            void set_continuation(std::coroutine_handle<> c) noexcept { _continuation = c; }
+            task_root *root() const noexcept { return _root.get(); }
+
+        protected:
+            void finish() noexcept
+            {
+                if (_error)
+                    _status = timed_status::failed;
+                else if (_ctx.stop.stop_requested())
+                    _status = timed_status::stopped;
+                else if (task_clock::now() > _ctx.deadline)
+                    _status = timed_status::timed_out;
+                else
+                    _status = timed_status::completed;
+            }
+
+            task_context _ctx;
+            std::optional<task_clock::duration> _budget;
+            std::coroutine_handle<> _continuation;
+            std::exception_ptr _error;
+            timed_status _status{timed_status::completed};
+            std::unique_ptr<task_root> _root;
+        };
+
+        template <class T>
+        class task_promise : public task_promise_base
+        {
+        public:
+            timed_task<T> get_return_object() noexcept;
+
+            template <class U = T>
+                requires std::is_convertible_v<U &&, T>
+            void return_value(U &&v)
+            {
+                _value.emplace(std::forward<U>(v));
+            }
+
+            timed_result<T> take_result()
+            {
+                if (_error)
+                    return timed_result<T>(_error);
+                if (_value)
+                    return timed_result<T>(_status, std::move(*_value));
+                return timed_result<T>(_status);
+            }
+
+        private:
+            std::optional<T> _value;
+        };
+
+        template <>
+        class task_promise<void> : public task_promise_base
+        {
+        public:
+            timed_task<void> get_return_object() noexcept;
+            void return_void() noexcept {}
+
+            timed_result<void> take_result()
+            {
+                if (_error)
+                    return timed_result<void>(_error);
+                return timed_result<void>(_status);
+            }
+        };
+
+        template <class T>
+        class task_awaiter
+        {
+        public:
+            using handle = std::coroutine_handle<task_promise<T>>;
+
+            task_awaiter(handle h, task_context ctx) noexcept : _h(h), _ctx(std::move(ctx)) {}
+            task_awaiter(task_awaiter &&o) noexcept : _h(std::exchange(o._h, {})), _ctx(std::move(o._ctx)) {}
+            task_awaiter &operator=(task_awaiter &&) = delete;
+            ~task_awaiter()
+            {
+                if (_h)
+                    _h.destroy();
+            }
+
+            bool await_ready() const noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> parent) noexcept
+            {
+                _h.promise().set_continuation(parent);
+                _h.promise().bind(_ctx);
+                return _h;
+            }
+
+            timed_result<T> await_resume() { return _h.promise().take_result(); }
+
+        private:
+            handle _h;
+            task_context _ctx;
+        };
+
+        struct delay_t
+        {
+            task_clock::time_point target;
+            delay_awaiter bind(const task_context &ctx) const noexcept { return delay_awaiter(ctx, target); }
+        };
+    } // namespace detail
+
+    // Lazily started coroutine whose tw awaitables (delay, TimedWorker,
+    // nested timed_tasks) observe the task's stop token and deadline and
+    // resume with timed_out/stopped instead of blocking a thread.
+    //
+    // Suspended tasks cost no thread. Timers and finishing workers hand
+    // them to a small shared pool (detail::resume_queue) to be resumed, so
+    // code between co_awaits never holds up the timer thread; it should
+    // still be short, since a blocked continuation ties up a pool thread.
+    template <class T>
+    class [[nodiscard]] timed_task
+    {
+    public:
+        using promise_type = detail::task_promise<T>;
+        using Clock = detail::task_clock;
+
+        timed_task() noexcept = default;
+        explicit timed_task(std::coroutine_handle<promise_type> h) noexcept : _h(h) {}
+
+        timed_task(timed_task &&o) noexcept : _h(std::exchange(o._h, {})) {}
+        timed_task &operator=(timed_task &&o) noexcept
+        {
+            if (this != &o)
+            {
+                reset();
+                _h = std::exchange(o._h, {});
+            }
+            return *this;
+        }
+        timed_task(const timed_task &) = delete;
+        timed_task &operator=(const timed_task &) = delete;
+
+        ~timed_task() { reset(); }
+
+        // Narrows the deadline the task inherits when it is awaited or started.
+        template <class Rep, class Period>
+        timed_task with_timeout(std::chrono::duration<Rep, Period> budget) &&
+        {
+            _h.promise().set_budget(detail::to_worker_duration(budget));
+            return std::move(*this);
+        }
+
+        // Runs the task on the calling thread up to its first suspension.
+        void start(Clock::time_point deadline, std::stop_token stop = {})
+        {
+            _h.promise().make_root(deadline, std::move(stop));
+            _h.resume();
+        }
+
+        template <class Rep, class Period>
+        void start(std::chrono::duration<Rep, Period> timeout, std::stop_token stop = {})
+        {
+            start(detail::add_sat(Clock::now(), detail::to_worker_duration(timeout)), std::move(stop));
+        }
+
+        void request_stop() noexcept
+        {
+            if (auto *r = root())
+                r->source.request_stop();
+        }
+
+        bool done() const
+        {
+            auto *r = root();
+            if (!r)
+                return false;
+            std::lock_guard lk(r->mtx);
+            return r->finished;
+        }
+
+        // wait(), wait_until() and result() require a task that was start()ed.
+        void wait() const
+        {
+            auto *r = root();
+            assert(r && "timed_task::wait() on a task that was never started");
+            std::unique_lock lk(r->mtx);
+            r->cv.wait(lk, [r]
+                       { return r->finished; });
+        }
+
+        bool wait_until(Clock::time_point tp) const
+        {
+            auto *r = root();
+            assert(r && "timed_task::wait_until() on a task that was never started");
+            std::unique_lock lk(r->mtx);
+            return r->cv.wait_until(lk, tp, [r]
+                                    { return r->finished; });
+        }
+
+        // Blocks until the started task has finished.
+        timed_result<T> result()
+        {
+            wait();
+            return _h.promise().take_result();
+        }
+
+        detail::task_awaiter<T> bind(const detail::task_context &ctx) &&
+        {
+            return detail::task_awaiter<T>(std::exchange(_h, {}), ctx);
+        }
+
+    private:
+        detail::task_root *root() const noexcept { return _h ? _h.promise().root() : nullptr; }
+
+        void reset() noexcept
+        {
+            if (!_h)
+                return;
+            if (root())
+            {
+                request_stop();
+                wait();
+            }
+            _h.destroy();
+            _h = {};
+        }
+
+        std::coroutine_handle<promise_type> _h;
+    };
+
+    namespace detail
+    {
+        template <class T>
+        timed_task<T> task_promise<T>::get_return_object() noexcept
+        {
+            return timed_task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+        }
+
+        inline timed_task<void> task_promise<void>::get_return_object() noexcept
+        {
+            return timed_task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+        }
+    } // namespace detail
+
+    // co_await tw::delay(10ms) -> timed_result<void>
+    template <class Rep, class Period>
+    detail::delay_t delay(std::chrono::duration<Rep, Period> d)
+    {
+        return {detail::add_sat(detail::task_clock::now(), detail::to_worker_duration(d))};
+    }
+
+    inline detail::delay_t delay_until(detail::task_clock::time_point tp) noexcept { return {tp}; }
+
+    namespace this_task
+    {
+        struct stop_token_t
+        {
+            auto bind(const detail::task_context &ctx) const noexcept
+            {
+                return detail::ready_awaiter<std::stop_token>{ctx.stop};
+            }
+        };
+
+        struct deadline_t
+        {
+            auto bind(const detail::task_context &ctx) const noexcept
+            {
+                return detail::ready_awaiter<detail::task_clock::time_point>{ctx.deadline};
+            }
+        };
+
+        // co_await tw::this_task::get_stop_token()
+        inline stop_token_t get_stop_token() noexcept { return {}; }
+        // co_await tw::this_task::deadline()
+        inline deadline_t deadline() noexcept { return {}; }
+    } // namespace this_task
+
+    // Starts the task on the calling thread and blocks until it finishes.
+    template <class T, class Rep, class Period>
+    timed_result<T> sync_wait(timed_task<T> task, std::chrono::duration<Rep, Period> timeout,
+                              std::stop_token stop = {})
+    {
+        task.start(timeout, std::move(stop));
+        return task.result();
+    }
+
+} // namespace tw
+
+#endif // TW_TIMED_TASK_HPP
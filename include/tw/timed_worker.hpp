@@ -2,34 +2,316 @@
 #define TW_TIMED_WORKER_HPP
 #pragma once
 
+#include <tw/detail/completion_flag.hpp>
+#include <tw/detail/detach_budget.hpp>
+#include <tw/detail/worker_registry.hpp>
+#include <tw/detail/worker_trace.hpp>
+#include <tw/timer_service.hpp>
+#include <tw/virtual_clock.hpp>
+
 #include <chrono>
-#include <condition_variable>
+#include <concepts>
 #include <iostream>
-#include <mutex>
+#include <memory>
 #include <optional>
 #include <stop_token>
 #include <atomic>
-#include <future>
 #include <thread>
-#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace tw
 {
-    template <class LogS = std::ostream, class F, class... Args>
-    auto make_timed_worker(std::chrono::milliseconds timeout, F &&f, LogS &ls = std::cerr, Args &&...args);
+    // Intrusive continuation invoked once, on the worker thread, right after
+    // the callable has returned. Used by awaiters that must not block.
+    class completion_hook
+    {
+    public:
+        using callback = void (*)(completion_hook &) noexcept;
+
+        explicit completion_hook(callback fn) noexcept : _fn(fn) {}
+
+        completion_hook(const completion_hook &) = delete;
+        completion_hook &operator=(const completion_hook &) = delete;
+
+        void operator()() noexcept { _fn(*this); }
+
+        // Marks "already done" in a worker's hook slot.
+        static completion_hook *sentinel() noexcept
+        {
+            static completion_hook s{[](completion_hook &) noexcept {}};
+            return &s;
+        }
+
+    private:
+        callback _fn;
+    };
+
+    template <class LogStream>
+    class TimedWorker;
+
+    namespace detail
+    {
+        using worker_clock = std::chrono::steady_clock;
+
+        // The calling thread's virtual clock if it is in a clock_scope.
+        inline worker_clock::time_point clock_now()
+        {
+            return current_clock ? current_clock->now() : worker_clock::now();
+        }
+
+        // Converts any duration to the worker clock, rounding up and
+        // saturating instead of overflowing.
+        template <class Rep, class Period>
+        constexpr worker_clock::duration to_worker_duration(std::chrono::duration<Rep, Period> d) noexcept
+        {
+            if (d <= std::chrono::duration<Rep, Period>::zero())
+                return worker_clock::duration::zero();
+            if (std::chrono::duration<double, std::nano>(d).count() >=
+                static_cast<double>(std::chrono::nanoseconds(worker_clock::duration::max()).count()))
+                return worker_clock::duration::max();
+            return std::chrono::ceil<worker_clock::duration>(d);
+        }
+
+        template <class C, class D>
+        worker_clock::time_point to_worker_time(std::chrono::time_point<C, D> tp)
+        {
+            if constexpr (std::is_same_v<C, worker_clock>)
+                return std::chrono::ceil<worker_clock::duration>(tp);
+            else
+                return clock_now() + to_worker_duration(tp - C::now());
+        }
+
+        constexpr worker_clock::time_point add_sat(worker_clock::time_point t, worker_clock::duration d) noexcept
+        {
+            return d >= worker_clock::time_point::max() - t ? worker_clock::time_point::max() : t + d;
+        }
+
+        // stop_callback that propagates a stop request to another source.
+        struct forward_stop
+        {
+            std::stop_source *src;
+            void operator()() const noexcept { src->request_stop(); }
+        };
+
+        // Requests stop on the worker thread when the run deadline passes.
+        struct run_deadline_timer : timer_node
+        {
+            run_deadline_timer() noexcept : timer_node(&on_fire) {}
+
+            static void on_fire(timer_node &n) noexcept
+            {
+                auto &self = static_cast<run_deadline_timer &>(n);
+                self.src.request_stop();
+                self.fired.store(true, std::memory_order_release);
+            }
+
+            std::stop_source src{std::nostopstate};
+            std::atomic_bool fired{false};
+        };
+
+        // Requests stop on a source at `when` while in scope; for budgets of
+        // work items run on threads that outlive them.
+        class scoped_deadline
+        {
+        public:
+            scoped_deadline(std::stop_source src, worker_clock::time_point when, virtual_clock *clock = nullptr)
+                : _armed(when != worker_clock::time_point::max()), _clock(clock)
+            {
+                _timer.src = std::move(src);
+                if (!_armed)
+                    return;
+                if (_clock)
+                    _clock->schedule(_timer, when);
+                else
+                    timer_service::global().schedule(_timer, when);
+            }
+
+            scoped_deadline(const scoped_deadline &) = delete;
+            scoped_deadline &operator=(const scoped_deadline &) = delete;
+
+            ~scoped_deadline() { finish(); }
+
+            // Disarms the timer; true if it fired first.
+            bool finish() noexcept
+            {
+                if (_armed && !(_clock ? _clock->cancel(_timer) : timer_service::global().cancel(_timer)))
+                    while (!_timer.fired.load(std::memory_order_acquire))
+                        std::this_thread::yield();
+                _armed = false;
+                return _timer.fired.load(std::memory_order_acquire);
+            }
+
+        private:
+            run_deadline_timer _timer;
+            bool _armed;
+            virtual_clock *_clock;
+        };
+
+        // Stop token of the callable running on this thread, if any.
+        inline thread_local std::stop_token const *current_stop = nullptr;
+
+        // Makes `st` the token this_worker calls on this thread observe while
+        // in scope; for work items that run with their own stop source on a
+        // thread that outlives them.
+        class stop_scope
+        {
+        public:
+            explicit stop_scope(std::stop_token st) noexcept
+                : _st(std::move(st)), _prev(std::exchange(current_stop, &_st))
+            {
+            }
+
+            stop_scope(const stop_scope &) = delete;
+            stop_scope &operator=(const stop_scope &) = delete;
+
+            ~stop_scope() { current_stop = _prev; }
+
+        private:
+            std::stop_token _st;
+            std::stop_token const *_prev;
+        };
+
+        struct run_inline_t
+        {
+        };
+
+        // State the worker thread touches. Shared with the thread so that a
+        // detached thread never writes into a destroyed TimedWorker.
+        // Enrolled in the worker registry for its whole lifetime, so that
+        // emergency_stop_all() reaches it even after a detach.
+        struct worker_control : worker_entry
+        {
+            worker_control() : slot(worker_registry::global().enroll(this))
+            {
+                if (tracing())
+                {
+                    trace.on = true;
+                    trace.created = worker_clock::now();
+                }
+            }
+            // For a run on the calling thread: owns its stop source, which
+            // is armed from the start.
+            explicit worker_control(run_inline_t) : worker_control()
+            {
+                stop = std::stop_source();
+                armed.store(true, std::memory_order_release);
+            }
+            worker_control(const worker_control &) = delete;
+            worker_control &operator=(const worker_control &) = delete;
+            ~worker_control() { worker_registry::leave(slot); }
+
+            std::atomic<completion_hook *> hook{nullptr};
+            run_deadline_timer timer;
+            // Set by both detach() and the returning thread; whichever
+            // comes second settles the detach budget.
+            std::atomic_bool orphan{false};
+            worker_trace trace;
+            worker_registry::slot *slot;
+        };
+
+        // When the destructor gives up: `grace` after stop is requested
+        // (at destruction or at stopAt, whichever comes first), never later
+        // than joinBy.
+        struct worker_limits
+        {
+            worker_clock::duration grace;
+            worker_clock::time_point deadline;
+            worker_clock::time_point stopAt = worker_clock::time_point::max();
+            worker_clock::time_point joinBy = worker_clock::time_point::max();
+            // null: real time
+            virtual_clock *clock = nullptr;
+        };
+
+        struct worker_access
+        {
+            // Admitted against the detach budget, which may block the caller
+            // or run f on it (see detach_policy). Internal callers build
+            // their workers off the timer thread and outside their locks.
+            template <class LogS, class F>
+            static TimedWorker<LogS> make(worker_limits lim, F &&f, LogS &ls)
+            {
+                lim.clock = current_clock;
+                // a worker with any bound can run inline, stopped at that bound
+                auto bound = std::min(lim.stopAt, lim.joinBy);
+                if (!detach_budget::global().admit(bound != worker_clock::time_point::max()))
+                {
+                    lim.stopAt = bound;
+                    return TimedWorker<LogS>(run_inline_t{}, lim, std::forward<F>(f), ls);
+                }
+                return TimedWorker<LogS>(lim, std::forward<F>(f), ls);
+            }
+
+            // Long-lived worker owned by a pool or scheduler: stop comes from
+            // its owner, which then allows `grace`. Not admitted against the
+            // detach budget, so a full budget never refuses to build the
+            // owner; it is still counted should it detach.
+            template <class LogS, class F>
+            static TimedWorker<LogS> make_service(worker_clock::duration grace, F &&f, LogS &ls)
+            {
+                worker_limits lim{grace, worker_clock::time_point::max()};
+                lim.clock = current_clock;
+                return TimedWorker<LogS>(lim, std::forward<F>(f), ls);
+            }
+        };
+
+        template <class F, class... Args>
+        auto bind_worker(F &&f, Args &&...args)
+        {
+            return [func = std::forward<F>(f),
+                    tup = std::make_tuple(std::forward<Args>(args)...)](std::stop_token st) mutable
+            {
+                std::apply([&](auto &&...cur)
+                           { func(st, std::forward<decltype(cur)>(cur)...); }, tup);
+            };
+        }
+    } // namespace detail
+
+    template <class F, class... Args>
+    concept timed_callable = std::invocable<std::decay_t<F> &, std::stop_token, std::decay_t<Args> &...>;
 
     template <class LogStream = std::ostream>
     class TimedWorker
     {
     public:
-        template <class LogS, class F, class... Args>
-        friend auto make_timed_worker(std::chrono::milliseconds timeout, F &&f, LogS &ls, Args &&...args);
+        using Clock = std::chrono::steady_clock;
+
+        friend struct detail::worker_access;
 
         void request_stop() noexcept { _thr.request_stop(); }
-        void emergency_stop() noexcept { _emergency.store(true, std::memory_order_relaxed); }
 
-        bool done() const noexcept { return _done.load(std::memory_order_acquire); }
+        // Requests stop and makes the destructor detach without waiting.
+        void emergency_stop() noexcept
+        {
+            _ctl->emergency.store(true, std::memory_order_relaxed);
+            _thr.request_stop();
+        }
+
+        bool done() const noexcept { return _ctl->done.is_set(); }
+
+        // Waits for the callable to return, without requesting stop.
+        bool wait_until(Clock::time_point tp) const { return wait_done(tp); }
         bool detached() const noexcept { return _detached; }
+        Clock::time_point deadline() const noexcept { return _lim.deadline; }
+        Clock::duration shutdown_grace() const noexcept { return _lim.grace; }
+
+        // Arranges for h() to run on the worker thread once the callable has
+        // returned. Returns false if the worker is already done (h will not
+        // run). At most one hook may be registered at a time.
+        bool add_completion_hook(completion_hook &h) noexcept
+        {
+            completion_hook *expected = nullptr;
+            return _ctl->hook.compare_exchange_strong(expected, &h, std::memory_order_acq_rel);
+        }
+
+        // Returns true if h was unregistered before the worker finished.
+        // false means h has run or is running on the worker thread.
+        bool remove_completion_hook(completion_hook &h) noexcept
+        {
+            completion_hook *expected = &h;
+            return _ctl->hook.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+        }
 
         TimedWorker(TimedWorker &&) noexcept = default;
         TimedWorker &operator=(TimedWorker &&) noexcept = default;
@@ -40,90 +322,273 @@ namespace tw
         {
             if (_thr.joinable())
             {
-                if (_done.load(std::memory_order_acquire))
+                if (_ctl->done.is_set())
                 {
                     _thr.join();
+                    cancel_run_deadline();
+                    trace(false);
                     return;
                 }
 
-                auto now = Clock::now();
-                auto deadline = std::min(now + _timeout, _absDeadline);
+                auto now = _lim.clock ? _lim.clock->now() : Clock::now();
+                auto deadline = std::min(detail::add_sat(std::min(now, _lim.stopAt), _lim.grace), _lim.joinBy);
 
                 _thr.request_stop();
-                if (_emergency.load(std::memory_order_relaxed))
+                if (_ctl->emergency.load(std::memory_order_relaxed) || detail::emergency_requested())
                     deadline = now;
 
-                auto fut = std::async(std::launch::async, [thr = std::move(_thr)]() mutable
-                                      { thr.join(); });
+                if (wait_done(deadline))
+                {
+                    _thr.join();
+                    cancel_run_deadline();
+                    trace(false);
+                    return;
+                }
 
-                if (fut.wait_until(deadline) != std::future_status::ready)
+                try
+                {
+                    _log << "[TimedWorker] FORCED detach - resources may leak\n";
+                }
+                catch (...)
                 {
-                    try
-                    {
-                        _log << "[TimedWorker] FORCED detach - resources may leak\n";
-                    }
-                    catch (...)
-                    {
-                    }
-                    detach();
                 }
+                detach();
+                cancel_run_deadline();
+                trace(true);
+            }
+            else if (_ctl)
+            {
+                // ran inline
+                trace(false);
             }
         }
 
     private:
-        using Clock = std::chrono::steady_clock;
+        template <class F>
+        TimedWorker(detail::worker_limits const &lim, F &&f, LogStream &log)
+            : _lim(lim), _ctl(std::make_shared<detail::worker_control>()), _log(log),
+              _thr([ctl = _ctl, log = &log, func = std::forward<F>(f)](std::stop_token st) mutable
+                   {
+              run(*ctl, *log, func, st);
+              if (ctl->orphan.exchange(true, std::memory_order_acq_rel))
+                  detail::detach_budget::global().release(); })
+        {
+            if (_ctl->trace.on)
+                _ctl->trace.timeout = trace_timeout();
+            _ctl->stop = _thr.get_stop_source();
+            _ctl->armed.store(true, std::memory_order_release);
+            if (_lim.stopAt != Clock::time_point::max())
+            {
+                _ctl->timer.src = _thr.get_stop_source();
+                if (_lim.clock)
+                    _lim.clock->schedule(_ctl->timer, _lim.stopAt);
+                else
+                    timer_service::global().schedule(_ctl->timer, _lim.stopAt);
+            }
+        }
+
+        // The detach budget is spent: runs f on the calling thread until
+        // its run deadline and leaves an already finished worker.
+        template <class F>
+        TimedWorker(detail::run_inline_t, detail::worker_limits const &lim, F &&f, LogStream &log)
+            : _lim(lim), _ctl(std::make_shared<detail::worker_control>(detail::run_inline_t{})), _log(log)
+        {
+            if (_ctl->trace.on)
+                _ctl->trace.timeout = trace_timeout();
+            detail::scoped_deadline deadline(_ctl->stop, _lim.stopAt, _lim.clock);
+            run(*_ctl, log, f, _ctl->stop.get_token());
+        }
 
         template <class F>
-        TimedWorker(std::chrono::milliseconds to, F &&f, LogStream &log = std::cerr)
-            : _timeout(to), _absDeadline(Clock::now() + to), _log(log), _thr([this, func = std::forward<F>(f)](std::stop_token st) mutable
-                                                                             {
-              // register emergency flag as an additional stop condition
-              std::stop_callback cb(st, [this]() noexcept {
-                  _emergency.store(true, std::memory_order_relaxed);
-              });
+        static void run(detail::worker_control &ctl, LogStream &log, F &func, std::stop_token st)
+        {
+            // Skip work if stop was already requested
+            if (!st.stop_requested())
+            {
+                if (ctl.trace.on)
+                    ctl.trace.started = detail::worker_clock::now();
+                auto outcome = trace_outcome::completed;
+                try
+                {
+                    detail::stop_scope scope(st);
+                    func(st);
+                }
+                catch (std::exception const &ex)
+                {
+                    outcome = trace_outcome::failed;
+                    log << "[TimedWorker] unhandled exception: " << ex.what() << '\n';
+                }
+                catch (...)
+                {
+                    outcome = trace_outcome::failed;
+                    log << "[TimedWorker] unknown exception\n";
+                }
+                if (ctl.trace.on)
+                {
+                    ctl.trace.ended = detail::worker_clock::now();
+                    ctl.trace.outcome = outcome == trace_outcome::completed && st.stop_requested()
+                                            ? trace_outcome::stopped
+                                            : outcome;
+                }
+            }
 
-              // Skip work if stop was already requested
-              if (!st.stop_requested())
-              {
-                  try { func(st); }
-                  catch (std::exception const& ex) {
-                      _log << "[TimedWorker] unhandled exception: " << ex.what() << '\n';
-                  } catch (...) {
-                      _log << "[TimedWorker] unknown exception\n";
-                  }
-              }
+            ctl.done.set();
+            if (auto *h = ctl.hook.exchange(completion_hook::sentinel(), std::memory_order_acq_rel))
+                (*h)();
+        }
 
-              _done.store(true, std::memory_order_release); })
+        // The timer lives in the control block; make sure it is neither
+        // pending nor running before that block can be released.
+        void cancel_run_deadline() noexcept
         {
+            if (_lim.stopAt == Clock::time_point::max())
+                return;
+            if (_lim.clock ? _lim.clock->cancel(_ctl->timer) : timer_service::global().cancel(_ctl->timer))
+                return;
+            while (!_ctl->timer.fired.load(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+
+        Clock::duration trace_timeout() const
+        {
+            if (_lim.stopAt == Clock::time_point::max())
+                return _lim.grace;
+            return _lim.stopAt - (_lim.clock ? _lim.clock->now() : Clock::now());
+        }
+
+        // Only called once the thread has returned or been given up on.
+        void trace(bool detached) noexcept
+        {
+            auto const &t = _ctl->trace;
+            if (!t.on)
+                return;
+            // a detached thread may still be writing its own timestamps
+            if (detached)
+                detail::trace_write(t, Clock::now() - t.created, trace_outcome::detached);
+            else if (t.outcome == trace_outcome::skipped)
+                detail::trace_write(t, Clock::duration::zero(), t.outcome);
+            else
+                detail::trace_write(t, t.ended - t.started, t.outcome);
+        }
+
+        bool wait_done(Clock::time_point tp) const
+        {
+            return _lim.clock ? _lim.clock->wait_until(_ctl->done, tp) : _ctl->done.wait_until(tp);
         }
 
         void detach() noexcept
         {
             _detached = true;
-            std::jthread temp;
-            std::memcpy((void *)&_thr, (void *)&temp, sizeof(temp));
+            auto &budget = detail::detach_budget::global();
+            budget.acquire();
+            if (_ctl->orphan.exchange(true, std::memory_order_acq_rel))
+                budget.release();
+            _thr.detach();
         }
 
-        std::chrono::milliseconds _timeout;
-        Clock::time_point _absDeadline;
-        std::jthread _thr;
-        std::atomic_bool _done{false};
-        std::atomic_bool _emergency{false};
+        detail::worker_limits _lim;
+        std::shared_ptr<detail::worker_control> _ctl;
         bool _detached{false};
         LogStream &_log;
+        // declared last: the thread starts running as soon as it is constructed
+        std::jthread _thr;
     };
 
-    template <class LogS, class F, class... Args>
-    auto make_timed_worker(std::chrono::milliseconds timeout,
-                           F &&f, LogS &ls, Args &&...args)
+    // Accepts any std::chrono::duration; it is rounded up to the steady
+    // clock's resolution, so microsecond budgets are honoured as such. The
+    // destructor waits up to `timeout`, but never past creation + timeout.
+    // Once the detach budget is spent, every overload may block or run f
+    // on the calling thread, as set by detach_policy.
+    template <class LogS = std::ostream, class Rep, class Period, class F, class... Args>
+        requires timed_callable<F, Args...>
+    auto make_timed_worker(std::chrono::duration<Rep, Period> timeout,
+                           F &&f, LogS &ls = std::cerr, Args &&...args)
+    {
+        auto to = detail::to_worker_duration(timeout);
+        auto dl = detail::add_sat(detail::clock_now(), to);
+        return detail::worker_access::make(detail::worker_limits{to, dl, detail::worker_clock::time_point::max(), dl},
+                                           detail::bind_worker(std::forward<F>(f), std::forward<Args>(args)...), ls);
+    }
+
+    // Absolute deadline on any clock; time points of other clocks are
+    // translated to the steady clock when the worker is created. The
+    // destructor never waits past the deadline.
+    template <class LogS = std::ostream, class C, class D, class F, class... Args>
+        requires timed_callable<F, Args...>
+    auto make_timed_worker(std::chrono::time_point<C, D> deadline,
+                           F &&f, LogS &ls = std::cerr, Args &&...args)
     {
-        auto bound = [func = std::forward<F>(f),
-                      tup = std::make_tuple(std::forward<Args>(args)...)](std::stop_token st) mutable
+        auto dl = detail::to_worker_time(deadline);
+        auto now = detail::clock_now();
+        auto to = dl > now ? dl - now : detail::worker_clock::duration::zero();
+        return detail::worker_access::make(detail::worker_limits{to, dl, detail::worker_clock::time_point::max(), dl},
+                                           detail::bind_worker(std::forward<F>(f), std::forward<Args>(args)...), ls);
+    }
+
+    // Separate run budget and shutdown grace: stop is requested when
+    // run_deadline passes (or at destruction, if earlier), and the worker
+    // then has shutdown_grace to return before it is detached, however
+    // long the handle has lived. The single-timeout overloads instead
+    // never wait past creation + timeout (or the deadline).
+    template <class LogS = std::ostream, class C, class D, class Rep, class Period, class F, class... Args>
+        requires timed_callable<F, Args...>
+    auto make_timed_worker(std::chrono::time_point<C, D> run_deadline, std::chrono::duration<Rep, Period> shutdown_grace,
+                           F &&f, LogS &ls = std::cerr, Args &&...args)
+    {
+        auto dl = detail::to_worker_time(run_deadline);
+        return detail::worker_access::make(detail::worker_limits{detail::to_worker_duration(shutdown_grace), dl, dl},
+                                           detail::bind_worker(std::forward<F>(f), std::forward<Args>(args)...), ls);
+    }
+
+    template <class LogS = std::ostream, class Rep1, class Period1, class Rep2, class Period2, class F, class... Args>
+        requires timed_callable<F, Args...>
+    auto make_timed_worker(std::chrono::duration<Rep1, Period1> run_budget,
+                           std::chrono::duration<Rep2, Period2> shutdown_grace,
+                           F &&f, LogS &ls = std::cerr, Args &&...args)
+    {
+        return make_timed_worker(detail::add_sat(detail::clock_now(), detail::to_worker_duration(run_budget)),
+                                 shutdown_grace, std::forward<F>(f), ls, std::forward<Args>(args)...);
+    }
+
+    namespace detail
+    {
+        template <class LogS, class Rep, class Period, class F>
+        TimedWorker<LogS> make_service_worker(std::chrono::duration<Rep, Period> grace, F &&f, LogS &ls)
         {
-            std::apply([&](auto &&...cur)
-                       { func(st, std::forward<decltype(cur)>(cur)...); }, tup);
-        };
-        return TimedWorker<LogS>(timeout, std::move(bound), ls);
+            return worker_access::make_service(to_worker_duration(grace), std::forward<F>(f), ls);
+        }
+    } // namespace detail
+
+    // Async-signal-safe, e.g. from a SIGTERM handler: flags every live
+    // worker and wakes a shutdown thread, which requests stop on all of them
+    // and waits against one deadline (see set_emergency_deadline). From
+    // then on every TimedWorker destructor detaches without waiting.
+    inline void emergency_stop_all() noexcept
+    {
+        detail::emergency_flag.store(true, std::memory_order_relaxed);
+        if (auto *r = detail::worker_registry::existing())
+            r->signal();
+    }
+
+    inline bool emergency_stop_requested() noexcept { return detail::emergency_requested(); }
+
+    // How long the shutdown thread waits for workers after emergency_stop_all().
+    inline void set_emergency_deadline(std::chrono::nanoseconds budget) noexcept
+    {
+        detail::emergency_budget_ns.store(budget.count(), std::memory_order_relaxed);
+    }
+
+    // Blocks until the shutdown thread has given up on or reaped every
+    // worker, or until `deadline`. Empty on timeout, or if there never was
+    // a worker to stop.
+    template <class C, class D>
+    std::optional<emergency_report> wait_emergency_stop(std::chrono::time_point<C, D> deadline)
+    {
+        emergency_report rep;
+        auto *r = detail::worker_registry::existing();
+        if (r && r->wait_report(detail::to_worker_time(deadline), rep))
+            return rep;
+        return std::nullopt;
     }
 
 } // namespace tw
@@ -0,0 +1,210 @@
+#ifndef TW_TIMER_SERVICE_HPP
+#define TW_TIMER_SERVICE_HPP
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
+
+namespace tw
+{
+    class timer_service;
+    class virtual_clock;
+
+    // Intrusive timer entry. The owner embeds the node (usually by inheriting
+    // from it) and keeps it alive until it has either fired or been cancelled,
+    // so scheduling never allocates.
+    class timer_node
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using callback = void (*)(timer_node &) noexcept;
+
+        explicit timer_node(callback fire) noexcept : _fire(fire) {}
+
+        timer_node(const timer_node &) = delete;
+        timer_node &operator=(const timer_node &) = delete;
+
+        Clock::time_point when() const noexcept { return _when; }
+
+    private:
+        friend class timer_service;
+        friend class virtual_clock;
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        callback _fire;
+        Clock::time_point _when{};
+        std::size_t _index{npos};
+    };
+
+    // One background thread driving a binary min-heap of timer_nodes.
+    // Callbacks run on that thread, outside the lock, and must not block.
+    class timer_service
+    {
+    public:
+        using Clock = timer_node::Clock;
+
+        timer_service()
+            : _thr([this](std::stop_token st)
+                   { run(st); })
+        {
+        }
+
+        // Pending timers are dropped without firing.
+        ~timer_service()
+        {
+            _thr.request_stop();
+            _cv.notify_all();
+        }
+
+        timer_service(const timer_service &) = delete;
+        timer_service &operator=(const timer_service &) = delete;
+
+        // Process-wide instance. Intentionally leaked so that timers touched
+        // from static destructors never outlive their service.
+        static timer_service &global()
+        {
+            static timer_service *svc = new timer_service;
+            return *svc;
+        }
+
+        // The node must not currently be scheduled.
+        void schedule(timer_node &n, Clock::time_point when)
+        {
+            bool wake;
+            {
+                std::lock_guard lk(_mtx);
+                n._when = when;
+                n._index = _heap.size();
+                _heap.push_back(&n);
+                sift_up(n._index);
+                wake = _heap.front() == &n;
+            }
+            if (wake)
+                _cv.notify_one();
+        }
+
+        // Returns true if the node was still pending and will now never fire.
+        // false means the callback has already run or is running right now.
+        bool cancel(timer_node &n) noexcept
+        {
+            std::lock_guard lk(_mtx);
+            if (n._index == timer_node::npos)
+                return false;
+            remove_at(n._index);
+            return true;
+        }
+
+        std::size_t pending() const
+        {
+            std::lock_guard lk(_mtx);
+            return _heap.size();
+        }
+
+    private:
+        void run(std::stop_token st)
+        {
+#if defined(__linux__)
+            // default 50us of timer slack would swamp sub-millisecond deadlines
+            prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+#endif
+            std::unique_lock lk(_mtx);
+            while (!st.stop_requested())
+            {
+                if (_heap.empty())
+                {
+                    _cv.wait(lk, st, [this]
+                             { return !_heap.empty(); });
+                    continue;
+                }
+
+                auto when = _heap.front()->_when;
+                auto now = Clock::now();
+                if (now < when)
+                {
+                    // cap the wait so far-future entries cannot overflow the
+                    // underlying clock conversion
+                    auto until = when - now > std::chrono::hours(1) ? now + std::chrono::hours(1) : when;
+                    _cv.wait_until(lk, st, until, [this, when]
+                                   { return _heap.empty() || _heap.front()->_when < when; });
+                    continue;
+                }
+
+                timer_node *n = _heap.front();
+                remove_at(0);
+                lk.unlock();
+                n->_fire(*n);
+                lk.lock();
+            }
+        }
+
+        void swap_at(std::size_t a, std::size_t b) noexcept
+        {
+            std::swap(_heap[a], _heap[b]);
+            _heap[a]->_index = a;
+            _heap[b]->_index = b;
+        }
+
+        void sift_up(std::size_t i) noexcept
+        {
+            while (i > 0)
+            {
+                std::size_t parent = (i - 1) / 2;
+                if (!(_heap[i]->_when < _heap[parent]->_when))
+                    break;
+                swap_at(i, parent);
+                i = parent;
+            }
+        }
+
+        void sift_down(std::size_t i) noexcept
+        {
+            for (;;)
+            {
+                std::size_t l = 2 * i + 1, r = l + 1, m = i;
+                if (l < _heap.size() && _heap[l]->_when < _heap[m]->_when)
+                    m = l;
+                if (r < _heap.size() && _heap[r]->_when < _heap[m]->_when)
+                    m = r;
+                if (m == i)
+                    break;
+                swap_at(i, m);
+                i = m;
+            }
+        }
+
+        void remove_at(std::size_t i) noexcept
+        {
+            timer_node *n = _heap[i];
+            std::size_t last = _heap.size() - 1;
+            if (i != last)
+            {
+                swap_at(i, last);
+                _heap.pop_back();
+                sift_down(i);
+                sift_up(i);
+            }
+            else
+            {
+                _heap.pop_back();
+            }
+            n->_index = timer_node::npos;
+        }
+
+        mutable std::mutex _mtx;
+        std::condition_variable_any _cv;
+        std::vector<timer_node *> _heap;
+        std::jthread _thr;
+    };
+
+} // namespace tw
+
+#endif // TW_TIMER_SERVICE_HPP
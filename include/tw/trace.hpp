@@ -0,0 +1,156 @@
+#ifndef TW_TRACE_HPP
+#define TW_TRACE_HPP
+#pragma once
+
+#include <tw/detail/worker_trace.hpp>
+#include <tw/timed_worker.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+namespace tw
+{
+    // Binary trace layout: "TWTR", a version byte, then per record, sorted
+    // by creation time, the LEB128 varints created-delta, timeout and run
+    // (nanoseconds) and one outcome byte; typically 8-12 bytes a worker.
+    inline std::vector<std::uint8_t> encode_trace(std::span<trace_record const> records)
+    {
+        std::vector<trace_record> sorted(records.begin(), records.end());
+        std::stable_sort(sorted.begin(), sorted.end(), [](auto const &a, auto const &b)
+                         { return a.created < b.created; });
+
+        std::vector<std::uint8_t> out{'T', 'W', 'T', 'R', 1};
+        auto varint = [&](std::int64_t v)
+        {
+            auto u = static_cast<std::uint64_t>(std::max<std::int64_t>(v, 0));
+            do
+            {
+                std::uint8_t b = u & 0x7f;
+                u >>= 7;
+                out.push_back(u ? b | 0x80 : b);
+            } while (u);
+        };
+
+        std::chrono::nanoseconds prev{0};
+        for (auto const &r : sorted)
+        {
+            varint((r.created - prev).count());
+            varint(r.timeout.count());
+            varint(r.run.count());
+            out.push_back(static_cast<std::uint8_t>(r.outcome));
+            prev = r.created;
+        }
+        return out;
+    }
+
+    inline std::vector<trace_record> decode_trace(std::span<std::uint8_t const> bytes)
+    {
+        static constexpr std::uint8_t magic[] = {'T', 'W', 'T', 'R', 1};
+        if (bytes.size() < sizeof magic || std::memcmp(bytes.data(), magic, sizeof magic) != 0)
+            throw std::runtime_error("tw::trace: not a version 1 trace");
+
+        std::size_t i = sizeof magic;
+        auto varint = [&]
+        {
+            std::uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                if (i == bytes.size())
+                    throw std::runtime_error("tw::trace: truncated record");
+                auto b = bytes[i++];
+                v |= std::uint64_t(b & 0x7f) << shift;
+                if (!(b & 0x80))
+                    return std::chrono::nanoseconds(static_cast<std::int64_t>(v));
+            }
+            throw std::runtime_error("tw::trace: bad varint");
+        };
+
+        std::vector<trace_record> out;
+        std::chrono::nanoseconds created{0};
+        while (i < bytes.size())
+        {
+            trace_record r;
+            r.created = created += varint();
+            r.timeout = varint();
+            r.run = varint();
+            if (i == bytes.size() || bytes[i] > static_cast<std::uint8_t>(trace_outcome::skipped))
+                throw std::runtime_error("tw::trace: bad outcome");
+            r.outcome = static_cast<trace_outcome>(bytes[i++]);
+            out.push_back(r);
+        }
+        return out;
+    }
+
+    inline void save_trace(std::filesystem::path const &file, std::span<trace_record const> records)
+    {
+        auto bytes = encode_trace(records);
+        std::ofstream os(file, std::ios::binary | std::ios::trunc);
+        if (!os.write(reinterpret_cast<char const *>(bytes.data()), static_cast<std::streamsize>(bytes.size())))
+            throw std::system_error(errno, std::generic_category(), "tw::trace: write " + file.string());
+    }
+
+    inline std::vector<trace_record> load_trace(std::filesystem::path const &file)
+    {
+        std::ifstream is(file, std::ios::binary);
+        if (!is)
+            throw std::system_error(errno, std::generic_category(), "tw::trace: open " + file.string());
+        std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+        return decode_trace(bytes);
+    }
+
+    // Records every TimedWorker created while it is started: creation time,
+    // timeout, run time and outcome, taken when the worker's handle is
+    // destroyed. One recorder can be active at a time. Workers cost one
+    // relaxed load when no recorder is active.
+    class trace_recorder final : detail::trace_sink
+    {
+    public:
+        trace_recorder() = default;
+        trace_recorder(const trace_recorder &) = delete;
+        trace_recorder &operator=(const trace_recorder &) = delete;
+
+        ~trace_recorder() { stop(); }
+
+        void start() { detail::trace_attach(this, std::chrono::steady_clock::now()); }
+        void stop() { detail::trace_detach(this); }
+
+        std::vector<trace_record> records() const
+        {
+            std::lock_guard lk(_mtx);
+            return _records;
+        }
+
+        void save(std::filesystem::path const &file) const { save_trace(file, records()); }
+
+    private:
+        void write(trace_record const &r) noexcept override
+        {
+            try
+            {
+                std::lock_guard lk(_mtx);
+                _records.push_back(r);
+            }
+            catch (...)
+            {
+            }
+        }
+
+        mutable std::mutex _mtx;
+        std::vector<trace_record> _records;
+    };
+
+} // namespace tw
+
+#endif // TW_TRACE_HPP
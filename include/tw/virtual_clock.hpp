@@ -0,0 +1,175 @@
+#ifndef TW_VIRTUAL_CLOCK_HPP
+#define TW_VIRTUAL_CLOCK_HPP
+#pragma once
+
+#include <tw/detail/completion_flag.hpp>
+#include <tw/timer_service.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <stop_token>
+#include <utility>
+#include <vector>
+
+namespace tw
+{
+    // Manually advanced time source for tests. Time only moves in advance(),
+    // which also fires the timers that come due, in order, on the calling
+    // thread. Workers created on a thread inside a clock_scope take their
+    // run deadline, shutdown grace and destructor wait from it. The clock
+    // must outlive those workers.
+    class virtual_clock
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit virtual_clock(Clock::time_point start = Clock::now()) : _now(start) {}
+
+        virtual_clock(const virtual_clock &) = delete;
+        virtual_clock &operator=(const virtual_clock &) = delete;
+
+        Clock::time_point now() const
+        {
+            std::lock_guard lk(_mtx);
+            return _now;
+        }
+
+        template <class Rep, class Period>
+        void advance(std::chrono::duration<Rep, Period> d)
+        {
+            advance_to(now() + std::chrono::ceil<Clock::duration>(d));
+        }
+
+        // Timers due by `tp` fire with the clock set to their own time.
+        void advance_to(Clock::time_point tp)
+        {
+            std::unique_lock lk(_mtx);
+            for (;;)
+            {
+                auto it = std::min_element(_timers.begin(), _timers.end(), [](auto *a, auto *b)
+                                           { return a->_when < b->_when; });
+                if (it == _timers.end() || (*it)->_when > tp)
+                    break;
+                timer_node *n = *it;
+                _timers.erase(it);
+                n->_index = timer_node::npos;
+                _now = std::max(_now, n->_when);
+                lk.unlock();
+                n->_fire(*n);
+                lk.lock();
+            }
+            _now = std::max(_now, tp);
+            lk.unlock();
+            _cv.notify_all();
+        }
+
+        // Threads blocked in a wait on this clock.
+        std::size_t waiters() const
+        {
+            std::lock_guard lk(_mtx);
+            return _waiters;
+        }
+
+        // Lets a test advance time only once the code under test waits.
+        void block_until_waiters(std::size_t n) const
+        {
+            std::unique_lock lk(_mtx);
+            _cv.wait(lk, [&]
+                     { return _waiters >= n; });
+        }
+
+        std::size_t pending() const
+        {
+            std::lock_guard lk(_mtx);
+            return _timers.size();
+        }
+
+        // Same contract as timer_service::schedule and cancel.
+        void schedule(timer_node &n, Clock::time_point when)
+        {
+            std::lock_guard lk(_mtx);
+            n._when = when;
+            n._index = 0;
+            _timers.push_back(&n);
+        }
+
+        bool cancel(timer_node &n) noexcept
+        {
+            std::lock_guard lk(_mtx);
+            if (n._index == timer_node::npos)
+                return false;
+            std::erase(_timers, &n);
+            n._index = timer_node::npos;
+            return true;
+        }
+
+        // True once f is set, false once virtual time reaches `deadline`
+        // first. The flag is polled; advances wake the waiter at once.
+        bool wait_until(detail::completion_flag &f, Clock::time_point deadline)
+        {
+            std::unique_lock lk(_mtx);
+            ++_waiters;
+            _cv.notify_all();
+            while (!f.is_set() && _now < deadline)
+                _cv.wait_for(lk, std::chrono::microseconds(100));
+            --_waiters;
+            return f.is_set();
+        }
+
+        void sleep_until(Clock::time_point deadline)
+        {
+            std::unique_lock lk(_mtx);
+            ++_waiters;
+            _cv.notify_all();
+            _cv.wait(lk, [&]
+                     { return _now >= deadline; });
+            --_waiters;
+        }
+
+        // Like sleep_until, but returns false once `st` is stopped first.
+        // The token is polled, as in wait_until.
+        bool sleep_until(Clock::time_point deadline, std::stop_token const &st)
+        {
+            std::unique_lock lk(_mtx);
+            ++_waiters;
+            _cv.notify_all();
+            while (!st.stop_requested() && _now < deadline)
+                _cv.wait_for(lk, std::chrono::microseconds(100));
+            --_waiters;
+            return !st.stop_requested();
+        }
+
+    private:
+        mutable std::mutex _mtx;
+        mutable std::condition_variable _cv;
+        Clock::time_point _now;
+        std::vector<timer_node *> _timers;
+        std::size_t _waiters{0};
+    };
+
+    namespace detail
+    {
+        inline thread_local virtual_clock *current_clock = nullptr;
+    } // namespace detail
+
+    // Workers created on this thread while in scope run on `clock`.
+    class clock_scope
+    {
+    public:
+        explicit clock_scope(virtual_clock &clock) noexcept : _prev(std::exchange(detail::current_clock, &clock)) {}
+
+        clock_scope(const clock_scope &) = delete;
+        clock_scope &operator=(const clock_scope &) = delete;
+
+        ~clock_scope() { detail::current_clock = _prev; }
+
+    private:
+        virtual_clock *_prev;
+    };
+
+} // namespace tw
+
+#endif // TW_VIRTUAL_CLOCK_HPP
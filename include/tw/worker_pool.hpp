@@ -0,0 +1,157 @@
+#ifndef TW_WORKER_POOL_HPP
+#define TW_WORKER_POOL_HPP
+#pragma once
+
+#include <tw/channel.hpp>
+#include <tw/timed_worker.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tw
+{
+    namespace detail
+    {
+        struct pool_task
+        {
+            virtual ~pool_task() = default;
+            virtual void run(std::stop_token st) = 0;
+        };
+
+        template <class F>
+        struct pool_task_for final : pool_task
+        {
+            explicit pool_task_for(F f) : fn(std::move(f)) {}
+            void run(std::stop_token st) override { fn(std::move(st)); }
+            F fn;
+        };
+
+        using pool_queue = channel<std::unique_ptr<pool_task>>;
+
+        // A throwing task is logged and dropped; it must not end the
+        // worker's loop and take a thread away from the pool.
+        template <class LogStream>
+        void run_pool_task(pool_task &task, std::stop_token const &st, LogStream &log) noexcept
+        {
+            try
+            {
+                task.run(st);
+            }
+            catch (std::exception const &ex)
+            {
+                try
+                {
+                    log << "[worker_pool] unhandled exception: " << ex.what() << '\n';
+                }
+                catch (...)
+                {
+                }
+            }
+            catch (...)
+            {
+                try
+                {
+                    log << "[worker_pool] unknown exception\n";
+                }
+                catch (...)
+                {
+                }
+            }
+        }
+    } // namespace detail
+
+    // Fixed set of long-lived TimedWorkers sharing one bounded queue. Tasks
+    // get the pool's stop_token; a task's own budget is the submitter's
+    // business; one that throws is logged and does not cost the pool its
+    // thread. On destruction queued tasks that have not started are
+    // dropped and running ones get `shutdown_grace` to return, all counted
+    // from the same moment.
+    template <class LogStream = std::ostream>
+    class worker_pool
+    {
+    public:
+        explicit worker_pool(std::size_t threads = std::thread::hardware_concurrency(),
+                             LogStream &log = std::cerr,
+                             std::chrono::nanoseconds shutdown_grace = std::chrono::milliseconds(10),
+                             std::size_t queue = 1024)
+            : _queue(std::make_shared<detail::pool_queue>(queue)), _grace(detail::to_worker_duration(shutdown_grace)),
+              _clock(detail::current_clock)
+        {
+            threads = std::max<std::size_t>(threads, 1);
+            _workers.reserve(threads);
+            for (std::size_t i = 0; i < threads; ++i)
+                _workers.push_back(detail::make_service_worker(shutdown_grace, [q = _queue, log = &log](std::stop_token st)
+                                                              {
+                    while (!st.stop_requested())
+                    {
+                        auto task = q->pop(st);
+                        if (!task)
+                            return;
+                        detail::run_pool_task(**task, st, *log);
+                    } }, log));
+        }
+
+        worker_pool(const worker_pool &) = delete;
+        worker_pool &operator=(const worker_pool &) = delete;
+
+        ~worker_pool()
+        {
+            _queue->close();
+            for (auto &w : _workers)
+                w.request_stop();
+            // the workers wait on the clock they were built with
+            auto deadline = detail::add_sat(_clock ? _clock->now() : detail::worker_clock::now(), _grace);
+            for (auto &w : _workers)
+                if (!w.wait_until(deadline))
+                    w.emergency_stop();
+        }
+
+        // Blocks while the queue is full; false once the pool is shutting
+        // down.
+        template <class F>
+            requires std::invocable<F &, std::stop_token>
+        bool submit(F f)
+        {
+            return _queue->push(std::make_unique<detail::pool_task_for<F>>(std::move(f))) == channel_status::ok;
+        }
+
+        // Blocks while the queue is full, but not past `deadline`; false if
+        // the deadline passed first or the pool is shutting down.
+        template <class F, class C, class D>
+            requires std::invocable<F &, std::stop_token>
+        bool submit_until(F f, std::chrono::time_point<C, D> deadline)
+        {
+            return _queue->push(std::make_unique<detail::pool_task_for<F>>(std::move(f)), {},
+                                detail::to_worker_time(deadline)) == channel_status::ok;
+        }
+
+        // Never blocks; false if the queue is full. Safe to call from a task.
+        template <class F>
+            requires std::invocable<F &, std::stop_token>
+        bool try_submit(F f)
+        {
+            return _queue->try_push(std::make_unique<detail::pool_task_for<F>>(std::move(f))) == channel_status::ok;
+        }
+
+        std::size_t size() const noexcept { return _workers.size(); }
+        std::size_t queued() const noexcept { return _queue->size(); }
+
+    private:
+        std::shared_ptr<detail::pool_queue> _queue;
+        detail::worker_clock::duration _grace;
+        virtual_clock *_clock;
+        std::vector<TimedWorker<LogStream>> _workers;
+    };
+
+} // namespace tw
+
+#endif // TW_WORKER_POOL_HPP
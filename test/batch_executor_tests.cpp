@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <tw/batch_executor.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(BatchExecutor, FullBatchRunsAsOne)
+{
+    std::ostringstream sink;
+    tw::batch_options opts;
+    opts.max_batch = 8;
+    opts.linger = 10s;
+    auto ex = tw::make_batch_executor(opts, sink);
+
+    std::atomic_int sum{0};
+    std::vector<tw::batch_ticket> tickets;
+    for (int i = 1; i <= 8; ++i)
+        tickets.push_back(ex.submit([&sum, i](std::stop_token)
+                                    { sum += i; }));
+
+    for (auto &t : tickets)
+        EXPECT_TRUE(t.result().ok());
+    EXPECT_EQ(sum, 36);
+    EXPECT_EQ(ex.stats().tasks, 8u);
+    EXPECT_EQ(ex.stats().batches, 1u);
+}
+
+TEST(BatchExecutor, LingerSealsPartialBatch)
+{
+    std::ostringstream sink;
+    tw::batch_options opts;
+    opts.max_batch = 1000;
+    opts.linger = 2ms;
+    auto ex = tw::make_batch_executor(opts, sink);
+
+    auto t = ex.submit([](std::stop_token) {});
+    EXPECT_TRUE(t.wait_for(1s));
+    EXPECT_TRUE(t.result().ok());
+    EXPECT_EQ(ex.stats().batches, 1u);
+}
+
+TEST(BatchExecutor, ReportsPerTaskOutcomes)
+{
+    std::ostringstream sink;
+    tw::batch_options opts;
+    opts.linger = 10s;
+    auto ex = tw::make_batch_executor(opts, sink);
+
+    auto ok = ex.submit([](std::stop_token) {});
+    auto bad = ex.submit([](std::stop_token)
+                         { throw std::runtime_error("task failed"); });
+    auto also_ok = ex.submit([](std::stop_token) {});
+    ex.flush();
+
+    EXPECT_EQ(ok.result().status(), tw::timed_status::completed);
+    EXPECT_EQ(bad.result().status(), tw::timed_status::failed);
+    EXPECT_THROW(bad.result().value(), std::runtime_error);
+    EXPECT_EQ(also_ok.result().status(), tw::timed_status::completed);
+}
+
+TEST(BatchExecutor, SharedDeadlineTimesOutRemainingTasks)
+{
+    std::ostringstream sink;
+    tw::batch_options opts;
+    opts.linger = 10s;
+    opts.batch_budget = 10ms;
+    opts.shutdown_grace = 1s;
+    auto ex = tw::make_batch_executor(opts, sink);
+
+    auto slow = ex.submit([](std::stop_token st)
+                          {
+        while (!st.stop_requested())
+            std::this_thread::sleep_for(1ms); });
+    auto starved = ex.submit([](std::stop_token) {});
+    ex.flush();
+
+    EXPECT_EQ(slow.result().status(), tw::timed_status::completed);
+    EXPECT_EQ(starved.result().status(), tw::timed_status::timed_out);
+}
+
+TEST(BatchExecutor, DestructionStopsPendingTasks)
+{
+    std::ostringstream sink;
+    std::atomic_bool ran{false};
+    tw::batch_ticket t;
+    {
+        tw::batch_options opts;
+        opts.linger = 10s;
+        auto ex = tw::make_batch_executor(opts, sink);
+        t = ex.submit([&](std::stop_token)
+                      { ran = true; });
+    }
+
+    ASSERT_TRUE(t.ready());
+    EXPECT_EQ(t.result().status(), tw::timed_status::stopped);
+    EXPECT_FALSE(ran);
+}
+
+TEST(BatchExecutor, FlushWithoutOpenBatchIsNoOp)
+{
+    std::ostringstream sink;
+    tw::batch_options opts;
+    opts.max_batch = 4;
+    opts.linger = 10s;
+    auto ex = tw::make_batch_executor(opts, sink);
+
+    ex.flush();
+    std::vector<tw::batch_ticket> tickets;
+    for (int i = 0; i < 4; ++i)
+        tickets.push_back(ex.submit([](std::stop_token) {}));
+
+    for (auto &t : tickets)
+        EXPECT_TRUE(t.result().ok());
+    EXPECT_EQ(ex.stats().batches, 1u);
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <tw/channel.hpp>
+#include <tw/timed_worker.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(Channel, PreservesFifoOrderForOneProducer)
+{
+    tw::channel<int> ch(8);
+    EXPECT_EQ(ch.capacity(), 8u);
+    for (int i = 0; i < 8; ++i)
+        EXPECT_EQ(ch.try_push(i), tw::channel_status::ok);
+    EXPECT_EQ(ch.try_push(8), tw::channel_status::full);
+
+    int v = -1;
+    for (int i = 0; i < 8; ++i)
+    {
+        ASSERT_EQ(ch.try_pop(v), tw::channel_status::ok);
+        EXPECT_EQ(v, i);
+    }
+    EXPECT_EQ(ch.try_pop(v), tw::channel_status::empty);
+}
+
+TEST(Channel, MultipleProducersAndConsumersLoseNothing)
+{
+    tw::channel<long> ch(64);
+    constexpr int producers = 4, consumers = 3, per_producer = 20'000;
+    std::atomic<long> sum{0};
+    std::atomic_int received{0};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+        threads.emplace_back([&, p]
+                             {
+            for (int i = 1; i <= per_producer; ++i)
+                ASSERT_EQ(ch.push(long(p) * per_producer + i), tw::channel_status::ok); });
+    for (int c = 0; c < consumers; ++c)
+        threads.emplace_back([&]
+                             {
+            long v;
+            while (ch.pop(v) == tw::channel_status::ok)
+            {
+                sum += v;
+                ++received;
+            } });
+
+    for (int p = 0; p < producers; ++p)
+        threads[p].join();
+    ch.close();
+    for (std::size_t i = producers; i < threads.size(); ++i)
+        threads[i].join();
+
+    long n = long(producers) * per_producer;
+    EXPECT_EQ(received, n);
+    EXPECT_EQ(sum, n * (n + 1) / 2);
+}
+
+TEST(Channel, PopHonoursDeadline)
+{
+    tw::channel<int> ch(4);
+    int v = 0;
+    auto before = std::chrono::steady_clock::now();
+    EXPECT_EQ(ch.pop(v, {}, 20ms), tw::channel_status::timed_out);
+    auto elapsed = std::chrono::steady_clock::now() - before;
+    EXPECT_GE(elapsed, 20ms);
+    EXPECT_LT(elapsed, 200ms);
+}
+
+TEST(Channel, StopRequestWakesBlockedPush)
+{
+    tw::channel<int> ch(2);
+    ch.try_push(1);
+    ch.try_push(2);
+
+    std::stop_source src;
+    std::thread stopper([&]
+                        {
+        std::this_thread::sleep_for(10ms);
+        src.request_stop(); });
+
+    int three = 3;
+    auto before = std::chrono::steady_clock::now();
+    EXPECT_EQ(ch.push(three, src.get_token()), tw::channel_status::stopped);
+    EXPECT_LT(std::chrono::steady_clock::now() - before, 500ms);
+    EXPECT_EQ(three, 3);
+    stopper.join();
+}
+
+TEST(Channel, CloseDrainsThenReportsClosed)
+{
+    tw::channel<std::unique_ptr<int>> ch(4);
+    ch.push(std::make_unique<int>(1));
+    ch.close();
+
+    EXPECT_EQ(ch.try_push(std::make_unique<int>(2)), tw::channel_status::closed);
+    auto first = ch.pop();
+    ASSERT_TRUE(first);
+    EXPECT_EQ(**first, 1);
+    std::unique_ptr<int> out;
+    EXPECT_EQ(ch.pop(out), tw::channel_status::closed);
+}
+
+TEST(Channel, StalledConsumerCannotHoldWorkerPastBudget)
+{
+    std::ostringstream sink;
+    auto ch = std::make_shared<tw::channel<int>>(4);
+    std::atomic<tw::channel_status> last{tw::channel_status::ok};
+
+    {
+        // nobody ever pops: the producer must give up when its worker stops
+        auto w = tw::make_timed_worker(20ms, 200ms, [ch, &last](std::stop_token st)
+                                       {
+            for (int i = 0;; ++i)
+            {
+                auto s = ch->push(i, st);
+                if (s != tw::channel_status::ok)
+                {
+                    last = s;
+                    return;
+                }
+            } }, sink);
+        for (int i = 0; i < 500 && !w.done(); ++i)
+            std::this_thread::sleep_for(1ms);
+        EXPECT_TRUE(w.done());
+    }
+
+    EXPECT_EQ(last, tw::channel_status::stopped);
+    EXPECT_EQ(ch->size(), 4u);
+    EXPECT_EQ(sink.str().find("FORCED detach"), std::string::npos);
+}
@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include <tw/checkpoint.hpp>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <random>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    // Fresh directory name under the temp dir, unique per run.
+    std::filesystem::path unique_dir(std::string const &prefix)
+    {
+        std::random_device rd;
+        return std::filesystem::temp_directory_path() / (prefix + std::to_string(rd()) + "_" + std::to_string(rd()));
+    }
+
+    struct Progress
+    {
+        int next;
+        long sum;
+    };
+
+    constexpr int items = 400;
+
+    auto summer(std::atomic_bool &started, std::atomic<long> &result)
+    {
+        return [&](std::stop_token st, tw::checkpoint<Progress> &cp)
+        {
+            started = true;
+            auto &s = cp.state();
+            while (!st.stop_requested() && s.next < items)
+            {
+                s.sum += s.next++;
+                std::this_thread::sleep_for(100us);
+            }
+            if (s.next == items)
+            {
+                result = s.sum;
+                cp.complete();
+            }
+        };
+    }
+} // namespace
+
+TEST(Checkpoint, TimedOutJobResumesWhereItStopped)
+{
+    std::ostringstream sink;
+    tw::checkpoint_store store;
+    std::atomic_bool started{false};
+    std::atomic<long> result{-1};
+
+    {
+        auto w = tw::make_checkpointed_worker<Progress>(store, "sum", 10ms, summer(started, result), sink);
+        for (int i = 0; i < 500 && !w.done(); ++i)
+            std::this_thread::sleep_for(1ms);
+    }
+    ASSERT_TRUE(started);
+    auto saved = store.get<Progress>("sum");
+    ASSERT_TRUE(saved);
+    EXPECT_GT(saved->next, 0);
+    EXPECT_LT(saved->next, items);
+    EXPECT_EQ(result, -1);
+
+    std::atomic_bool resumed{false};
+    {
+        auto w = tw::make_checkpointed_worker<Progress>(store, "sum", 5s, [&, inner = summer(started, result)](std::stop_token st, tw::checkpoint<Progress> &cp) mutable
+                                                        {
+            resumed = cp.resumed();
+            inner(st, cp); }, sink);
+        for (int i = 0; i < 2000 && !w.done(); ++i)
+            std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_TRUE(resumed);
+    EXPECT_EQ(result, long(items) * (items - 1) / 2);
+    EXPECT_FALSE(store.get<Progress>("sum"));
+}
+
+TEST(Checkpoint, ProgressIsSavedWhenCallableThrows)
+{
+    std::ostringstream sink;
+    tw::checkpoint_store store;
+    {
+        auto w = tw::make_checkpointed_worker<Progress>(store, "bad", 1s, [](std::stop_token, tw::checkpoint<Progress> &cp)
+                                                        {
+            cp.state().next = 17;
+            throw std::runtime_error("disk full"); }, sink);
+        for (int i = 0; i < 500 && !w.done(); ++i)
+            std::this_thread::sleep_for(1ms);
+    }
+    auto saved = store.get<Progress>("bad");
+    ASSERT_TRUE(saved);
+    EXPECT_EQ(saved->next, 17);
+    EXPECT_NE(sink.str().find("disk full"), std::string::npos);
+}
+
+TEST(Checkpoint, ExplicitSaveIsVisibleWhileRunning)
+{
+    std::ostringstream sink;
+    tw::checkpoint_store store;
+    std::atomic_bool saved{false};
+    auto w = tw::make_checkpointed_worker<Progress>(store, "live", 1s, [&saved](std::stop_token st, tw::checkpoint<Progress> &cp)
+                                                    {
+        cp.state().next = 5;
+        cp.save();
+        saved = true;
+        cp.state().next = 6;
+        while (!st.stop_requested())
+            std::this_thread::sleep_for(1ms); }, sink);
+
+    while (!saved)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_EQ(store.get<Progress>("live")->next, 5);
+    w.request_stop();
+    for (int i = 0; i < 500 && !w.done(); ++i)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_EQ(store.get<Progress>("live")->next, 6);
+}
+
+// file-backed stores persist only where they are mmap'd
+#if defined(TW_CHECKPOINT_MMAP)
+TEST(Checkpoint, FileBackedStoreSurvivesReopen)
+{
+    auto dir = unique_dir("tw_checkpoint_");
+    std::filesystem::remove_all(dir);
+    {
+        tw::checkpoint_store store(dir);
+        store.put("job/1", Progress{3, 30});
+        store.put("job/1", Progress{4, 40});
+    }
+    {
+        tw::checkpoint_store reopened(dir);
+        auto p = reopened.get<Progress>("job/1");
+        ASSERT_TRUE(p);
+        EXPECT_EQ(p->next, 4);
+        EXPECT_EQ(p->sum, 40);
+        EXPECT_FALSE(reopened.get<Progress>("job/2"));
+        reopened.erase("job/1");
+        EXPECT_FALSE(reopened.get<Progress>("job/1"));
+    }
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Checkpoint, LoadWithOtherSizeLeavesCheckpointIntact)
+{
+    auto dir = unique_dir("tw_checkpoint_size_");
+    std::filesystem::remove_all(dir);
+    {
+        tw::checkpoint_store store(dir);
+        store.put("job", Progress{5, 50});
+        EXPECT_FALSE(store.get<int>("job"));
+        auto p = store.get<Progress>("job");
+        ASSERT_TRUE(p);
+        EXPECT_EQ(p->sum, 50);
+    }
+    {
+        tw::checkpoint_store reopened(dir);
+        EXPECT_FALSE(reopened.get<int>("job"));
+        auto p = reopened.get<Progress>("job");
+        ASSERT_TRUE(p);
+        EXPECT_EQ(p->next, 5);
+        EXPECT_EQ(p->sum, 50);
+    }
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Checkpoint, KeysDifferingInEscapedCharactersDoNotShareAFile)
+{
+    auto dir = unique_dir("tw_checkpoint_keys_");
+    std::filesystem::remove_all(dir);
+    {
+        tw::checkpoint_store store(dir);
+        store.put("job/1", Progress{1, 10});
+        store.put("job:1", Progress{2, 20});
+        store.put("job_1", Progress{3, 30});
+        store.put("Job_1", Progress{4, 40});
+        store.erase("job:1");
+    }
+    {
+        tw::checkpoint_store reopened(dir);
+        EXPECT_EQ(reopened.get<Progress>("job/1").value_or(Progress{}).sum, 10);
+        EXPECT_FALSE(reopened.get<Progress>("job:1"));
+        EXPECT_EQ(reopened.get<Progress>("job_1").value_or(Progress{}).sum, 30);
+        EXPECT_EQ(reopened.get<Progress>("Job_1").value_or(Progress{}).sum, 40);
+    }
+    std::filesystem::remove_all(dir);
+}
+#endif
@@ -0,0 +1,328 @@
+#include <gtest/gtest.h>
+#include <tw/batch_executor.hpp>
+#include <tw/scheduled_worker.hpp>
+#include <tw/single_flight.hpp>
+#include <tw/timed_cache.hpp>
+#include <tw/timed_once.hpp>
+#include <tw/timed_worker.hpp>
+#include <tw/timer_service.hpp>
+#include <tw/worker_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <system_error>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    // The budget is process-wide, and threads detached by earlier tests in
+    // this process may never return. Each test therefore runs its body in
+    // a fresh child process, which starts with no detached threads.
+    class DetachBudget : public ::testing::Test
+    {
+    protected:
+        template <class Body>
+        void in_child(Body body)
+        {
+            GTEST_FLAG_SET(death_test_style, "threadsafe");
+            EXPECT_EXIT({
+                body();
+                std::_Exit(::testing::Test::HasFailure() ? 1 : 0); }, ::testing::ExitedWithCode(0), "");
+        }
+
+        // Destroys a worker that ignores stop, leaving one detached thread.
+        void leak_one()
+        {
+            auto started = std::make_shared<std::atomic_bool>(false);
+            auto w = tw::make_timed_worker(1ms, [started, release = release](std::stop_token)
+                                           {
+                *started = true;
+                while (!*release)
+                    std::this_thread::sleep_for(1ms); },
+                                           sink);
+            while (!*started)
+                std::this_thread::sleep_for(1ms);
+        }
+
+        std::ostringstream sink;
+        std::shared_ptr<std::atomic_bool> release = std::make_shared<std::atomic_bool>(false);
+    };
+} // namespace
+
+TEST_F(DetachBudget, CountsDetachedThreadsUntilTheyReturn)
+{
+    in_child([this]
+             {
+        auto before = tw::detach_stats();
+        leak_one();
+        auto after = tw::detach_stats();
+        EXPECT_EQ(after.running, 1u);
+        EXPECT_EQ(after.detached, before.detached + 1);
+        EXPECT_GE(after.peak, 1u);
+
+        *release = true;
+        for (int i = 0; i < 2000 && tw::detach_stats().running != 0; ++i)
+            std::this_thread::sleep_for(1ms);
+        EXPECT_EQ(tw::detach_stats().running, 0u); });
+}
+
+TEST_F(DetachBudget, RejectsOnceCapIsReached)
+{
+    in_child([this]
+             {
+        tw::set_detach_budget({.max_detached = 1});
+        leak_one();
+
+        auto rejected = tw::detach_stats().rejected;
+        try
+        {
+            auto w = tw::make_timed_worker(10ms, [](std::stop_token) {}, sink);
+            FAIL() << "worker was admitted";
+        }
+        catch (std::system_error const &e)
+        {
+            EXPECT_EQ(e.code(), std::errc::resource_unavailable_try_again);
+        }
+        EXPECT_EQ(tw::detach_stats().rejected, rejected + 1);
+        EXPECT_EQ(tw::detach_stats().limit, 1u);
+
+        *release = true;
+        for (int i = 0; i < 2000 && tw::detach_stats().running != 0; ++i)
+            std::this_thread::sleep_for(1ms);
+        EXPECT_NO_THROW(tw::make_timed_worker(10ms, [](std::stop_token) {}, sink)); });
+}
+
+TEST_F(DetachBudget, BlockWaitsForRoomThenGivesUp)
+{
+    in_child([this]
+             {
+        tw::set_detach_budget({.max_detached = 1, .policy = tw::detach_policy::block, .block_timeout = 20ms});
+        leak_one();
+
+        auto t0 = std::chrono::steady_clock::now();
+        EXPECT_THROW(tw::make_timed_worker(10ms, [](std::stop_token) {}, sink), std::system_error);
+        EXPECT_GE(std::chrono::steady_clock::now() - t0, 20ms);
+
+        tw::set_detach_budget({.max_detached = 1, .policy = tw::detach_policy::block, .block_timeout = 2s});
+        auto blocked = tw::detach_stats().blocked;
+        std::jthread releaser([release = release]
+                              {
+            std::this_thread::sleep_for(30ms);
+            *release = true; });
+        EXPECT_NO_THROW(tw::make_timed_worker(10ms, [](std::stop_token) {}, sink));
+        EXPECT_EQ(tw::detach_stats().blocked, blocked + 1); });
+}
+
+TEST_F(DetachBudget, RunInlineUsesCallerThreadWithinRunBudget)
+{
+    in_child([this]
+             {
+        tw::set_detach_budget({.max_detached = 1, .policy = tw::detach_policy::run_inline});
+        leak_one();
+
+        auto inlined = tw::detach_stats().ran_inline;
+        std::thread::id ranOn;
+        bool stopped = false;
+        auto w = tw::make_timed_worker(20ms, 10ms, [&](std::stop_token st)
+                                       {
+            ranOn = std::this_thread::get_id();
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms);
+            stopped = true; },
+                                       sink);
+        EXPECT_TRUE(w.done());
+        EXPECT_TRUE(stopped);
+        EXPECT_EQ(ranOn, std::this_thread::get_id());
+        EXPECT_EQ(tw::detach_stats().ran_inline, inlined + 1);
+
+        // a single-timeout worker is stopped at creation + timeout
+        auto t0 = std::chrono::steady_clock::now();
+        auto plain = tw::make_timed_worker(10ms, [](std::stop_token st)
+                                           {
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms); },
+                                           sink);
+        EXPECT_TRUE(plain.done());
+        EXPECT_LT(std::chrono::steady_clock::now() - t0, 500ms);
+        EXPECT_EQ(tw::detach_stats().ran_inline, inlined + 2);
+
+        // no bound at all: nothing could stop an inline run
+        EXPECT_THROW(tw::make_timed_worker(std::chrono::steady_clock::time_point::max(), 10ms, [](std::stop_token) {}, sink),
+                     std::system_error); });
+}
+
+TEST_F(DetachBudget, SpentBudgetDoesNotRefusePools)
+{
+    in_child([this]
+             {
+        tw::set_detach_budget({.max_detached = 1});
+        leak_one();
+
+        std::atomic_bool ran{false};
+        {
+            tw::worker_pool<std::ostringstream> pool(1, sink);
+            EXPECT_TRUE(pool.submit([&](std::stop_token)
+                                    { ran = true; }));
+            for (int i = 0; i < 2000 && !ran; ++i)
+                std::this_thread::sleep_for(1ms);
+        }
+        EXPECT_TRUE(ran); });
+}
+
+TEST_F(DetachBudget, InlineScheduledStartDoesNotStallTimers)
+{
+    in_child([this]
+             {
+        tw::set_detach_budget({.max_detached = 1, .policy = tw::detach_policy::run_inline});
+        leak_one();
+
+        auto inlined = tw::detach_stats().ran_inline;
+        std::atomic_bool started{false};
+        auto w = tw::make_timed_worker_after(1ms, 300ms, [&](std::stop_token st)
+                                             {
+            started = true;
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms); },
+                                             sink);
+        for (int i = 0; i < 2000 && !started; ++i)
+            std::this_thread::sleep_for(1ms);
+        ASSERT_TRUE(started);
+
+        struct probe : tw::timer_node
+        {
+            probe() noexcept : timer_node(&on_fire) {}
+            static void on_fire(timer_node &n) noexcept
+            {
+                static_cast<probe &>(n).fired = std::chrono::steady_clock::now();
+            }
+            std::atomic<std::chrono::steady_clock::time_point> fired{};
+        } p;
+        auto due = std::chrono::steady_clock::now() + 10ms;
+        tw::timer_service::global().schedule(p, due);
+        for (int i = 0; i < 2000 && p.fired.load() == std::chrono::steady_clock::time_point{}; ++i)
+            std::this_thread::sleep_for(1ms);
+
+        ASSERT_NE(p.fired.load(), std::chrono::steady_clock::time_point{});
+        EXPECT_LT(p.fired.load() - due, 100ms);
+        EXPECT_FALSE(w.done());
+        EXPECT_EQ(tw::detach_stats().ran_inline, inlined + 1); });
+}
+
+TEST_F(DetachBudget, InlineFlightRunsOutsideTheMapLock)
+{
+    in_child([this]
+             {
+        tw::set_detach_budget({.max_detached = 1, .policy = tw::detach_policy::run_inline});
+        leak_one();
+
+        tw::single_flight<int, int, std::ostringstream> sf(sink);
+        // the computation re-enters the same single_flight for another key
+        auto r = sf.run(1, 200ms, 1s, [&](std::stop_token)
+                        { return 1 + sf.run(2, 200ms, 1s, [](std::stop_token)
+                                            { return 41; })
+                                         .value_or(0); });
+        ASSERT_TRUE(r.ok());
+        EXPECT_EQ(*r, 42);
+        EXPECT_EQ(sf.in_flight(), 0u); });
+}
+
+TEST_F(DetachBudget, InlineRefreshRunsOutsideTheCacheLock)
+{
+    in_child([this]
+             {
+        tw::set_detach_budget({.max_detached = 1, .policy = tw::detach_policy::run_inline});
+        leak_one();
+
+        tw::timed_cache<int, int, std::ostringstream> cache({.ttl = 1ms, .stale_for = 10s}, sink);
+        ASSERT_EQ(*cache.get(1, 200ms, [](std::stop_token)
+                             { return 1; }),
+                  1);
+        std::this_thread::sleep_for(5ms);
+
+        // the stale-while-revalidate refresh runs inline and re-enters the cache
+        std::optional<int> seen;
+        auto r = cache.get(1, 200ms, [&](std::stop_token)
+                           {
+            seen = cache.peek(1);
+            return 2; });
+        EXPECT_EQ(*r, 1);
+        EXPECT_EQ(seen, 1);
+        EXPECT_EQ(cache.peek(1), 1);
+        EXPECT_EQ(*cache.get(1, 200ms, [](std::stop_token)
+                             { return 3; }),
+                  2); });
+}
+
+TEST_F(DetachBudget, InlineInitializerRunsOutsideTheOnceLock)
+{
+    in_child([this]
+             {
+        tw::set_detach_budget({.max_detached = 1, .policy = tw::detach_policy::run_inline});
+        leak_one();
+
+        tw::timed_once<int, std::ostringstream> once({}, sink);
+        unsigned seen = 0;
+        auto r = once.get(200ms, 1s, [&](std::stop_token)
+                          {
+            seen = once.attempts();
+            return 7; });
+        ASSERT_TRUE(r.ok());
+        EXPECT_EQ(r->get(), 7);
+        EXPECT_EQ(seen, 1u);
+        EXPECT_TRUE(once.ready()); });
+}
+
+TEST_F(DetachBudget, RejectedRefreshServesStaleValue)
+{
+    in_child([this]
+             {
+        tw::set_detach_budget({.max_detached = 1});
+        tw::timed_cache<int, int, std::ostringstream> cache({.ttl = 1ms, .stale_for = 10s}, sink);
+        ASSERT_EQ(*cache.get(1, 200ms, [](std::stop_token)
+                             { return 1; }),
+                  1);
+        leak_one();
+        std::this_thread::sleep_for(5ms);
+
+        auto failed = cache.stats().failed_refreshes;
+        auto r = cache.get(1, 200ms, [](std::stop_token)
+                           { return 2; });
+        ASSERT_TRUE(r.ok());
+        EXPECT_EQ(*r, 1);
+        EXPECT_EQ(cache.stats().failed_refreshes, failed + 1);
+
+        // a miss has no stale value to fall back on
+        EXPECT_THROW(cache.get(2, 200ms, [](std::stop_token)
+                               { return 2; }),
+                     std::system_error); });
+}
+
+TEST_F(DetachBudget, RejectedBatchReportsItsTasksOnce)
+{
+    in_child([this]
+             {
+        tw::set_detach_budget({.max_detached = 1});
+        leak_one();
+
+        std::atomic_int ran{0};
+        {
+            auto ex = tw::make_batch_executor({.linger = 1s, .batch_budget = 1s}, sink);
+            auto a = ex.submit([&](std::stop_token)
+                               { ++ran; });
+            auto b = ex.submit([&](std::stop_token)
+                               { ++ran; });
+            ex.flush();
+
+            EXPECT_EQ(a.result().status(), tw::timed_status::stopped);
+            EXPECT_EQ(b.result().status(), tw::timed_status::stopped);
+        }
+        EXPECT_EQ(ran, 0);
+        // the collector has logged by the time the executor is gone
+        EXPECT_NE(sink.str().find("failed to start batch worker"), std::string::npos); });
+}
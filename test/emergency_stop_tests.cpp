@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <tw/timed_worker.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+// emergency_stop_all() is process-wide and cannot be undone, so each test
+// runs in its own child process.
+
+namespace
+{
+    extern "C" void on_sigterm(int) { tw::emergency_stop_all(); }
+
+    int stop_cooperative_workers_from_handler()
+    {
+        std::ostringstream sink;
+        std::atomic_int running{0};
+        std::vector<tw::TimedWorker<std::ostringstream>> ws;
+        for (int i = 0; i < 3; ++i)
+            ws.push_back(tw::make_timed_worker(10s, [&](std::stop_token st)
+                                               {
+                ++running;
+                while (!st.stop_requested())
+                    std::this_thread::sleep_for(1ms); },
+                                               sink));
+        for (int i = 0; i < 1000 && running.load() < 3; ++i)
+            std::this_thread::sleep_for(1ms);
+
+        std::signal(SIGTERM, on_sigterm);
+        std::raise(SIGTERM);
+
+        auto rep = tw::wait_emergency_stop(std::chrono::steady_clock::now() + 5s);
+        if (!rep || rep->workers != 3 || rep->finished != 3 || !tw::emergency_stop_requested())
+            return 1;
+        for (auto &w : ws)
+            if (!w.done())
+                return 2;
+        return 0;
+    }
+
+    int bound_shutdown_of_stuck_worker()
+    {
+        std::ostringstream sink;
+        static std::atomic_bool started{false}, release{false};
+        tw::set_emergency_deadline(20ms);
+        auto start = std::chrono::steady_clock::now();
+        {
+            auto w = tw::make_timed_worker(10s, [](std::stop_token)
+                                           {
+                started = true;
+                while (!release.load())
+                    std::this_thread::sleep_for(1ms); },
+                                           sink);
+            for (int i = 0; i < 1000 && !started.load(); ++i)
+                std::this_thread::sleep_for(1ms);
+            tw::emergency_stop_all();
+            auto rep = tw::wait_emergency_stop(start + 5s);
+            if (!rep || rep->workers != 1 || rep->finished != 0)
+                return 1;
+        }
+        // the destructor detached instead of waiting out its 10s grace
+        if (std::chrono::steady_clock::now() - start > 2s)
+            return 2;
+        return 0;
+    }
+} // namespace
+
+TEST(EmergencyStop, SignalHandlerStopsEveryWorker)
+{
+    GTEST_FLAG_SET(death_test_style, "threadsafe");
+    EXPECT_EXIT(std::_Exit(stop_cooperative_workers_from_handler()), ::testing::ExitedWithCode(0), "");
+}
+
+TEST(EmergencyStop, StuckWorkerIsGivenUpAfterDeadline)
+{
+    GTEST_FLAG_SET(death_test_style, "threadsafe");
+    EXPECT_EXIT(std::_Exit(bound_shutdown_of_stuck_worker()), ::testing::ExitedWithCode(0), "");
+}
+
+TEST(EmergencyStop, WaitTimesOutWithoutEmergency)
+{
+    std::ostringstream sink;
+    auto w = tw::make_timed_worker(50ms, [](std::stop_token) {}, sink);
+    EXPECT_FALSE(tw::emergency_stop_requested());
+    EXPECT_FALSE(tw::wait_emergency_stop(std::chrono::steady_clock::now() + 5ms));
+}
+
+TEST(EmergencyStop, RegistryReusesFreedSlots)
+{
+    auto &reg = tw::detail::worker_registry::global();
+    std::vector<tw::detail::worker_entry> entries(200);
+    std::vector<tw::detail::worker_registry::slot *> first;
+    for (auto &e : entries)
+        first.push_back(reg.enroll(&e));
+    for (std::size_t i = 0; i < first.size(); ++i)
+        for (std::size_t j = i + 1; j < first.size(); ++j)
+            ASSERT_NE(first[i], first[j]);
+
+    // a freed slot is found again without growing the registry
+    tw::detail::worker_registry::leave(first[150]);
+    auto *again = reg.enroll(&entries[150]);
+    EXPECT_EQ(again, first[150]);
+    first[150] = again;
+
+    for (auto *s : first)
+        tw::detail::worker_registry::leave(s);
+}
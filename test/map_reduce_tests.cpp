@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+#include <tw/map_reduce.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(MapReduce, ReducesEverythingWithinBudget)
+{
+    std::ostringstream sink;
+    tw::worker_pool<std::ostringstream> pool(4, sink);
+    std::vector<int> in(100'000);
+    std::iota(in.begin(), in.end(), 1);
+
+    auto r = tw::map_reduce(pool, in, 0L, [](std::stop_token, int x)
+                            { return long(x); }, [](long a, long b)
+                            { return a + b; }, 1s);
+    EXPECT_TRUE(r.complete());
+    EXPECT_EQ(r.mapped, in.size());
+    EXPECT_DOUBLE_EQ(r.coverage(), 1.0);
+    EXPECT_EQ(r.value, 100'000L * 100'001 / 2);
+}
+
+TEST(MapReduce, ReturnsPartialReductionAtDeadline)
+{
+    std::ostringstream sink;
+    tw::worker_pool<std::ostringstream> pool(2, sink);
+    // borrowed inputs must outlive the map calls still in flight at the
+    // deadline; map owns them here
+    auto in = std::make_shared<std::vector<int>>(2'000, 1);
+
+    auto before = std::chrono::steady_clock::now();
+    auto r = tw::map_reduce(pool, *in, 0, [in](std::stop_token, int x)
+                            {
+        std::this_thread::sleep_for(1ms);
+        return x; }, [](int a, int b)
+                            { return a + b; }, 30ms, 200);
+    auto elapsed = std::chrono::steady_clock::now() - before;
+
+    EXPECT_LT(elapsed, 150ms);
+    EXPECT_FALSE(r.complete());
+    EXPECT_GT(r.coverage(), 0.0);
+    EXPECT_LT(r.coverage(), 1.0);
+    EXPECT_EQ(std::size_t(r.value), r.mapped);
+}
+
+TEST(MapReduce, MergeKeepsInputOrder)
+{
+    std::ostringstream sink;
+    tw::worker_pool<std::ostringstream> pool(3, sink);
+    std::string in = "the quick brown fox jumps over the lazy dog";
+
+    auto r = tw::map_reduce(pool, in, std::string{}, [](std::stop_token, char c)
+                            { return std::string(1, c); }, [](std::string a, std::string b)
+                            { return a + b; }, 1s, 7);
+    EXPECT_TRUE(r.complete());
+    EXPECT_EQ(r.value, in);
+}
+
+TEST(MapReduce, MapFailureKeepsOtherChunks)
+{
+    std::ostringstream sink;
+    tw::worker_pool<std::ostringstream> pool(2, sink);
+    std::vector<int> in(100, 1);
+    in[10] = -1;
+
+    auto r = tw::map_reduce(pool, in, 0, [](std::stop_token, int x)
+                            {
+        if (x < 0)
+            throw std::invalid_argument("negative");
+        return x; }, [](int a, int b)
+                            { return a + b; }, 1s, 4);
+    EXPECT_FALSE(r.complete());
+    ASSERT_TRUE(r.error);
+    EXPECT_THROW(std::rethrow_exception(r.error), std::invalid_argument);
+    // chunk 0 covers [0, 25) and stops at index 10
+    EXPECT_EQ(r.mapped, 85u);
+    EXPECT_EQ(r.value, 85);
+}
+
+TEST(MapReduce, ReduceFailureKeepsLastGoodAccumulator)
+{
+    std::ostringstream sink;
+    tw::worker_pool<std::ostringstream> pool(1, sink);
+    std::string in = "abc!de";
+
+    auto r = tw::map_reduce(pool, in, std::string{}, [](std::stop_token, char c)
+                            { return std::string(1, c); }, [](std::string a, std::string b)
+                            {
+        if (b == "!")
+            throw std::invalid_argument("bang");
+        return a + b; }, 1s, 1);
+    ASSERT_TRUE(r.error);
+    EXPECT_EQ(r.value, "abc");
+    EXPECT_EQ(r.mapped, 3u);
+}
+
+TEST(MapReduce, ValuesMappedAfterStopAreDiscarded)
+{
+    std::ostringstream sink;
+    auto pool = std::make_unique<tw::worker_pool<std::ostringstream>>(1, sink);
+    auto calls = std::make_shared<std::atomic_int>(0);
+
+    // the pool shuts down mid-chunk; map returns junk once stopped
+    std::thread stopper([&]
+                        {
+        while (*calls < 10)
+            std::this_thread::sleep_for(1ms);
+        pool.reset(); });
+    auto r = tw::map_reduce(*pool, std::vector<int>(10'000, 1), 0, [calls](std::stop_token st, int x)
+                            {
+        ++*calls;
+        std::this_thread::sleep_for(1ms);
+        return st.stop_requested() ? 1'000 : x; }, [](int a, int b)
+                            { return a + b; }, 30s, 1);
+    stopper.join();
+
+    EXPECT_FALSE(r.complete());
+    EXPECT_GE(r.mapped, 9u);
+    EXPECT_EQ(std::size_t(r.value), r.mapped);
+}
+
+TEST(MapReduce, ReturnsAtDeadlineWhileChunksAreStillMapping)
+{
+    std::ostringstream sink;
+    tw::worker_pool<std::ostringstream> pool(2, sink);
+
+    // map ignores its token; the chunks own the inputs, which are an rvalue
+    auto before = std::chrono::steady_clock::now();
+    auto r = tw::map_reduce(pool, std::vector<int>(4, 1), 0, [](std::stop_token, int x)
+                            {
+        std::this_thread::sleep_for(300ms);
+        return x; }, [](int a, int b)
+                            { return a + b; }, 20ms, 2);
+    auto elapsed = std::chrono::steady_clock::now() - before;
+
+    EXPECT_LT(elapsed, 200ms);
+    EXPECT_EQ(r.mapped, 0u);
+    EXPECT_EQ(r.total, 4u);
+    EXPECT_EQ(r.value, 0);
+}
+
+TEST(MapReduce, FullPoolQueueDoesNotBlockPastDeadline)
+{
+    std::ostringstream sink;
+    tw::worker_pool<std::ostringstream> pool(1, sink, 10ms, 2);
+    auto started = std::make_shared<std::atomic_bool>(false);
+    pool.submit([started](std::stop_token st)
+                {
+        *started = true;
+        while (!st.stop_requested())
+            std::this_thread::sleep_for(1ms); });
+    while (!*started)
+        std::this_thread::sleep_for(1ms);
+    while (pool.try_submit([](std::stop_token) {}))
+    {
+    }
+
+    std::vector<int> in(1000, 1);
+    auto t0 = std::chrono::steady_clock::now();
+    auto r = tw::map_reduce(pool, std::move(in), 0, [](std::stop_token, int x)
+                            { return x; }, [](int a, int b)
+                            { return a + b; }, 30ms, 4);
+    auto elapsed = std::chrono::steady_clock::now() - t0;
+
+    EXPECT_LT(elapsed, 500ms);
+    EXPECT_FALSE(r.complete());
+    EXPECT_EQ(r.mapped, 0u);
+    EXPECT_EQ(r.value, 0);
+}
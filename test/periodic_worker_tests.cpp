@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <tw/periodic_worker.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST(PeriodicWorker, RunsOnAbsoluteSchedule)
+{
+    std::ostringstream sink;
+    std::atomic_int calls{0};
+    tw::periodic_stats s;
+    {
+        auto w = tw::make_periodic_worker(5ms, 1s, [&](std::stop_token)
+                                          { ++calls; }, sink);
+        for (int i = 0; i < 2000 && w.stats().runs < 10; ++i)
+            std::this_thread::sleep_for(1ms);
+        s = w.stats();
+    }
+
+    EXPECT_GE(s.runs, 10u);
+    // a run may be in progress when the stats are taken
+    EXPECT_LE(static_cast<std::uint64_t>(calls.load()) - s.runs, 1u);
+    EXPECT_EQ(s.timed_out_runs, 0u);
+    EXPECT_LE(s.min_jitter, s.mean_jitter);
+    EXPECT_LE(s.mean_jitter, s.max_jitter);
+}
+
+TEST(PeriodicWorker, PerRunTimeoutStopsTheRun)
+{
+    std::ostringstream sink;
+    tw::periodic_stats s;
+    {
+        auto w = tw::make_periodic_worker(20ms, 5ms, [](std::stop_token st)
+                                          {
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms); }, sink);
+        for (int i = 0; i < 2000 && w.stats().timed_out_runs < 2; ++i)
+            std::this_thread::sleep_for(1ms);
+        s = w.stats();
+    }
+
+    EXPECT_GE(s.runs, 2u);
+    EXPECT_GE(s.timed_out_runs, 2u);
+}
+
+TEST(PeriodicWorker, OverrunCountsMissedTicks)
+{
+    std::ostringstream sink;
+    tw::periodic_stats s;
+    {
+        auto w = tw::make_periodic_worker(5ms, 1s, [](std::stop_token)
+                                          { std::this_thread::sleep_for(12ms); }, sink);
+        for (int i = 0; i < 2000 && w.stats().runs < 2; ++i)
+            std::this_thread::sleep_for(1ms);
+        s = w.stats();
+    }
+
+    EXPECT_GE(s.runs, 2u);
+    EXPECT_GE(s.missed_ticks, s.runs - 1);
+}
+
+TEST(PeriodicWorker, ForwardsArgumentsAndLogsExceptions)
+{
+    std::ostringstream sink;
+    std::atomic_int sum{0};
+    {
+        // the run timeout is also the destructor's grace: keep it long
+        // enough that the worker is never detached while `sink` is in use
+        auto w = tw::make_periodic_worker(2ms, 1s, [&](std::stop_token, int step)
+                                          {
+            sum += step;
+            throw std::runtime_error("tick failed"); }, sink, 3);
+        for (int i = 0; i < 2000 && w.stats().failed_runs == 0; ++i)
+            std::this_thread::sleep_for(1ms);
+        EXPECT_GE(w.stats().failed_runs, 1u);
+    }
+
+    EXPECT_GT(sum.load(), 0);
+    EXPECT_EQ(sum.load() % 3, 0);
+    EXPECT_NE(sink.str().find("tick failed"), std::string::npos);
+}
+
+TEST(PeriodicWorker, DestructionInterruptsLongPeriod)
+{
+    std::ostringstream sink;
+    std::chrono::steady_clock::time_point start;
+    {
+        auto w = tw::make_periodic_worker(10s, 1s, [](std::stop_token) {}, sink);
+        for (int i = 0; i < 1000 && w.stats().runs == 0; ++i)
+            std::this_thread::sleep_for(1ms);
+        EXPECT_EQ(w.stats().runs, 1u);
+        start = std::chrono::steady_clock::now();
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+}
+
+TEST(PeriodicWorker, DestructionIsBoundedForUncooperativeRuns)
+{
+    std::ostringstream sink;
+    auto release = std::make_shared<std::atomic_bool>(false);
+    auto start = std::chrono::steady_clock::now();
+    {
+        auto w = tw::make_periodic_worker(1ms, 20ms, [release](std::stop_token)
+                                          {
+            while (!release->load())
+                std::this_thread::sleep_for(1ms); }, sink);
+        std::this_thread::sleep_for(5ms);
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 500ms);
+    release->store(true);
+}
+
+TEST(PeriodicWorker, MovedHandleKeepsTheSchedule)
+{
+    std::ostringstream sink;
+    std::atomic_int runs{0};
+    auto w = tw::make_periodic_worker(std::chrono::duration<double, std::milli>(2), 1s, [&](std::stop_token)
+                                      { ++runs; }, sink);
+    auto moved = std::move(w);
+    std::this_thread::sleep_for(20ms);
+    EXPECT_GE(moved.stats().runs, 2u);
+    moved.request_stop();
+    auto until = std::chrono::steady_clock::now() + 1s;
+    while (!moved.done() && std::chrono::steady_clock::now() < until)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_TRUE(moved.done());
+}
@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+#include <tw/pipeline.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST(Pipeline, ChainsStagesOfDifferentTypes)
+{
+    std::ostringstream sink;
+    auto p = tw::make_pipeline<int>(sink)
+                 .stage("double", {.workers = 2}, [](std::stop_token, int x)
+                        { return x * 2; })
+                 .stage("format", {}, [](std::stop_token, int x)
+                        { return std::to_string(x); })
+                 .build();
+    EXPECT_EQ(p.stages(), 2u);
+
+    for (int i = 0; i < 100; ++i)
+        ASSERT_EQ(p.push(i, 1s), tw::channel_status::ok);
+    p.close();
+
+    long sum = 0;
+    int n = 0;
+    std::string s;
+    while (p.pop(s, {}, 1s) == tw::channel_status::ok)
+    {
+        sum += std::stol(s);
+        ++n;
+    }
+    EXPECT_EQ(n, 100);
+    EXPECT_EQ(sum, 2 * 99 * 100 / 2);
+
+    auto m = p.metrics();
+    ASSERT_EQ(m.size(), 2u);
+    EXPECT_EQ(m[0].name, "double");
+    EXPECT_EQ(m[0].processed, 100u);
+    EXPECT_EQ(m[1].processed, 100u);
+    EXPECT_EQ(m[0].dropped() + m[1].dropped(), 0u);
+}
+
+TEST(Pipeline, StageBudgetDropsSlowItems)
+{
+    std::ostringstream sink;
+    auto p = tw::make_pipeline<int>(sink)
+                 .stage("slow-odd", {.budget = 5ms}, [](std::stop_token st, int x)
+                        {
+            if (x % 2)
+                while (!st.stop_requested())
+                    std::this_thread::sleep_for(1ms);
+            return x; })
+                 .build();
+
+    for (int i = 0; i < 6; ++i)
+        p.push(i, 1s);
+    p.close();
+
+    int v, n = 0;
+    while (p.pop(v, {}, 1s) == tw::channel_status::ok)
+    {
+        EXPECT_EQ(v % 2, 0);
+        ++n;
+    }
+    EXPECT_EQ(n, 3);
+
+    auto m = p.metrics()[0];
+    EXPECT_EQ(m.timed_out, 3u);
+    EXPECT_EQ(m.processed, 3u);
+    EXPECT_GE(m.service_max, 5ms);
+}
+
+TEST(Pipeline, EndToEndDeadlineDropsExpiredItems)
+{
+    std::ostringstream sink;
+    auto p = tw::make_pipeline<int>(sink)
+                 .stage("wait", {.budget = 1s}, [](std::stop_token, int x)
+                        {
+            std::this_thread::sleep_for(15ms);
+            return x; })
+                 .stage("pass", {}, [](std::stop_token, int x)
+                        { return x; })
+                 .build();
+
+    // both are queued behind the first; the second expires before service
+    p.push(1, 1s);
+    p.push(2, 5ms);
+    p.close();
+
+    int v, n = 0;
+    while (p.pop(v, {}, 1s) == tw::channel_status::ok)
+    {
+        EXPECT_EQ(v, 1);
+        ++n;
+    }
+    EXPECT_EQ(n, 1);
+    EXPECT_EQ(p.metrics()[0].expired, 1u);
+}
+
+TEST(Pipeline, ServiceMeanCountsItemsThatExpireInService)
+{
+    std::ostringstream sink;
+    auto p = tw::make_pipeline<int>(sink)
+                 .stage("wait", {.budget = 1s}, [](std::stop_token st, int x)
+                        {
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms);
+            return x; })
+                 .build();
+
+    // served, then dropped when its end-to-end deadline stops it
+    p.push(1, 10ms);
+    p.close();
+
+    int v;
+    EXPECT_EQ(p.pop(v, {}, 1s), tw::channel_status::closed);
+    auto m = p.metrics()[0];
+    EXPECT_EQ(m.expired, 1u);
+    EXPECT_EQ(m.serviced, 1u);
+    EXPECT_EQ(m.service_mean(), m.service_total);
+    EXPECT_GT(m.service_mean(), 0ns);
+}
+
+TEST(Pipeline, BackpressureRejectsInputPastDeadline)
+{
+    std::ostringstream sink;
+    std::atomic_bool release{false};
+    auto p = tw::make_pipeline<int>(sink)
+                 .stage("stuck", {.queue = 2, .budget = 10s}, [&release](std::stop_token st, int x)
+                        {
+            while (!release && !st.stop_requested())
+                std::this_thread::sleep_for(1ms);
+            return x; })
+                 .build(2);
+
+    // one item in service plus a full input queue
+    int admitted = 0;
+    for (int i = 0; i < 3; ++i)
+        admitted += p.push(i, 1s) == tw::channel_status::ok;
+    EXPECT_EQ(admitted, 3);
+
+    auto before = std::chrono::steady_clock::now();
+    EXPECT_EQ(p.push(99, 20ms), tw::channel_status::timed_out);
+    auto elapsed = std::chrono::steady_clock::now() - before;
+    EXPECT_GE(elapsed, 20ms);
+    EXPECT_LT(elapsed, 300ms);
+    EXPECT_EQ(p.metrics()[0].queue_depth, 2u);
+
+    release = true;
+}
+
+TEST(Pipeline, FailuresAreCountedAndDoNotStopTheStage)
+{
+    std::ostringstream sink;
+    auto p = tw::make_pipeline<int>(sink)
+                 .stage("picky", {}, [](std::stop_token, int x)
+                        {
+            if (x == 3)
+                throw std::runtime_error("bad item");
+            return x; })
+                 .build();
+
+    for (int i = 0; i < 5; ++i)
+        p.push(i, 1s);
+    p.close();
+
+    int v, n = 0;
+    while (p.pop(v, {}, 1s) == tw::channel_status::ok)
+        ++n;
+    EXPECT_EQ(n, 4);
+    EXPECT_EQ(p.metrics()[0].failed, 1u);
+}
+
+TEST(Pipeline, DestructionWaitsOneGraceForAllWorkers)
+{
+    std::ostringstream sink;
+    auto release = std::make_shared<std::atomic_bool>(false);
+    auto busy = std::make_shared<std::atomic_int>(0);
+    std::optional p(tw::make_pipeline<int>(sink)
+                        .stage("stuck", {.workers = 4, .budget = 10s, .shutdown_grace = 50ms}, [release, busy](std::stop_token, int x)
+                               {
+            ++*busy;
+            while (!*release)
+                std::this_thread::sleep_for(1ms);
+            return x; })
+                        .build());
+    for (int i = 0; i < 4; ++i)
+        ASSERT_EQ(p->push(i, 10s), tw::channel_status::ok);
+    for (int i = 0; i < 2000 && *busy < 4; ++i)
+        std::this_thread::sleep_for(1ms);
+    ASSERT_EQ(*busy, 4);
+
+    auto t0 = std::chrono::steady_clock::now();
+    p.reset();
+    auto elapsed = std::chrono::steady_clock::now() - t0;
+    *release = true;
+
+    // one grace for the four stuck workers, not one each
+    EXPECT_GE(elapsed, 50ms);
+    EXPECT_LT(elapsed, 150ms);
+}
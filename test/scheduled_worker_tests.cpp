@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <tw/scheduled_worker.hpp>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(ScheduledWorker, StartsAtScheduledTime)
+{
+    std::ostringstream sink;
+    std::atomic<std::chrono::steady_clock::time_point> ran_at{};
+    auto scheduled = std::chrono::steady_clock::now() + 20ms;
+
+    auto w = tw::make_timed_worker_at(scheduled, 1s, [&](std::stop_token)
+                                      { ran_at = std::chrono::steady_clock::now(); }, sink);
+    std::this_thread::sleep_for(5ms);
+    // a loaded machine may oversleep past the start; it must not be earlier
+    bool started = w.started();
+    EXPECT_TRUE(!started || std::chrono::steady_clock::now() >= scheduled);
+
+    for (int i = 0; i < 200 && !w.done(); ++i)
+        std::this_thread::sleep_for(1ms);
+
+    ASSERT_TRUE(w.done());
+    EXPECT_GE(ran_at.load(), scheduled);
+}
+
+TEST(ScheduledWorker, CancelBeforeStartNeverRuns)
+{
+    std::ostringstream sink;
+    std::atomic_bool ran{false};
+    {
+        auto w = tw::make_timed_worker_after(20ms, 1s, [&](std::stop_token)
+                                             { ran = true; }, sink);
+        EXPECT_TRUE(w.cancel());
+        EXPECT_TRUE(w.cancelled());
+        std::this_thread::sleep_for(40ms);
+        EXPECT_FALSE(w.started());
+        EXPECT_EQ(w.worker(), nullptr);
+    }
+    EXPECT_FALSE(ran);
+}
+
+TEST(ScheduledWorker, ForwardsArguments)
+{
+    std::ostringstream sink;
+    std::atomic_int got{0};
+    auto w = tw::make_timed_worker_after(1ms, 1s, [&](std::stop_token, int a, int b)
+                                         { got = a * b; }, sink, 6, 7);
+    for (int i = 0; i < 200 && !w.done(); ++i)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_EQ(got.load(), 42);
+}
+
+TEST(ScheduledWorker, ThousandsPendingCostNoThreads)
+{
+    std::ostringstream sink;
+    constexpr int N = 5000;
+    std::atomic_int ran{0};
+    auto before = tw::timer_service::global().pending();
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::vector<tw::ScheduledTimedWorker<std::ostringstream>> ws;
+        ws.reserve(N);
+        for (int i = 0; i < N; ++i)
+            ws.push_back(tw::make_timed_worker_after(10s, 1s, [&](std::stop_token)
+                                                     { ++ran; }, sink));
+        EXPECT_GE(tw::timer_service::global().pending(), before + N);
+        // handles are destroyed (cancelled) here without ever creating a thread
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 2s);
+    EXPECT_EQ(ran.load(), 0);
+    // cancelling took the entries out rather than leaving them for 10s
+    EXPECT_LT(tw::timer_service::global().pending(), before + N);
+}
+
+TEST(ScheduledWorker, StartedWorkerStopsOnDestruction)
+{
+    std::ostringstream sink;
+    std::atomic_bool running{false};
+    std::atomic_bool saw_stop{false};
+    {
+        auto w = tw::make_timed_worker_after(1ms, 1s, [&](std::stop_token st)
+                                             {
+            running = true;
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms);
+            saw_stop = true; }, sink);
+        for (int i = 0; i < 200 && !running; ++i)
+            std::this_thread::sleep_for(1ms);
+        EXPECT_TRUE(w.started());
+        EXPECT_TRUE(running);
+    }
+    EXPECT_TRUE(saw_stop);
+}
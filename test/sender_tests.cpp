@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include <tw/sender.hpp>
+#include <chrono>
+#include <future>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST(InplaceStopSource, RunsAndUnregistersCallbacks)
+{
+    tw::inplace_stop_source src;
+    int hits = 0;
+    {
+        tw::inplace_stop_callback<std::function<void()>> gone(src.get_token(), [&]
+                                                               { hits += 100; });
+    }
+    tw::inplace_stop_callback<std::function<void()>> cb(src.get_token(), [&]
+                                                        { ++hits; });
+    EXPECT_TRUE(src.request_stop());
+    EXPECT_FALSE(src.request_stop());
+    EXPECT_EQ(hits, 1);
+
+    // registering after the fact runs the callback immediately
+    tw::inplace_stop_callback<std::function<void()>> late(src.get_token(), [&]
+                                                          { ++hits; });
+    EXPECT_EQ(hits, 2);
+}
+
+TEST(Sender, JustThenSyncWait)
+{
+    auto r = tw::sync_wait(tw::just(20) | tw::then([](int x)
+                                                   { return x + 22; }));
+    ASSERT_TRUE(r.ok());
+    EXPECT_EQ(*r, 42);
+}
+
+TEST(Sender, ThenExceptionBecomesFailed)
+{
+    auto r = tw::sync_wait(tw::then(tw::just(), []() -> int
+                                    { throw std::runtime_error("bad"); }));
+    EXPECT_EQ(r.status(), tw::timed_status::failed);
+    EXPECT_THROW(r.value(), std::runtime_error);
+}
+
+TEST(Sender, ScheduleAfterRunsOffTheCallingThread)
+{
+    tw::timed_scheduler sch;
+    auto r = tw::sync_wait(sch.schedule_after(2ms) | tw::then([]
+                                                              { return std::this_thread::get_id(); }));
+    ASSERT_TRUE(r.ok());
+    EXPECT_NE(*r, std::this_thread::get_id());
+}
+
+TEST(Sender, BlockingCompletionDoesNotStallTimers)
+{
+    tw::timed_scheduler sch;
+    auto block = tw::then([]
+                          { std::this_thread::sleep_for(300ms); });
+    auto slow = std::async(std::launch::async, [&]
+                           { return tw::sync_wait(sch.schedule_after(1ms) | block); });
+    std::this_thread::sleep_for(20ms);
+
+    auto t0 = std::chrono::steady_clock::now();
+    auto r = tw::sync_wait(sch.schedule_after(10ms));
+    EXPECT_LT(std::chrono::steady_clock::now() - t0, 200ms);
+    EXPECT_TRUE(r.ok());
+    EXPECT_TRUE(slow.get().ok());
+}
+
+TEST(Sender, WithTimeoutPassesValueThrough)
+{
+    auto r = tw::sync_wait(tw::with_timeout(tw::just(7), 1s));
+    ASSERT_TRUE(r.ok());
+    EXPECT_EQ(*r, 7);
+
+    // saturates instead of overflowing into the past
+    auto huge = tw::sync_wait(tw::with_timeout(tw::just(8), std::chrono::hours::max()));
+    ASSERT_TRUE(huge.ok());
+    EXPECT_EQ(*huge, 8);
+    tw::timed_scheduler sch;
+    EXPECT_TRUE(tw::sync_wait(sch.timed(sch.schedule_after(1ms), std::chrono::hours::max())).ok());
+}
+
+TEST(Sender, WithTimeoutCancelsSlowSender)
+{
+    tw::timed_scheduler sch;
+    auto start = std::chrono::steady_clock::now();
+    auto r = tw::sync_wait(sch.schedule_after(10s) | tw::with_timeout(20ms));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(r.status(), tw::timed_status::timed_out);
+    EXPECT_GE(elapsed, 20ms);
+    EXPECT_LT(elapsed, 1s);
+}
+
+TEST(Sender, PipelineComposesTimeouts)
+{
+    tw::timed_scheduler sch(500ms);
+    auto r = tw::sync_wait(sch.timed(sch.schedule_after(1ms) | tw::then([]
+                                                                        { return 5; }) |
+                                     tw::with_timeout(1s)));
+    ASSERT_TRUE(r.ok());
+    EXPECT_EQ(*r, 5);
+}
+
+TEST(Sender, EmergencyStopCancelsScheduledWork)
+{
+    tw::timed_scheduler sch(10s);
+    auto fut = std::async(std::launch::async, [&]
+                          { return tw::sync_wait(sch.timed(sch.schedule_after(10s))).status(); });
+
+    std::this_thread::sleep_for(10ms);
+    sch.emergency_stop();
+
+    ASSERT_EQ(fut.wait_for(1s), std::future_status::ready);
+    EXPECT_EQ(fut.get(), tw::timed_status::stopped);
+
+    // already stopped: new work completes immediately
+    EXPECT_EQ(tw::sync_wait(sch.timed(sch.schedule_after(10s))).status(), tw::timed_status::stopped);
+}
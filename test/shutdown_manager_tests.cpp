@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <tw/shutdown_manager.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    enum tier
+    {
+        ingest,
+        processing,
+        flush
+    };
+}
+
+TEST(ShutdownManager, StopsTiersInOrder)
+{
+    std::ostringstream sink;
+    std::atomic_int seq{0}, running{0};
+    int stoppedAt[3] = {-1, -1, -1};
+
+    tw::shutdown_manager<std::ostringstream> mgr(1s);
+    for (int t : {flush, ingest, processing})
+        mgr.add(t, tw::make_timed_worker(10s, 1s, [&, t](std::stop_token st)
+                                         {
+            ++running;
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms);
+            stoppedAt[t] = seq++; },
+                                         sink));
+    EXPECT_EQ(mgr.size(), 3u);
+    for (int i = 0; i < 1000 && running < 3; ++i)
+        std::this_thread::sleep_for(1ms);
+
+    auto rep = mgr.shutdown();
+    EXPECT_TRUE(rep.clean());
+    ASSERT_EQ(rep.tiers.size(), 3u);
+    EXPECT_EQ(rep.tiers[0].tier, ingest);
+    EXPECT_EQ(rep.tiers[2].tier, flush);
+    EXPECT_EQ(stoppedAt[ingest], 0);
+    EXPECT_EQ(stoppedAt[processing], 1);
+    EXPECT_EQ(stoppedAt[flush], 2);
+    EXPECT_TRUE(mgr.shut_down());
+    EXPECT_EQ(mgr.size(), 0u);
+}
+
+TEST(ShutdownManager, JoinsTierInParallel)
+{
+    std::ostringstream sink;
+    tw::shutdown_manager<std::ostringstream> mgr(2s);
+    for (int i = 0; i < 4; ++i)
+        mgr.add(processing, tw::make_timed_worker(10s, 1s, [](std::stop_token st)
+                                                  {
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms);
+            std::this_thread::sleep_for(40ms); },
+                                                  sink));
+
+    auto rep = mgr.shutdown();
+    EXPECT_EQ(rep.finished(), 4u);
+    EXPECT_LT(rep.elapsed, 120ms);
+}
+
+TEST(ShutdownManager, StuckTierDoesNotStarveLaterTiers)
+{
+    std::ostringstream sink;
+    auto release = std::make_shared<std::atomic_bool>(false);
+    std::atomic_bool started{false}, flushed{false};
+
+    tw::shutdown_manager<std::ostringstream> mgr(100ms);
+    mgr.add(ingest, tw::make_timed_worker(10s, 10s, [release](std::stop_token)
+                                          {
+        while (!*release)
+            std::this_thread::sleep_for(1ms); },
+                                          sink));
+    mgr.add(flush, tw::make_timed_worker(10s, 10s, [&](std::stop_token st)
+                                         {
+        started = true;
+        while (!st.stop_requested())
+            std::this_thread::sleep_for(1ms);
+        flushed = true; },
+                                         sink));
+    for (int i = 0; i < 1000 && !started; ++i)
+        std::this_thread::sleep_for(1ms);
+
+    auto rep = mgr.shutdown();
+    *release = true;
+    ASSERT_EQ(rep.tiers.size(), 2u);
+    EXPECT_EQ(rep.tiers[0].finished, 0u);
+    EXPECT_EQ(rep.tiers[1].finished, 1u);
+    EXPECT_TRUE(flushed);
+    EXPECT_FALSE(rep.clean());
+    EXPECT_LT(rep.elapsed, 300ms);
+}
+
+TEST(ShutdownManager, DestructorShutsDownAndLateWorkersStop)
+{
+    std::ostringstream sink;
+    std::atomic_bool started{false}, stopped{false};
+    {
+        tw::shutdown_manager<std::ostringstream> mgr;
+        mgr.add(ingest, tw::make_timed_worker(10s, 1s, [&](std::stop_token st)
+                                              {
+            started = true;
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms);
+            stopped = true; },
+                                              sink));
+        for (int i = 0; i < 1000 && !started; ++i)
+            std::this_thread::sleep_for(1ms);
+        EXPECT_EQ(mgr.shutdown().workers(), 1u);
+        EXPECT_EQ(mgr.shutdown().workers(), 1u);
+
+        auto t0 = std::chrono::steady_clock::now();
+        mgr.add(flush, tw::make_timed_worker(10s, 1s, [](std::stop_token st)
+                                             {
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms); },
+                                             sink));
+        EXPECT_LT(std::chrono::steady_clock::now() - t0, 500ms);
+        EXPECT_EQ(mgr.size(), 0u);
+    }
+    EXPECT_TRUE(stopped);
+}
+
+TEST(ShutdownManager, WorkersMayCallIntoManagerWhileStopping)
+{
+    std::ostringstream sink;
+    tw::shutdown_manager<std::ostringstream> mgr(10s);
+    std::atomic_bool started{false}, sawShutdown{false};
+    mgr.add(ingest, tw::make_timed_worker(10s, 1s, [&](std::stop_token st)
+                                          {
+        started = true;
+        while (!st.stop_requested())
+            std::this_thread::sleep_for(1ms);
+        sawShutdown = mgr.shut_down() && mgr.size() == 0; },
+                                          sink));
+    for (int i = 0; i < 1000 && !started; ++i)
+        std::this_thread::sleep_for(1ms);
+
+    auto t0 = std::chrono::steady_clock::now();
+    auto r = mgr.shutdown();
+    EXPECT_LT(std::chrono::steady_clock::now() - t0, 1s);
+    EXPECT_TRUE(r.clean());
+    EXPECT_TRUE(sawShutdown);
+}
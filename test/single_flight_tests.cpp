@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <tw/single_flight.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(SingleFlight, ConcurrentCallersShareOneComputation)
+{
+    std::ostringstream sink;
+    tw::single_flight<std::string, int, std::ostringstream> sf(sink);
+    std::atomic_int computations{0};
+    std::atomic_int ok{0};
+
+    std::vector<std::thread> callers;
+    for (int i = 0; i < 10; ++i)
+    {
+        callers.emplace_back([&]
+                             {
+            auto r = sf.run("answer", 1s, 2s, [&](std::stop_token)
+                            {
+                ++computations;
+                std::this_thread::sleep_for(50ms);
+                return 42; });
+            if (r.ok() && *r == 42)
+                ++ok; });
+    }
+    for (auto &t : callers)
+        t.join();
+
+    EXPECT_EQ(ok, 10);
+    EXPECT_LT(computations, 10);
+    EXPECT_EQ(sf.in_flight(), 0u);
+}
+
+TEST(SingleFlight, DifferentKeysRunIndependently)
+{
+    std::ostringstream sink;
+    tw::single_flight<int, int, std::ostringstream> sf(sink);
+
+    auto a = sf.run(1, 1s, 1s, [](std::stop_token)
+                    { return 1; });
+    auto b = sf.run(2, 1s, 1s, [](std::stop_token)
+                    { return 2; });
+
+    EXPECT_EQ(a.value(), 1);
+    EXPECT_EQ(b.value(), 2);
+}
+
+TEST(SingleFlight, ImpatientCallerDoesNotStopSharedWork)
+{
+    std::ostringstream sink;
+    tw::single_flight<int, int, std::ostringstream> sf(sink);
+    std::atomic_bool saw_stop{false};
+
+    std::thread patient([&]
+                        {
+        auto r = sf.run(7, 1s, 1s, [&](std::stop_token st)
+                        {
+            std::this_thread::sleep_for(50ms);
+            saw_stop = st.stop_requested();
+            return 7; });
+        EXPECT_TRUE(r.ok());
+        EXPECT_EQ(r.value_or(0), 7); });
+
+    std::this_thread::sleep_for(10ms);
+    auto r = sf.run(7, 1s, 5ms, [](std::stop_token)
+                    { return -1; });
+    EXPECT_EQ(r.status(), tw::timed_status::timed_out);
+
+    patient.join();
+    EXPECT_FALSE(saw_stop);
+}
+
+TEST(SingleFlight, LastCallerLeavingStopsComputation)
+{
+    std::ostringstream sink;
+    std::atomic_bool stopped{false};
+    {
+        tw::single_flight<int, int, std::ostringstream> sf(sink, 1s);
+        auto r = sf.run(1, 10s, 10ms, [&](std::stop_token st)
+                        {
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms);
+            stopped = true;
+            return 0; });
+        EXPECT_EQ(r.status(), tw::timed_status::timed_out);
+        EXPECT_EQ(sf.in_flight(), 0u);
+
+        for (int i = 0; i < 500 && !stopped; ++i)
+            std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_TRUE(stopped);
+    EXPECT_EQ(sink.str().find("FORCED detach"), std::string::npos);
+}
+
+TEST(SingleFlight, BudgetExpiryIsReportedWithFallback)
+{
+    std::ostringstream sink;
+    tw::single_flight<int, int, std::ostringstream> sf(sink);
+
+    // long enough for the worker thread to start before the budget ends
+    auto r = sf.run(1, 100ms, 1s, [](std::stop_token st)
+                    {
+        while (!st.stop_requested())
+            std::this_thread::sleep_for(1ms);
+        return -1; });
+
+    EXPECT_EQ(r.status(), tw::timed_status::timed_out);
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(*r, -1);
+}
+
+TEST(SingleFlight, DestructionWaitsOneGraceForAllComputations)
+{
+    std::ostringstream sink;
+    auto release = std::make_shared<std::atomic_bool>(false);
+    auto busy = std::make_shared<std::atomic_int>(0);
+    auto sf = std::make_unique<tw::single_flight<int, int, std::ostringstream>>(sink, 50ms);
+    for (int key = 0; key < 4; ++key)
+    {
+        // the caller gives up, leaving an abandoned computation behind
+        auto r = sf->run(key, 10s, 20ms, [release, busy](std::stop_token)
+                         {
+            ++*busy;
+            while (!*release)
+                std::this_thread::sleep_for(1ms);
+            return 0; });
+        EXPECT_EQ(r.status(), tw::timed_status::timed_out);
+    }
+    ASSERT_EQ(*busy, 4);
+
+    auto t0 = std::chrono::steady_clock::now();
+    sf.reset();
+    auto elapsed = std::chrono::steady_clock::now() - t0;
+    *release = true;
+
+    // one grace for the four stuck computations, not one each
+    EXPECT_GE(elapsed, 50ms);
+    EXPECT_LT(elapsed, 150ms);
+}
@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include <tw/slice_scheduler.hpp>
+#include <tw/virtual_clock.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    // Burns `slices` full quanta, yielding between them.
+    auto burner(int slices)
+    {
+        return [left = slices](std::stop_token const &) mutable
+        {
+            while (!tw::this_worker::yield_point())
+            {
+            }
+            return --left > 0 ? tw::slice::yield : tw::slice::done;
+        };
+    }
+} // namespace
+
+TEST(SliceScheduler, ManyTasksShareFewThreads)
+{
+    std::ostringstream sink;
+    tw::slice_scheduler<std::ostringstream> sched({.threads = 2, .quantum = 200us}, sink);
+
+    std::vector<tw::slice_handle> tasks;
+    for (int i = 0; i < 20; ++i)
+        tasks.push_back(sched.spawn(burner(3), 5s));
+    for (auto &t : tasks)
+    {
+        EXPECT_TRUE(t.result().ok());
+        EXPECT_EQ(t.slices(), 3u);
+    }
+}
+
+TEST(SliceScheduler, ShortTaskIsNotStuckBehindLongOnes)
+{
+    std::ostringstream sink;
+    tw::slice_scheduler<std::ostringstream> sched({.threads = 1, .quantum = 1ms}, sink);
+
+    auto a = sched.spawn(burner(60), 5s);
+    auto b = sched.spawn(burner(60), 5s);
+    auto before = std::chrono::steady_clock::now();
+    auto quick = sched.spawn([](std::stop_token const &)
+                             { return tw::slice::done; }, 5s);
+
+    EXPECT_TRUE(quick.result().ok());
+    EXPECT_LT(std::chrono::steady_clock::now() - before, 30ms);
+    EXPECT_FALSE(a.done());
+    EXPECT_FALSE(b.done());
+    EXPECT_TRUE(a.result().ok());
+    EXPECT_TRUE(b.result().ok());
+}
+
+TEST(SliceScheduler, GlobalDeadlineEndsEndlessTask)
+{
+    std::ostringstream sink;
+    tw::slice_scheduler<std::ostringstream> sched({.threads = 1, .quantum = 1ms}, sink);
+
+    auto before = std::chrono::steady_clock::now();
+    auto t = sched.spawn([](std::stop_token const &)
+                         {
+        while (!tw::this_worker::yield_point())
+        {
+        }
+        return tw::slice::yield; }, 20ms);
+    EXPECT_EQ(t.result().status(), tw::timed_status::timed_out);
+    auto elapsed = std::chrono::steady_clock::now() - before;
+    EXPECT_GE(elapsed, 20ms);
+    EXPECT_LT(elapsed, 100ms);
+}
+
+TEST(SliceScheduler, DeadlineStopsBlockedSlice)
+{
+    std::ostringstream sink;
+    tw::slice_scheduler<std::ostringstream> sched({.threads = 1}, sink);
+
+    auto before = std::chrono::steady_clock::now();
+    auto t = sched.spawn([](std::stop_token const &)
+                         {
+        tw::this_worker::sleep_for(1h);
+        return tw::slice::done; }, 20ms);
+    EXPECT_EQ(t.result().status(), tw::timed_status::timed_out);
+    EXPECT_LT(std::chrono::steady_clock::now() - before, 1s);
+}
+
+TEST(SliceScheduler, DestructionWakesBlockedSlice)
+{
+    std::ostringstream sink;
+    std::atomic_bool started{false};
+    tw::slice_handle t;
+    auto sched = std::make_unique<tw::slice_scheduler<std::ostringstream>>(
+        tw::slice_options{.threads = 1, .shutdown_grace = 5s}, sink);
+    t = sched->spawn([&](std::stop_token const &)
+                     {
+        started = true;
+        tw::this_worker::sleep_for(1h);
+        return tw::slice::done; },
+                     10s);
+    while (!started)
+        std::this_thread::sleep_for(100us);
+
+    auto t0 = std::chrono::steady_clock::now();
+    sched.reset();
+    EXPECT_LT(std::chrono::steady_clock::now() - t0, 1s);
+    EXPECT_EQ(t.result().status(), tw::timed_status::stopped);
+    EXPECT_EQ(sink.str().find("FORCED detach"), std::string::npos);
+}
+
+TEST(SliceScheduler, DeadlineFollowsVirtualClock)
+{
+    std::ostringstream sink;
+    tw::virtual_clock clk;
+    tw::clock_scope use(clk);
+    tw::slice_scheduler<std::ostringstream> sched({.threads = 1, .quantum = 200us}, sink);
+
+    auto t = sched.spawn(burner(1'000'000'000), 1h);
+    EXPECT_FALSE(t.wait_until(std::chrono::steady_clock::now() + 20ms));
+    clk.advance(1h);
+    EXPECT_EQ(t.result().status(), tw::timed_status::timed_out);
+}
+
+TEST(SliceScheduler, StopAndFailureAreReported)
+{
+    std::ostringstream sink;
+    tw::slice_scheduler<std::ostringstream> sched({.threads = 2}, sink);
+
+    auto stopped = sched.spawn(burner(1'000'000), 5s);
+    auto failed = sched.spawn([](std::stop_token const &) -> tw::slice
+                              { throw std::runtime_error("bad slice"); }, 5s);
+    std::this_thread::sleep_for(5ms);
+    stopped.request_stop();
+
+    EXPECT_EQ(stopped.result().status(), tw::timed_status::stopped);
+    EXPECT_EQ(failed.result().status(), tw::timed_status::failed);
+    EXPECT_THROW(failed.result().value(), std::runtime_error);
+}
+
+TEST(SliceScheduler, PendingTasksStopWithScheduler)
+{
+    std::ostringstream sink;
+    tw::slice_handle t;
+    {
+        tw::slice_scheduler<std::ostringstream> sched({.threads = 1, .quantum = 1ms}, sink);
+        t = sched.spawn(burner(1'000'000), 5s);
+    }
+    EXPECT_EQ(t.result().status(), tw::timed_status::stopped);
+    EXPECT_FALSE(tw::this_worker::yield_point());
+}
+
+TEST(SliceScheduler, DestructionWaitsOneGraceForAllWorkers)
+{
+    std::ostringstream sink;
+    auto release = std::make_shared<std::atomic_bool>(false);
+    auto busy = std::make_shared<std::atomic_int>(0);
+    auto sched = std::make_unique<tw::slice_scheduler<std::ostringstream>>(
+        tw::slice_options{.threads = 4, .shutdown_grace = 50ms}, sink);
+    for (int i = 0; i < 4; ++i)
+        (void)sched->spawn([release, busy](std::stop_token const &)
+                           {
+            ++*busy;
+            while (!*release)
+                std::this_thread::sleep_for(1ms);
+            return tw::slice::done; },
+                           10s);
+    for (int i = 0; i < 2000 && *busy < 4; ++i)
+        std::this_thread::sleep_for(1ms);
+    ASSERT_EQ(*busy, 4);
+
+    auto t0 = std::chrono::steady_clock::now();
+    sched.reset();
+    auto elapsed = std::chrono::steady_clock::now() - t0;
+    *release = true;
+
+    // one grace for the four stuck workers, not one each
+    EXPECT_GE(elapsed, 50ms);
+    EXPECT_LT(elapsed, 150ms);
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <tw/streaming_worker.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(StreamingWorker, ConsumesItemsWhileProducerRuns)
+{
+    std::ostringstream sink;
+    auto w = tw::make_streaming_timed_worker<int>(1s, 8, [](std::stop_token, tw::stream_producer<int> &out, int n)
+                                                  {
+        for (int i = 0; i < n; ++i)
+            ASSERT_TRUE(out.push(i)); }, sink, 10'000);
+
+    long sum = 0;
+    int expected = 0;
+    bool ordered = true;
+    for (int v : w)
+    {
+        ordered = ordered && v == expected++;
+        sum += v;
+    }
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(expected, 10'000);
+    EXPECT_EQ(sum, 10'000L * 9'999 / 2);
+    EXPECT_TRUE(w.finished());
+}
+
+TEST(StreamingWorker, KeepsPartialResultsOnTimeout)
+{
+    std::ostringstream sink;
+    auto w = tw::make_streaming_timed_worker<std::string>(20ms, 64, [](std::stop_token st, tw::stream_producer<std::string> &out)
+                                                          {
+        // the items go out before the wait, so the budget only bounds it
+        for (int i = 0; i < 3; ++i)
+            out.push("item" + std::to_string(i));
+        while (!st.stop_requested())
+            std::this_thread::sleep_for(1ms); }, sink);
+
+    for (int i = 0; i < 500 && !w.finished(); ++i)
+        std::this_thread::sleep_for(1ms);
+    ASSERT_TRUE(w.finished());
+
+    auto items = w.drain();
+    ASSERT_EQ(items.size(), 3u);
+    EXPECT_EQ(items.front(), "item0");
+    EXPECT_EQ(items.back(), "item2");
+    EXPECT_FALSE(w.next());
+}
+
+TEST(StreamingWorker, BackpressureBlocksOnlyUntilDeadline)
+{
+    std::ostringstream sink;
+    auto pushed = std::make_shared<std::atomic_int>(0);
+    auto rejected = std::make_shared<std::atomic_bool>(false);
+
+    auto w = tw::make_streaming_timed_worker<int>(30ms, 4, [pushed, rejected](std::stop_token, tw::stream_producer<int> &out)
+                                                  {
+        // ignores its stop token; push must still give up at the deadline
+        for (int i = 0; i < 100; ++i)
+        {
+            if (!out.push(i))
+            {
+                *rejected = true;
+                return;
+            }
+            ++*pushed;
+        } }, sink);
+
+    auto before = std::chrono::steady_clock::now();
+    for (int i = 0; i < 500 && !w.finished(); ++i)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_TRUE(w.finished());
+    EXPECT_LT(std::chrono::steady_clock::now() - before, 300ms);
+    EXPECT_TRUE(*rejected);
+    EXPECT_EQ(*pushed, 4);
+    EXPECT_EQ(w.buffered(), 4u);
+}
+
+TEST(StreamingWorker, StopWakesBlockedProducer)
+{
+    std::ostringstream sink;
+    std::atomic_bool blocked{false};
+    auto w = tw::make_streaming_timed_worker<int>(10s, 2, [&blocked](std::stop_token, tw::stream_producer<int> &out)
+                                                  {
+        out.push(1);
+        out.push(2);
+        blocked = true;
+        out.push(3); }, sink);
+
+    while (!blocked)
+        std::this_thread::sleep_for(1ms);
+    auto before = std::chrono::steady_clock::now();
+    w.request_stop();
+    for (int i = 0; i < 500 && !w.finished(); ++i)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_TRUE(w.finished());
+    EXPECT_LT(std::chrono::steady_clock::now() - before, 300ms);
+    EXPECT_EQ(w.drain(), (std::vector<int>{1, 2}));
+}
+
+TEST(StreamingWorker, NextForReturnsEmptyWhenNothingArrives)
+{
+    std::ostringstream sink;
+    std::atomic_bool release{false};
+    auto w = tw::make_streaming_timed_worker<int>(1s, 4, [&release](std::stop_token st, tw::stream_producer<int> &out)
+                                                  {
+        while (!release && !st.stop_requested())
+            std::this_thread::sleep_for(1ms);
+        out.push(7); }, sink);
+
+    auto before = std::chrono::steady_clock::now();
+    EXPECT_FALSE(w.next_for(10ms));
+    EXPECT_GE(std::chrono::steady_clock::now() - before, 10ms);
+
+    release = true;
+    auto v = w.next_for(1s);
+    ASSERT_TRUE(v);
+    EXPECT_EQ(*v, 7);
+}
+
+TEST(StreamingWorker, RangeEndsWhenProducerOverrunsDeadlineAndGrace)
+{
+    std::ostringstream sink;
+    auto release = std::make_shared<std::atomic_bool>(false);
+    // the deadline counts from creation, which may itself take a while
+    auto start = std::chrono::steady_clock::now();
+    auto w = tw::make_streaming_timed_worker<int>(20ms, 8, [release](std::stop_token, tw::stream_producer<int> &out)
+                                                  {
+        out.push(1);
+        while (!*release)
+            std::this_thread::sleep_for(1ms); }, sink);
+
+    std::vector<int> got;
+    for (int v : w)
+        got.push_back(v);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(got, std::vector<int>{1});
+    EXPECT_GE(elapsed, 30ms);
+    EXPECT_LT(elapsed, 1s);
+    EXPECT_TRUE(w.timed_out());
+    EXPECT_FALSE(w.finished());
+    release->store(true);
+}
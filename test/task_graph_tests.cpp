@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <tw/task_graph.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(TaskGraph, DiamondRunsInOrderWithParallelBranches)
+{
+    std::ostringstream sink;
+    tw::worker_pool<std::ostringstream> pool(2, sink);
+    tw::task_graph g(pool);
+
+    std::mutex mtx;
+    std::vector<char> order;
+    auto step = [&](char c, std::chrono::milliseconds d)
+    {
+        return [&, c, d](std::stop_token)
+        {
+            std::this_thread::sleep_for(d);
+            std::lock_guard lk(mtx);
+            order.push_back(c);
+        };
+    };
+    auto a = g.add(step('a', 0ms));
+    auto b = g.add(step('b', 30ms));
+    auto c = g.add(step('c', 30ms));
+    auto d = g.add(step('d', 0ms));
+    g.depends(b, a);
+    g.depends(c, a);
+    g.depends(d, b);
+    g.depends(d, c);
+
+    auto before = std::chrono::steady_clock::now();
+    auto r = g.run(1s);
+    auto elapsed = std::chrono::steady_clock::now() - before;
+
+    EXPECT_TRUE(r.ok());
+    ASSERT_EQ(order.size(), 4u);
+    EXPECT_EQ(order.front(), 'a');
+    EXPECT_EQ(order.back(), 'd');
+    EXPECT_LT(elapsed, 55ms);
+}
+
+TEST(TaskGraph, FailureCancelsOnlyDownstream)
+{
+    std::ostringstream sink;
+    tw::worker_pool<std::ostringstream> pool(2, sink);
+    tw::task_graph g(pool);
+    std::atomic_bool downstreamRan{false};
+
+    auto bad = g.add([](std::stop_token)
+                     { throw std::runtime_error("boom"); });
+    auto after = g.add([&](std::stop_token)
+                       { downstreamRan = true; });
+    auto after2 = g.add([&](std::stop_token)
+                        { downstreamRan = true; });
+    auto other = g.add([](std::stop_token) {});
+    g.depends(after, bad);
+    g.depends(after2, after);
+
+    auto r = g.run(1s);
+    EXPECT_EQ(r[bad].status(), tw::timed_status::failed);
+    EXPECT_THROW(r[bad].value(), std::runtime_error);
+    EXPECT_EQ(r[after].status(), tw::timed_status::stopped);
+    EXPECT_EQ(r[after2].status(), tw::timed_status::stopped);
+    EXPECT_TRUE(r[other].ok());
+    EXPECT_FALSE(downstreamRan);
+}
+
+TEST(TaskGraph, TimeoutStopsNodeAndCancelsDownstream)
+{
+    std::ostringstream sink;
+    tw::worker_pool<std::ostringstream> pool(2, sink);
+    tw::task_graph g(pool);
+
+    auto slow = g.add([](std::stop_token st)
+                      {
+        while (!st.stop_requested())
+            std::this_thread::sleep_for(1ms); });
+    auto next = g.add([](std::stop_token) {});
+    g.depends(next, slow);
+
+    auto before = std::chrono::steady_clock::now();
+    auto r = g.run(20ms);
+    EXPECT_LT(std::chrono::steady_clock::now() - before, 200ms);
+    EXPECT_EQ(r[slow].status(), tw::timed_status::timed_out);
+    EXPECT_EQ(r[next].status(), tw::timed_status::stopped);
+    EXPECT_EQ(r.count(tw::timed_status::completed), 0u);
+}
+
+TEST(TaskGraph, FullPoolQueueDoesNotBlockPastDeadline)
+{
+    std::ostringstream sink;
+    tw::worker_pool<std::ostringstream> pool(1, sink, 10ms, 1);
+    std::atomic_bool release{false}, busy{false};
+    pool.submit([&](std::stop_token)
+                {
+        busy = true;
+        while (!release)
+            std::this_thread::sleep_for(1ms); });
+    while (!busy)
+        std::this_thread::sleep_for(1ms);
+    while (pool.try_submit([](std::stop_token) {}))
+        ;
+
+    tw::task_graph g(pool);
+    auto root = g.add([](std::stop_token) {});
+    auto next = g.add([](std::stop_token) {});
+    g.depends(next, root);
+
+    auto before = std::chrono::steady_clock::now();
+    auto r = g.run(20ms);
+    EXPECT_LT(std::chrono::steady_clock::now() - before, 500ms);
+    EXPECT_EQ(r[root].status(), tw::timed_status::timed_out);
+    EXPECT_EQ(r[next].status(), tw::timed_status::stopped);
+    release = true;
+}
+
+TEST(TaskGraph, DeadlinesFollowCriticalPath)
+{
+    std::ostringstream sink;
+    tw::worker_pool<std::ostringstream> pool(2, sink);
+    tw::task_graph g(pool);
+
+    // a(1) -> b(3) is the critical path; c(1) is independent
+    auto a = g.add([](std::stop_token) {}, 1.0);
+    auto b = g.add([](std::stop_token) {}, 3.0);
+    auto c = g.add([](std::stop_token) {}, 1.0);
+    g.depends(b, a);
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + 400ms;
+    auto r = g.run(deadline);
+    EXPECT_TRUE(r.ok());
+
+    EXPECT_EQ(r.deadline(b), deadline);
+    EXPECT_EQ(r.deadline(c), deadline);
+    // a gets a quarter of the budget
+    EXPECT_GE(r.deadline(a), start + 95ms);
+    EXPECT_LE(r.deadline(a), start + 130ms);
+}
+
+TEST(TaskGraph, RejectsCycles)
+{
+    std::ostringstream sink;
+    tw::worker_pool<std::ostringstream> pool(1, sink);
+    tw::task_graph g(pool);
+    auto a = g.add([](std::stop_token) {});
+    auto b = g.add([](std::stop_token) {});
+    auto c = g.add([](std::stop_token) {});
+    g.depends(b, a);
+    g.depends(c, b);
+    EXPECT_THROW(g.depends(a, c), std::invalid_argument);
+    EXPECT_THROW(g.depends(a, a), std::invalid_argument);
+    EXPECT_THROW(g.depends(a, 7), std::invalid_argument);
+}
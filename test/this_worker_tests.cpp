@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <tw/task_graph.hpp>
+#include <tw/this_worker.hpp>
+#include <tw/virtual_clock.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+TEST(ThisWorker, SleepForWakesOnStop)
+{
+    std::ostringstream sink;
+    std::atomic_bool started{false}, slept{true};
+    std::atomic<Clock::rep> woke{0};
+    auto w = tw::make_timed_worker(5s, [&](std::stop_token)
+                                   {
+        started = true;
+        slept = tw::this_worker::sleep_for(1h);
+        woke = Clock::now().time_since_epoch().count(); },
+                                   sink);
+    while (!started)
+        std::this_thread::sleep_for(100us);
+    std::this_thread::sleep_for(1ms);
+
+    auto t0 = Clock::now();
+    w.request_stop();
+    ASSERT_TRUE(w.wait_until(t0 + 2s));
+    EXPECT_FALSE(slept);
+    EXPECT_LT(Clock::time_point(Clock::duration(woke.load())) - t0, 100ms);
+}
+
+TEST(ThisWorker, SleepForOutsideWorkerSleepsFully)
+{
+    auto t0 = Clock::now();
+    EXPECT_TRUE(tw::this_worker::sleep_for(2ms));
+    EXPECT_GE(Clock::now() - t0, 2ms);
+}
+
+TEST(ThisWorker, SleepForWakesOnWorkItemDeadline)
+{
+    std::ostringstream sink;
+    tw::worker_pool<std::ostringstream> pool(1, sink);
+    tw::task_graph g(pool);
+    std::atomic_bool slept{true};
+    auto n = g.add([&](std::stop_token)
+                   { slept = tw::this_worker::sleep_for(1h); });
+
+    auto t0 = Clock::now();
+    auto r = g.run(20ms);
+    EXPECT_EQ(r[n].status(), tw::timed_status::timed_out);
+    EXPECT_FALSE(slept);
+    EXPECT_LT(Clock::now() - t0, 1s);
+}
+
+TEST(ThisWorker, SleepForFollowsVirtualClock)
+{
+    tw::virtual_clock clock;
+    std::atomic_bool done{false};
+    std::thread t([&]
+                  {
+        tw::clock_scope scope(clock);
+        tw::this_worker::sleep_for(1h);
+        done = true; });
+    clock.block_until_waiters(1);
+    EXPECT_FALSE(done);
+    clock.advance(1h);
+    t.join();
+    EXPECT_TRUE(done);
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <tw/timed_cache.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    tw::cache_options opts(std::size_t capacity, std::chrono::nanoseconds ttl, std::chrono::nanoseconds stale_for)
+    {
+        tw::cache_options o;
+        o.capacity = capacity;
+        o.ttl = ttl;
+        o.stale_for = stale_for;
+        return o;
+    }
+} // namespace
+
+TEST(TimedCache, RepeatedCallsAreLookups)
+{
+    std::ostringstream sink;
+    tw::timed_cache<std::string, int, std::ostringstream> cache(opts(16, 10s, 0s), sink);
+    std::atomic_int computed{0};
+    auto compute = [&](std::stop_token)
+    {
+        ++computed;
+        return 7;
+    };
+
+    EXPECT_EQ(cache.get("k", 100ms, compute).value(), 7);
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(cache.get("k", 100ms, compute).value(), 7);
+
+    EXPECT_EQ(computed, 1);
+    EXPECT_EQ(cache.stats().hits, 10u);
+    EXPECT_EQ(cache.stats().misses, 1u);
+}
+
+TEST(TimedCache, StaleValueServedWhileRefreshing)
+{
+    std::ostringstream sink;
+    tw::timed_cache<int, int, std::ostringstream> cache(opts(16, 5ms, 10s), sink);
+    std::atomic_int version{0};
+    auto compute = [&](std::stop_token)
+    { return ++version; };
+
+    EXPECT_EQ(cache.get(1, 100ms, compute).value(), 1);
+    std::this_thread::sleep_for(10ms);
+
+    // expired: old value right away, refresh in the background
+    EXPECT_EQ(cache.get(1, 100ms, compute).value(), 1);
+    for (int i = 0; i < 200 && cache.peek(1) != 2; ++i)
+    {
+        std::this_thread::sleep_for(1ms);
+        cache.get(1, 100ms, compute);
+    }
+    EXPECT_EQ(cache.peek(1), 2);
+    EXPECT_GE(cache.stats().stale_hits, 1u);
+}
+
+TEST(TimedCache, InvalidateDropsRefreshInFlight)
+{
+    std::ostringstream sink;
+    tw::timed_cache<int, int, std::ostringstream> cache(opts(16, 5ms, 10s), sink);
+    EXPECT_EQ(cache.get(1, 100ms, [](std::stop_token)
+                        { return 1; })
+                  .value(),
+              1);
+    std::this_thread::sleep_for(10ms);
+
+    std::atomic_bool started{false};
+    std::atomic_bool stopped{false};
+    EXPECT_EQ(cache.get(1, 1s, [&](std::stop_token st)
+                        {
+        started = true;
+        while (!st.stop_requested())
+            std::this_thread::sleep_for(1ms);
+        stopped = true;
+        return 2; })
+                  .value(),
+              1);
+    for (int i = 0; i < 1000 && !started; ++i)
+        std::this_thread::sleep_for(1ms);
+
+    cache.invalidate(1);
+    EXPECT_TRUE(stopped);
+    EXPECT_EQ(cache.peek(1), std::nullopt);
+    EXPECT_EQ(cache.size(), 0u);
+
+    // the next call computes afresh instead of joining the dropped refresh
+    EXPECT_EQ(cache.get(1, 100ms, [](std::stop_token)
+                        { return 3; })
+                  .value(),
+              3);
+}
+
+TEST(TimedCache, TimedOutRefreshKeepsStaleValue)
+{
+    std::ostringstream sink;
+    tw::timed_cache<int, int, std::ostringstream> cache(opts(16, 1ms, 0s), sink);
+
+    EXPECT_EQ(cache.get(1, 100ms, [](std::stop_token)
+                       { return 1; })
+                  .value(),
+              1);
+    std::this_thread::sleep_for(5ms);
+
+    auto r = cache.get(1, 10ms, [](std::stop_token st)
+                       {
+        while (!st.stop_requested())
+            std::this_thread::sleep_for(1ms);
+        return -1; });
+    EXPECT_EQ(r.status(), tw::timed_status::timed_out);
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(*r, 1);
+    EXPECT_EQ(cache.peek(1), 1);
+}
+
+TEST(TimedCache, HungComputationIsAbandoned)
+{
+    std::ostringstream sink;
+    auto o = opts(16, 1s, 0s);
+    o.shutdown_grace = 5ms;
+    tw::timed_cache<int, int, std::ostringstream> cache(o, sink);
+    auto release = std::make_shared<std::atomic_bool>(false);
+
+    auto hung = cache.get(1, 10ms, [release](std::stop_token)
+                          {
+        // ignores its stop token
+        while (!*release)
+            std::this_thread::sleep_for(1ms);
+        return -1; });
+    EXPECT_EQ(hung.status(), tw::timed_status::timed_out);
+    std::this_thread::sleep_for(10ms);
+
+    // past budget + grace: a new computation starts for the key
+    auto r = cache.get(1, 1s, [](std::stop_token)
+                       { return 2; });
+    EXPECT_EQ(r.value(), 2);
+    EXPECT_EQ(cache.peek(1), 2);
+    EXPECT_EQ(cache.stats().failed_refreshes, 1u);
+    EXPECT_NE(sink.str().find("abandoning hung computation"), std::string::npos);
+
+    *release = true;
+}
+
+TEST(TimedCache, FailureWithoutValueIsReported)
+{
+    std::ostringstream sink;
+    tw::timed_cache<int, int, std::ostringstream> cache(opts(16, 1s, 0s), sink);
+
+    auto r = cache.get(1, 100ms, [](std::stop_token) -> int
+                       { throw std::runtime_error("backend down"); });
+    EXPECT_EQ(r.status(), tw::timed_status::failed);
+    EXPECT_THROW(r.value(), std::runtime_error);
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(TimedCache, ClockEvictionPrefersUnreferencedEntries)
+{
+    std::ostringstream sink;
+    tw::timed_cache<int, int, std::ostringstream> cache(opts(3, 10s, 0s), sink);
+    auto id = [](int k)
+    { return [k](std::stop_token)
+      { return k; }; };
+
+    for (int k = 1; k <= 3; ++k)
+        cache.get(k, 100ms, id(k));
+    // the sweep clears every reference bit and evicts key 1...
+    cache.get(4, 100ms, id(4));
+    EXPECT_FALSE(cache.peek(1));
+    // ...so touching key 2 now protects it from the next eviction
+    cache.get(2, 100ms, id(2));
+    cache.get(5, 100ms, id(5));
+
+    EXPECT_TRUE(cache.peek(2));
+    EXPECT_FALSE(cache.peek(3));
+    EXPECT_EQ(cache.size(), 3u);
+    EXPECT_EQ(cache.stats().evictions, 2u);
+}
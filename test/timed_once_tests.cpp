@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+#include <tw/timed_once.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(TimedOnce, FirstCallerInitializesOthersWait)
+{
+    std::ostringstream sink;
+    tw::timed_once<std::string, std::ostringstream> once({}, sink);
+    std::atomic_int inits{0};
+    std::atomic_int ok{0};
+
+    std::vector<std::thread> callers;
+    for (int i = 0; i < 8; ++i)
+    {
+        callers.emplace_back([&]
+                             {
+            auto r = once.get(1s, 1s, [&](std::stop_token)
+                              {
+                ++inits;
+                std::this_thread::sleep_for(20ms);
+                return std::string("ready"); });
+            if (r.ok() && r->get() == "ready" && &r->get() == once.try_get())
+                ++ok; });
+    }
+    for (auto &t : callers)
+        t.join();
+
+    EXPECT_EQ(ok, 8);
+    EXPECT_EQ(inits, 1);
+    EXPECT_TRUE(once.ready());
+}
+
+TEST(TimedOnce, LateValueIsKeptAfterCallerTimesOut)
+{
+    std::ostringstream sink;
+    tw::timed_once<int, std::ostringstream> once({}, sink);
+    auto init = [](std::stop_token)
+    {
+        std::this_thread::sleep_for(30ms);
+        return 5;
+    };
+
+    auto r = once.get(1s, 5ms, init);
+    EXPECT_EQ(r.status(), tw::timed_status::timed_out);
+
+    auto again = once.get(1s, 1s, init);
+    ASSERT_TRUE(again.ok());
+    EXPECT_EQ(again->get(), 5);
+    EXPECT_EQ(once.attempts(), 1u);
+}
+
+TEST(TimedOnce, FailureIsFinalWithoutRetryPolicy)
+{
+    std::ostringstream sink;
+    tw::timed_once<int, std::ostringstream> once({}, sink);
+    std::atomic_int calls{0};
+    auto init = [&](std::stop_token) -> int
+    {
+        ++calls;
+        throw std::runtime_error("no config");
+    };
+
+    EXPECT_EQ(once.get(1s, 1s, init).status(), tw::timed_status::failed);
+    auto second = once.get(1s, 1s, init);
+    EXPECT_EQ(second.status(), tw::timed_status::failed);
+    EXPECT_THROW(second.value(), std::runtime_error);
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(TimedOnce, RetriesFailedInitializer)
+{
+    std::ostringstream sink;
+    tw::once_options opts;
+    opts.max_attempts = 2;
+    tw::timed_once<int, std::ostringstream> once(opts, sink);
+    std::atomic_int calls{0};
+    auto init = [&](std::stop_token) -> int
+    {
+        if (++calls == 1)
+            throw std::runtime_error("transient");
+        return 9;
+    };
+
+    EXPECT_EQ(once.get(1s, 1s, init).status(), tw::timed_status::failed);
+    auto r = once.get(1s, 1s, init);
+    ASSERT_TRUE(r.ok());
+    EXPECT_EQ(r->get(), 9);
+    EXPECT_EQ(once.attempts(), 2u);
+}
+
+TEST(TimedOnce, HungInitializerIsAbandonedAndRetried)
+{
+    std::ostringstream sink;
+    tw::once_options opts;
+    opts.max_attempts = 2;
+    opts.shutdown_grace = 5ms;
+    tw::timed_once<int, std::ostringstream> once(opts, sink);
+    auto release = std::make_shared<std::atomic_bool>(false);
+
+    auto hung = once.get(5ms, 20ms, [release](std::stop_token)
+                         {
+        // ignores its stop token
+        while (!*release)
+            std::this_thread::sleep_for(1ms);
+        return -1; });
+    EXPECT_EQ(hung.status(), tw::timed_status::timed_out);
+
+    auto r = once.get(1s, 1s, [](std::stop_token)
+                      { return 3; });
+    ASSERT_TRUE(r.ok());
+    EXPECT_EQ(r->get(), 3);
+    EXPECT_EQ(once.attempts(), 2u);
+    EXPECT_NE(sink.str().find("abandoning hung initializer"), std::string::npos);
+
+    *release = true;
+}
+
+TEST(TimedOnce, FallbackOnTimeout)
+{
+    std::ostringstream sink;
+    tw::timed_once<int, std::ostringstream> once({}, sink);
+    int fallback = -7;
+
+    auto r = once.get(1s, 1ms, [](std::stop_token st)
+                      {
+        while (!st.stop_requested())
+            std::this_thread::sleep_for(1ms);
+        return 0; });
+    EXPECT_EQ(r.value_or(std::ref(fallback)).get(), -7);
+}
+
+TEST(TimedOnce, IndependentComponentsInitializeConcurrently)
+{
+    std::ostringstream sink;
+    tw::timed_once<int, std::ostringstream> a({}, sink), b({}, sink), c({}, sink);
+    auto slow = [](int v)
+    {
+        return [v](std::stop_token)
+        {
+            std::this_thread::sleep_for(40ms);
+            return v;
+        };
+    };
+
+    auto before = std::chrono::steady_clock::now();
+    a.start(1s, slow(1));
+    b.start(1s, slow(2));
+    c.start(1s, slow(3));
+    int sum = a.get(1s, 1s, slow(0))->get() + b.get(1s, 1s, slow(0))->get() + c.get(1s, 1s, slow(0))->get();
+    auto elapsed = std::chrono::steady_clock::now() - before;
+
+    EXPECT_EQ(sum, 6);
+    EXPECT_LT(elapsed, 100ms);
+}
+
+TEST(TimedOnce, StartedValueBecomesReadyWithoutFurtherCalls)
+{
+    std::ostringstream sink;
+    tw::timed_once<int, std::ostringstream> once({}, sink);
+    once.start(1s, [](std::stop_token)
+               { return 42; });
+
+    auto until = std::chrono::steady_clock::now() + 1s;
+    while (!once.ready() && std::chrono::steady_clock::now() < until)
+        std::this_thread::sleep_for(1ms);
+    ASSERT_TRUE(once.ready());
+    ASSERT_NE(once.try_get(), nullptr);
+    EXPECT_EQ(*once.try_get(), 42);
+    EXPECT_EQ(once.attempts(), 1u);
+}
@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+#include <tw/timed_task.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    tw::timed_task<int> answer()
+    {
+        co_return 42;
+    }
+
+    tw::timed_task<tw::timed_status> sleeper(std::chrono::milliseconds d)
+    {
+        auto r = co_await tw::delay(d);
+        co_return r.status();
+    }
+
+    tw::timed_task<int> thrower()
+    {
+        throw std::runtime_error("boom");
+        co_return 0;
+    }
+} // namespace
+
+TEST(TimedTask, ReturnsValue)
+{
+    auto r = tw::sync_wait(answer(), 1s);
+    ASSERT_TRUE(r.ok());
+    EXPECT_EQ(*r, 42);
+}
+
+TEST(TimedTask, DelayCompletes)
+{
+    auto r = tw::sync_wait(sleeper(5ms), 1s);
+    ASSERT_TRUE(r.ok());
+    EXPECT_EQ(*r, tw::timed_status::completed);
+}
+
+TEST(TimedTask, DeadlineResumesDelayWithTimedOut)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto r = tw::sync_wait(sleeper(10s), 20ms);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(r.status(), tw::timed_status::timed_out);
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r.value(), tw::timed_status::timed_out);
+    EXPECT_LT(elapsed, 1s);
+}
+
+TEST(TimedTask, RequestStopResumesWithStopped)
+{
+    auto t = sleeper(10s);
+    t.start(10s);
+    EXPECT_FALSE(t.done());
+    t.request_stop();
+
+    auto r = t.result();
+    EXPECT_EQ(r.status(), tw::timed_status::stopped);
+    EXPECT_EQ(r.value(), tw::timed_status::stopped);
+}
+
+TEST(TimedTask, ExceptionIsReportedAsFailed)
+{
+    auto r = tw::sync_wait(thrower(), 1s);
+    EXPECT_EQ(r.status(), tw::timed_status::failed);
+    EXPECT_THROW(r.value(), std::runtime_error);
+}
+
+TEST(TimedTask, AwaitsWorkerCompletion)
+{
+    std::ostringstream sink;
+    auto body = [&]() -> tw::timed_task<tw::timed_status>
+    {
+        auto w = tw::make_timed_worker(1s, [](std::stop_token)
+                                       { std::this_thread::sleep_for(5ms); }, sink);
+        auto r = co_await w;
+        co_return r.status();
+    };
+
+    auto r = tw::sync_wait(body(), 2s);
+    ASSERT_TRUE(r.ok());
+    EXPECT_EQ(*r, tw::timed_status::completed);
+}
+
+TEST(TimedTask, WorkerFinishingWhileSuspendingResumesPromptly)
+{
+    // the worker may finish between registering the completion hook and
+    // arming the deadline timer; that must not leave the task waiting out
+    // the deadline
+    std::ostringstream sink;
+    for (int i = 0; i < 300; ++i)
+    {
+        auto spin = std::chrono::nanoseconds(100 * (i % 20));
+        auto go = std::make_shared<std::atomic_bool>(false);
+        auto body = [&]() -> tw::timed_task<tw::timed_status>
+        {
+            auto w = tw::make_timed_worker(10s, [spin, go](std::stop_token)
+                                           {
+                while (!*go)
+                    std::this_thread::yield();
+                auto end = std::chrono::steady_clock::now() + spin;
+                while (std::chrono::steady_clock::now() < end)
+                    ; }, sink);
+            *go = true;
+            auto r = co_await w;
+            co_return r.status();
+        };
+
+        auto t0 = std::chrono::steady_clock::now();
+        auto r = tw::sync_wait(body(), 30s);
+        ASSERT_TRUE(r.ok());
+        EXPECT_EQ(*r, tw::timed_status::completed);
+        ASSERT_LT(std::chrono::steady_clock::now() - t0, 2s) << "iteration " << i;
+    }
+}
+
+TEST(TimedTask, WorkerTimeoutResumesWithTimedOutAndStopsWorker)
+{
+    std::ostringstream sink;
+    // the handle's wait ends at creation + 20ms, so the worker may be
+    // detached before it sees the stop
+    auto saw_stop = std::make_shared<std::atomic_bool>(false);
+    auto body = [&]() -> tw::timed_task<tw::timed_status>
+    {
+        auto w = tw::make_timed_worker(20ms, [saw_stop](std::stop_token st)
+                                       {
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms);
+            *saw_stop = true; }, sink);
+        auto r = co_await w;
+        co_return r.status();
+    };
+
+    auto r = tw::sync_wait(body(), 2s);
+    ASSERT_TRUE(r.ok());
+    EXPECT_EQ(*r, tw::timed_status::timed_out);
+    for (int i = 0; i < 1000 && !*saw_stop; ++i)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_TRUE(*saw_stop);
+}
+
+TEST(TimedTask, ChildInheritsAndNarrowsDeadline)
+{
+    auto parent = []() -> tw::timed_task<tw::timed_status>
+    {
+        auto r = co_await sleeper(10s).with_timeout(10ms);
+        co_return r.value();
+    };
+
+    auto r = tw::sync_wait(parent(), 1s);
+    ASSERT_TRUE(r.ok());
+    EXPECT_EQ(*r, tw::timed_status::timed_out);
+}
+
+TEST(TimedTask, HugeDurationsSaturate)
+{
+    auto task = []() -> tw::timed_task<tw::timed_status>
+    {
+        auto child = []() -> tw::timed_task<int>
+        { co_return 7; };
+        auto c = co_await child().with_timeout(std::chrono::hours::max());
+        auto r = co_await tw::delay(std::chrono::hours::min());
+        co_return c.ok() ? r.status() : tw::timed_status::failed;
+    };
+
+    auto r = tw::sync_wait(task(), std::chrono::hours::max());
+    ASSERT_TRUE(r.ok());
+    EXPECT_EQ(*r, tw::timed_status::completed);
+}
+
+TEST(TimedTask, ManyConcurrentTasksWithoutThreads)
+{
+    constexpr int N = 1000;
+    std::vector<tw::timed_task<tw::timed_status>> tasks;
+    tasks.reserve(N);
+    for (int i = 0; i < N; ++i)
+    {
+        tasks.push_back(sleeper(10ms));
+        tasks.back().start(5s);
+    }
+
+    int completed = 0;
+    for (auto &t : tasks)
+        completed += t.result().value() == tw::timed_status::completed;
+    EXPECT_EQ(completed, N);
+}
+
+TEST(TimedTask, BlockingContinuationDoesNotStallTimers)
+{
+    auto blocker = []() -> tw::timed_task<int>
+    {
+        co_await tw::delay(1ms);
+        std::this_thread::sleep_for(300ms);
+        co_return 0;
+    };
+    auto a = blocker();
+    a.start(5s);
+
+    std::this_thread::sleep_for(20ms);
+    auto t0 = std::chrono::steady_clock::now();
+    auto r = tw::sync_wait(sleeper(10ms), 5s);
+    EXPECT_LT(std::chrono::steady_clock::now() - t0, 200ms);
+    ASSERT_TRUE(r.ok());
+    EXPECT_EQ(*r, tw::timed_status::completed);
+    a.wait();
+}
@@ -6,6 +6,8 @@
 #include <atomic>
 #include <stdexcept>
 #include <functional>
+#include <memory>
+#include <optional>
 
 // Import the stop_token name for convenience
 using std::stop_token;
@@ -72,20 +74,22 @@ TEST(TimedWorker, ForcedDetachDueToTimeout)
     std::ostringstream sink;
     sink << "Test starting\n";
 
+    // The detached thread outlives this scope, so everything it touches is
+    // owned by the thread itself.
+    auto exited = std::make_shared<std::atomic_bool>(false);
+
     {
         // Very small timeout so the destructor will hit the detach logic quickly
         sink << "Creating worker\n";
         // Use a very short timeout to trigger the detach path quickly
-        auto w = tw::make_timed_worker(10ms, [&sink](std::stop_token st)
+        auto w = tw::make_timed_worker(10ms, [exited](std::stop_token)
                                        {
-            sink << "Worker thread started\n";
             // Purposely ignore stop requests for a short time, but have a safety exit
             auto start = std::chrono::steady_clock::now();
-            while (!st.stop_requested() && 
-                   std::chrono::steady_clock::now() - start < std::chrono::seconds(1)) {
+            while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(200)) {
                 std::this_thread::sleep_for(std::chrono::milliseconds(10));
             }
-            sink << "Worker exiting normally\n"; }, sink);
+            exited->store(true); }, sink);
 
         // Add a short sleep so destructor detach gets triggered
         sink << "Sleeping before destructor\n";
@@ -95,7 +99,11 @@ TEST(TimedWorker, ForcedDetachDueToTimeout)
     sink << "Worker destroyed\n";
 
     EXPECT_NE(sink.str().find("FORCED detach"), std::string::npos);
+    EXPECT_FALSE(exited->load()) << "destructor must not wait for a detached worker";
     std::cout << "Test log: " << sink.str() << std::endl;
+
+    while (!exited->load())
+        std::this_thread::sleep_for(5ms);
 }
 
 TEST(TimedWorker, EmergencyStopTriggersImmediateDetach)
@@ -104,54 +112,60 @@ TEST(TimedWorker, EmergencyStopTriggersImmediateDetach)
     std::ostringstream sink;
     sink << "Emergency test starting\n";
 
+    // Shared with the worker, which keeps running after it has been detached
+    struct WorkerState
     {
-        // Create a flag to track if the worker is blocked
-        std::atomic_bool worker_blocked{false};
+        std::atomic_bool blocked{false};
+        std::atomic_bool saw_stop{false};
+        std::atomic_bool exited{false};
+    };
+    auto state = std::make_shared<WorkerState>();
+    std::chrono::steady_clock::duration destroy_time{};
 
-        // Inline the worker function with debug logging - now with block before checking the stop token
-        auto w = tw::make_timed_worker(100ms, [&sink, &worker_blocked](std::stop_token st)
+    {
+        // Worker blocks before checking the stop token
+        std::optional<tw::TimedWorker<std::ostringstream>> w;
+        w.emplace(tw::make_timed_worker(100ms, [state](std::stop_token st)
                                        {
-            sink << "Emergency worker thread started\n";
-            
             // Block the worker for a bit to ensure emergency_stop has time to take effect
             // but the worker doesn't have time to check the stop token before destruction
-            worker_blocked = true;
+            state->blocked = true;
             // Use a longer sleep to ensure the worker is still running when emergency_stop is called
             std::this_thread::sleep_for(std::chrono::milliseconds(500));
-            worker_blocked = false;
-            
-            sink << "Emergency worker finishing block\n";
-            
-            // Normal worker logic follows
-            if (!st.stop_requested()) {
-                sink << "Emergency worker NOT stopped (unexpected)\n";
-            } else {
-                sink << "Emergency worker sees stop request\n";
-            }
-            
-            sink << "Emergency worker exiting\n"; }, sink);
+            state->blocked = false;
+
+            state->saw_stop = st.stop_requested();
+            state->exited = true; }, sink));
 
         // Give worker time to start blocking
         std::this_thread::sleep_for(10ms);
 
         // Verify the worker has started and is blocked
-        EXPECT_TRUE(worker_blocked) << "Worker should be blocked at this point";
+        EXPECT_TRUE(state->blocked) << "Worker should be blocked at this point";
 
         // escalate immediately - destructor should not wait
         sink << "Calling emergency_stop()\n";
-        w.emergency_stop();
+        w->emergency_stop();
         sink << "About to destroy emergency worker\n";
 
         // We're not sleeping here - we want the destructor to
         // run while the worker is still blocked
+        auto before = std::chrono::steady_clock::now();
+        w.reset();
+        destroy_time = std::chrono::steady_clock::now() - before;
     }
     sink << "Emergency worker destroyed\n";
 
     // Check that forced detach happened
     EXPECT_NE(sink.str().find("FORCED detach"), std::string::npos)
         << "Emergency stop should have triggered a forced detach";
+    EXPECT_LT(destroy_time, 100ms) << "Emergency stop must not wait for the worker";
 
     std::cout << "Emergency test log: " << sink.str() << std::endl;
+
+    while (!state->exited)
+        std::this_thread::sleep_for(5ms);
+    EXPECT_TRUE(state->saw_stop) << "emergency_stop() also requests a cooperative stop";
 }
 
 TEST(TimedWorker, LogsUnhandledException)
@@ -372,3 +386,154 @@ TEST(TimedWorker, HighConcurrencyStressTest)
 
     SUCCEED();
 }
+
+TEST(TimedWorker, SubMillisecondTimeoutIsEnforced)
+{
+    using namespace std::chrono_literals;
+    std::ostringstream sink;
+    auto started = std::make_shared<std::atomic_bool>(false);
+    auto exited = std::make_shared<std::atomic_bool>(false);
+
+    std::chrono::steady_clock::duration elapsed{};
+    {
+        std::optional<tw::TimedWorker<std::ostringstream>> w;
+        w.emplace(tw::make_timed_worker(300us, [started, exited](std::stop_token)
+                                        {
+            *started = true;
+            std::this_thread::sleep_for(50ms);
+            *exited = true; }, sink));
+        while (!*started)
+            std::this_thread::yield();
+
+        auto before = std::chrono::steady_clock::now();
+        w.reset();
+        elapsed = std::chrono::steady_clock::now() - before;
+    }
+
+    EXPECT_NE(sink.str().find("FORCED detach"), std::string::npos);
+    EXPECT_LT(elapsed, 20ms);
+
+    while (!*exited)
+        std::this_thread::sleep_for(5ms);
+}
+
+TEST(TimedWorker, AcceptsAnyDurationAndTimePoint)
+{
+    using namespace std::chrono_literals;
+    std::ostringstream sink;
+    std::atomic_int runs{0};
+    auto body = [&](std::stop_token, int n)
+    { runs += n; };
+
+    {
+        auto a = tw::make_timed_worker(std::chrono::microseconds(500'000), body, sink, 1);
+        auto b = tw::make_timed_worker(std::chrono::duration<double>(0.5), body, sink, 2);
+        auto c = tw::make_timed_worker(std::chrono::steady_clock::now() + 500ms, body, sink, 4);
+        auto d = tw::make_timed_worker(std::chrono::system_clock::now() + 500ms, body, sink, 8);
+
+        EXPECT_LE(c.deadline(), std::chrono::steady_clock::now() + 500ms);
+        EXPECT_GT(d.deadline(), std::chrono::steady_clock::now() + 400ms);
+
+        // destroying right away could stop a worker before it ever ran
+        while (!(a.done() && b.done() && c.done() && d.done()))
+            std::this_thread::sleep_for(1ms);
+    }
+
+    EXPECT_EQ(runs, 15);
+    EXPECT_EQ(sink.str().find("FORCED detach"), std::string::npos);
+}
+
+TEST(TimedWorker, RequestStopStillGrantsGracePeriod)
+{
+    using namespace std::chrono_literals;
+    std::ostringstream sink;
+    std::atomic_bool cleaned_up{false};
+
+    {
+        auto w = tw::make_timed_worker(500ms, [&](std::stop_token st)
+                                       {
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms);
+            // cleanup after the stop request, well inside the budget
+            std::this_thread::sleep_for(20ms);
+            cleaned_up = true; }, sink);
+        std::this_thread::sleep_for(5ms);
+        w.request_stop();
+    }
+
+    EXPECT_TRUE(cleaned_up);
+    EXPECT_EQ(sink.str().find("FORCED detach"), std::string::npos);
+}
+
+TEST(TimedWorker, RunDeadlineRequestsStopWithoutDestruction)
+{
+    using namespace std::chrono_literals;
+    std::ostringstream sink;
+    std::atomic_bool saw_stop{false};
+
+    auto w = tw::make_timed_worker(std::chrono::steady_clock::now() + 20ms, 1s, [&](std::stop_token st)
+                                   {
+        while (!st.stop_requested())
+            std::this_thread::sleep_for(1ms);
+        saw_stop = true; }, sink);
+
+    for (int i = 0; i < 500 && !w.done(); ++i)
+        std::this_thread::sleep_for(1ms);
+
+    EXPECT_TRUE(w.done());
+    EXPECT_TRUE(saw_stop);
+    EXPECT_EQ(w.shutdown_grace(), 1s);
+}
+
+TEST(TimedWorker, LongLivedHandleKeepsShutdownGrace)
+{
+    using namespace std::chrono_literals;
+    std::ostringstream sink;
+    std::atomic_bool cleaned_up{false};
+
+    {
+        auto w = tw::make_timed_worker(5s, 300ms, [&](std::stop_token st)
+                                       {
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms);
+            std::this_thread::sleep_for(30ms);
+            cleaned_up = true; }, sink);
+        // long past anything a single-timeout worker would have allowed
+        std::this_thread::sleep_for(50ms);
+    }
+
+    EXPECT_TRUE(cleaned_up);
+    EXPECT_EQ(sink.str().find("FORCED detach"), std::string::npos);
+}
+
+TEST(TimedWorker, GraceIsCountedFromRunDeadline)
+{
+    using namespace std::chrono_literals;
+    std::ostringstream sink;
+    auto release = std::make_shared<std::atomic_bool>(false);
+    auto exited = std::make_shared<std::atomic_bool>(false);
+
+    std::chrono::steady_clock::duration took{};
+    {
+        std::optional<tw::TimedWorker<std::ostringstream>> w;
+        w.emplace(tw::make_timed_worker(10ms, 20ms, [release, exited](std::stop_token)
+                                        {
+            // ignores its stop token entirely
+            while (!*release)
+                std::this_thread::sleep_for(1ms);
+            *exited = true; }, sink));
+        // deadline + grace have both passed: no reason to wait any longer
+        std::this_thread::sleep_for(60ms);
+
+        auto before = std::chrono::steady_clock::now();
+        w.reset();
+        took = std::chrono::steady_clock::now() - before;
+    }
+
+    EXPECT_NE(sink.str().find("FORCED detach"), std::string::npos);
+    EXPECT_LT(took, 10ms);
+
+    *release = true;
+    while (!*exited)
+        std::this_thread::sleep_for(1ms);
+}
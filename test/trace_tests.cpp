@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <tw/trace.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST(Trace, RecordsOutcomesOfWorkers)
+{
+    std::ostringstream sink;
+    auto release = std::make_shared<std::atomic_bool>(false);
+    tw::trace_recorder rec;
+    rec.start();
+    {
+        auto done = tw::make_timed_worker(1s, [](std::stop_token)
+                                          { std::this_thread::sleep_for(2ms); },
+                                          sink);
+        while (!done.done())
+            std::this_thread::sleep_for(1ms);
+    }
+    {
+        std::atomic_bool started{false};
+        auto stopped = tw::make_timed_worker(5ms, 1s, [&](std::stop_token st)
+                                             {
+            started = true;
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(100us); },
+                                             sink);
+        while (!stopped.done())
+            std::this_thread::sleep_for(1ms);
+    }
+    {
+        auto failed = tw::make_timed_worker(1s, [](std::stop_token)
+                                            { throw std::runtime_error("boom"); }, sink);
+        while (!failed.done())
+            std::this_thread::sleep_for(1ms);
+    }
+    {
+        std::atomic_bool started{false};
+        auto stuck = tw::make_timed_worker(2ms, [release, &started](std::stop_token)
+                                           {
+            started = true;
+            while (!*release)
+                std::this_thread::sleep_for(100us); },
+                                           sink);
+        while (!started)
+            std::this_thread::sleep_for(100us);
+    }
+    rec.stop();
+    *release = true;
+
+    // not recorded: the recorder is stopped
+    {
+        auto w = tw::make_timed_worker(1s, [](std::stop_token) {}, sink);
+    }
+
+    auto r = rec.records();
+    ASSERT_EQ(r.size(), 4u);
+    EXPECT_EQ(r[0].outcome, tw::trace_outcome::completed);
+    EXPECT_EQ(r[0].timeout, 1s);
+    EXPECT_GE(r[0].run, 2ms);
+    EXPECT_EQ(r[1].outcome, tw::trace_outcome::stopped);
+    EXPECT_LE(r[1].timeout, 5ms);
+    EXPECT_GT(r[1].run, 0ns);
+    EXPECT_EQ(r[2].outcome, tw::trace_outcome::failed);
+    EXPECT_EQ(r[3].outcome, tw::trace_outcome::detached);
+    EXPECT_GE(r[3].run, 2ms);
+    for (std::size_t i = 1; i < r.size(); ++i)
+        EXPECT_GE(r[i].created, r[i - 1].created);
+}
+
+TEST(Trace, EncodesCompactlyAndRoundTrips)
+{
+    std::vector<tw::trace_record> in{
+        {2ms, 10ms, 1500us, tw::trace_outcome::completed},
+        {1ms, 5ms, 5ms, tw::trace_outcome::stopped},
+        {3ms, 1s, 2s, tw::trace_outcome::detached},
+        {3ms, 0ns, 0ns, tw::trace_outcome::skipped},
+    };
+    auto bytes = tw::encode_trace(in);
+    EXPECT_LT(bytes.size(), 5 + 4 * 13u);
+
+    auto out = tw::decode_trace(bytes);
+    ASSERT_EQ(out.size(), 4u);
+    EXPECT_EQ(out[0], in[1]);
+    EXPECT_EQ(out[1], in[0]);
+    EXPECT_EQ(out[2], in[2]);
+    EXPECT_EQ(out[3], in[3]);
+
+    bytes.pop_back();
+    EXPECT_THROW(tw::decode_trace(bytes), std::runtime_error);
+    bytes[0] = 'X';
+    EXPECT_THROW(tw::decode_trace(bytes), std::runtime_error);
+}
+
+TEST(Trace, SavesAndLoadsFiles)
+{
+    auto file = std::filesystem::temp_directory_path() / "tw_trace_test.twtr";
+    std::vector<tw::trace_record> in{{0ns, 1ms, 10us, tw::trace_outcome::completed}};
+    tw::save_trace(file, in);
+    EXPECT_EQ(tw::load_trace(file), in);
+    std::filesystem::remove(file);
+    EXPECT_THROW(tw::load_trace(file), std::system_error);
+}
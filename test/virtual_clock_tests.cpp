@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <tw/timed_worker.hpp>
+#include <tw/virtual_clock.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(VirtualClock, FiresTimersInOrderOnAdvance)
+{
+    struct probe : tw::timer_node
+    {
+        probe(std::vector<int> &log, int id) : timer_node(&on_fire), log(&log), id(id) {}
+        static void on_fire(timer_node &n) noexcept
+        {
+            auto &p = static_cast<probe &>(n);
+            p.log->push_back(p.id);
+        }
+        std::vector<int> *log;
+        int id;
+    };
+
+    tw::virtual_clock clk;
+    auto t0 = clk.now();
+    std::vector<int> fired;
+    probe a(fired, 1), b(fired, 2), c(fired, 3);
+    clk.schedule(b, t0 + 2s);
+    clk.schedule(a, t0 + 1s);
+    clk.schedule(c, t0 + 3s);
+    EXPECT_TRUE(clk.cancel(c));
+
+    clk.advance(1500ms);
+    EXPECT_EQ(fired, std::vector<int>{1});
+    clk.advance(10s);
+    EXPECT_EQ(fired, (std::vector<int>{1, 2}));
+    EXPECT_EQ(clk.now(), t0 + 11500ms);
+    EXPECT_FALSE(clk.cancel(a));
+    EXPECT_EQ(clk.pending(), 0u);
+}
+
+TEST(VirtualClock, RunDeadlineFollowsVirtualTime)
+{
+    std::ostringstream sink;
+    tw::virtual_clock clk;
+    tw::clock_scope use(clk);
+
+    auto w = tw::make_timed_worker(10s, 1s, [](std::stop_token st)
+                                   {
+        while (!st.stop_requested())
+            std::this_thread::sleep_for(100us); },
+                                   sink);
+    EXPECT_EQ(w.deadline(), clk.now() + 10s);
+
+    clk.advance(9999ms);
+    EXPECT_FALSE(w.done());
+    clk.advance(1ms);
+    EXPECT_TRUE(w.wait_until(clk.now() + 1s));
+}
+
+TEST(VirtualClock, IgnoredStopDetachesAfterVirtualGrace)
+{
+    std::ostringstream sink;
+    tw::virtual_clock clk;
+    tw::clock_scope use(clk);
+    auto release = std::make_shared<std::atomic_bool>(false);
+
+    std::jthread advancer([&]
+                          {
+        clk.block_until_waiters(1);
+        clk.advance(5s); });
+
+    auto t0 = std::chrono::steady_clock::now();
+    {
+        std::atomic_bool started{false};
+        auto w = tw::make_timed_worker(5s, [release, &started](std::stop_token)
+                                       {
+            started = true;
+            while (!*release)
+                std::this_thread::sleep_for(100us); },
+                                       sink);
+        while (!started)
+            std::this_thread::yield();
+    }
+    *release = true;
+    EXPECT_NE(sink.str().find("FORCED detach"), std::string::npos);
+    EXPECT_LT(std::chrono::steady_clock::now() - t0, 1s);
+}
+
+TEST(VirtualClock, StressRunBudgetsWithoutSleeping)
+{
+    std::ostringstream sink;
+    tw::virtual_clock clk;
+    tw::clock_scope use(clk);
+
+    for (int i = 0; i < 200; ++i)
+    {
+        std::atomic_bool sawStop{false};
+        auto w = tw::make_timed_worker(50ms, 1h, [&](std::stop_token st)
+                                       {
+            while (!st.stop_requested())
+                std::this_thread::yield();
+            sawStop = true; },
+                                       sink);
+        clk.advance(49ms);
+        ASSERT_FALSE(sawStop);
+        ASSERT_FALSE(w.done());
+        clk.advance(1ms);
+        ASSERT_TRUE(w.wait_until(clk.now() + 1h));
+    }
+    EXPECT_EQ(sink.str(), "");
+}
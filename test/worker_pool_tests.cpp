@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <tw/worker_pool.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST(WorkerPool, RunsSubmittedTasksConcurrently)
+{
+    std::ostringstream sink;
+    std::atomic_int done{0};
+    {
+        tw::worker_pool<std::ostringstream> pool(4, sink);
+        EXPECT_EQ(pool.size(), 4u);
+
+        auto before = std::chrono::steady_clock::now();
+        for (int i = 0; i < 4; ++i)
+            ASSERT_TRUE(pool.submit([&done](std::stop_token)
+                                    {
+                std::this_thread::sleep_for(30ms);
+                ++done; }));
+        while (done < 4)
+            std::this_thread::sleep_for(1ms);
+        EXPECT_LT(std::chrono::steady_clock::now() - before, 100ms);
+    }
+    EXPECT_EQ(sink.str().find("FORCED detach"), std::string::npos);
+}
+
+TEST(WorkerPool, ShutdownStopsRunningAndDropsQueuedTasks)
+{
+    std::ostringstream sink;
+    auto started = std::make_shared<std::atomic_bool>(false);
+    auto ran = std::make_shared<std::atomic_int>(0);
+    {
+        tw::worker_pool<std::ostringstream> pool(1, sink, 50ms, 8);
+        pool.submit([started](std::stop_token st)
+                    {
+            *started = true;
+            while (!st.stop_requested())
+                std::this_thread::sleep_for(1ms); });
+        for (int i = 0; i < 3; ++i)
+            EXPECT_TRUE(pool.try_submit([ran](std::stop_token)
+                                        { ++*ran; }));
+        while (!*started)
+            std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(*ran, 0);
+    EXPECT_EQ(sink.str().find("FORCED detach"), std::string::npos);
+}
+
+TEST(WorkerPool, ThrowingTaskDoesNotCostAThread)
+{
+    std::ostringstream sink;
+    auto ran = std::make_shared<std::atomic_int>(0);
+    {
+        tw::worker_pool<std::ostringstream> pool(1, sink);
+        EXPECT_TRUE(pool.submit([](std::stop_token)
+                                { throw std::runtime_error("boom"); }));
+        EXPECT_TRUE(pool.submit([](std::stop_token)
+                                { throw 42; }));
+        EXPECT_TRUE(pool.submit([ran](std::stop_token)
+                                { ++*ran; }));
+        for (int i = 0; i < 2000 && *ran == 0; ++i)
+            std::this_thread::sleep_for(1ms);
+        EXPECT_EQ(*ran, 1);
+        EXPECT_EQ(pool.queued(), 0u);
+    }
+    EXPECT_NE(sink.str().find("[worker_pool] unhandled exception: boom"), std::string::npos);
+    EXPECT_NE(sink.str().find("[worker_pool] unknown exception"), std::string::npos);
+}
+
+TEST(WorkerPool, DestructionWaitsOneGraceForAllWorkers)
+{
+    std::ostringstream sink;
+    auto release = std::make_shared<std::atomic_bool>(false);
+    auto busy = std::make_shared<std::atomic_int>(0);
+    auto pool = std::make_unique<tw::worker_pool<std::ostringstream>>(4, sink, 50ms);
+    for (int i = 0; i < 4; ++i)
+        pool->submit([release, busy](std::stop_token)
+                     {
+            ++*busy;
+            while (!*release)
+                std::this_thread::sleep_for(1ms); });
+    for (int i = 0; i < 2000 && *busy < 4; ++i)
+        std::this_thread::sleep_for(1ms);
+    ASSERT_EQ(*busy, 4);
+
+    auto t0 = std::chrono::steady_clock::now();
+    pool.reset();
+    auto elapsed = std::chrono::steady_clock::now() - t0;
+    *release = true;
+
+    // one grace for the four stuck workers, not one each
+    EXPECT_GE(elapsed, 50ms);
+    EXPECT_LT(elapsed, 150ms);
+}